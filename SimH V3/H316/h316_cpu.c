@@ -25,6 +25,7 @@
 
    cpu          H316/H516 CPU
 
+   18-Oct-26    RMS     Added idle support
    07-Sep-17    RMS     Fixed sim_eval declaration in history routine (COVERITY)
    21-May-13    RLA     Add IMP/TIP support
                         Move SMK/OTK instructions here (from CLK)
@@ -387,6 +388,8 @@ MTAB cpu_mod[] = {
     { UNIT_DMC, UNIT_DMC, "DMC", "DMC", NULL },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "HISTORY", "HISTORY",
       &cpu_set_hist, &cpu_show_hist },
+    { MTAB_XTD|MTAB_VDV, 0, "IDLE", "IDLE", &sim_set_idle, &sim_show_idle },
+    { MTAB_XTD|MTAB_VDV, 0, NULL, "NOIDLE", &sim_clr_idle, NULL },
     { MTAB_XTD | MTAB_VDV, 0, "extended interrupts", "EXTINT",
       &cpu_set_interrupts, &cpu_show_interrupts, NULL },
     { 0 }
@@ -555,6 +558,15 @@ switch (I_GETOP (MB)) {                                 /* case on <1:6> */
         if ((reason = Ea (MB, &Y)))                     /* eff addr */
             break;
         PCQ_ENTRY;                                      /* save PC */
+        if (sim_idle_enab) {                            /* idling enabled? */
+            t1 = NEWA (PC, PC - 1);                     /* JMP address */
+            t2 = NEWA (PC, Y);                          /* target */
+            t3 = I_GETOP (M[t2]);
+            if ((t2 == t1) ||                           /* JMP * or */
+                ((t2 == NEWA (PC, PC - 2)) &&           /* JMP *-1 to */
+                 ((t3 == 034) || (t3 == 054))))         /* SKS or INA? */
+                sim_idle_loop (0, t1, t2, (dev_int & INT_ON) != 0);
+            }
         PC = NEWA (PC, Y);                              /* set new PC */
         if (extoff_pending)                             /* cond ext off */
             ext = extoff_pending = 0;
@@ -28,6 +28,7 @@
    tty          316/516-33 teleprinter
    clk/options  316/516-12 real time clocks/internal options
 
+   18-Oct-26    RMS     Added UNIT_IDLE flag to TTY input, clock
    20-Mar-21    RMS     Reverted use of ftell for pipe compatibility
    10-Sep-13    RMS     Fixed several bugs in the TTY logic
                         Added SET file type commands to PTR/PTP
@@ -249,7 +250,7 @@ DEVICE ptp_dev = {
 DIB tty_dib = { TTY, 1, IOBUS, IOBUS, INT_V_TTY, INT_V_NONE, &ttyio, 0 };
 
 UNIT tty_unit[] = {
-    { UDATA (&tti_svc, TT_MODE_KSR, 0), KBD_POLL_WAIT },
+    { UDATA (&tti_svc, TT_MODE_KSR+UNIT_IDLE, 0), KBD_POLL_WAIT },
     { UDATA (&tto_svc, TT_MODE_KSR, 0), SERIAL_OUT_WAIT },
     { UDATA (NULL, UNIT_SEQ+UNIT_ATTABLE+UNIT_ROABLE, 0) },
     { UDATA (NULL, UNIT_SEQ+UNIT_ATTABLE, 0) }
@@ -313,7 +314,7 @@ DEVICE tty_dev = {
 
 DIB clk_dib = { CLK_KEYS, 1, IOBUS, IOBUS, INT_V_CLK, INT_V_NONE, &clkio, 0 };
 
-UNIT clk_unit = { UDATA (&clk_svc, 0, 0), 16000 };
+UNIT clk_unit = { UDATA (&clk_svc, UNIT_IDLE, 0), 16000 };
 
 REG clk_reg[] = {
     { FLDATA (READY, dev_int, INT_V_CLK) },
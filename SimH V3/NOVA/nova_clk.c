@@ -25,6 +25,7 @@
 
    clk          real-time clock
 
+   18-Oct-26    RMS     Added UNIT_IDLE flag
    04-Jul-07    BKR     DEV_SET/CLR macros now used,
                         changed CLK name to RTC for DG compatiblity,
                         device may now bw DISABLED
@@ -61,7 +62,7 @@ t_stat clk_show_freq (FILE *st, UNIT *uptr, int32 val, void *desc);
 
 DIB clk_dib = { DEV_CLK, INT_CLK, PI_CLK, &clk };
 
-UNIT clk_unit = { UDATA (&clk_svc, 0, 0) };
+UNIT clk_unit = { UDATA (&clk_svc, UNIT_IDLE, 0) };
 
 REG clk_reg[] = {
     { ORDATA (SELECT, clk_sel, 2) },
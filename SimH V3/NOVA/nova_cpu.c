@@ -25,6 +25,7 @@
 
    cpu          Nova central processor
 
+   18-Oct-26    RMS     Added idle support
    03-Oct-20    RMS     Fixed bug in history handling of C bit (Samuel Deutsch)
    07-Sep-17    RMS     Fixed sim_eval declaration in history routine (COVERITY)
    17-Mar-13    RMS     Added clarifying brances to IND_STEP macro (Dave Bryan)
@@ -398,6 +399,8 @@ MTAB cpu_mod[] = {
     { UNIT_MSIZE, (56 * 1024), NULL, "56K", &cpu_set_size },
     { UNIT_MSIZE, (60 * 1024), NULL, "60K", &cpu_set_size },
     { UNIT_MSIZE, (64 * 1024), NULL, "64K", &cpu_set_size },
+    { MTAB_XTD|MTAB_VDV, 0, "IDLE", "IDLE", &sim_set_idle, &sim_show_idle },
+    { MTAB_XTD|MTAB_VDV, 0, NULL, "NOIDLE", &sim_clr_idle, NULL },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "HISTORY", "HISTORY",
       &hist_set, &hist_show },
 
@@ -636,6 +639,13 @@ while (reason == 0) {                                   /* loop until halted */
             AC[3] = PC;
         case 000:                                       /* JMP */
             PCQ_ENTRY;
+            if (sim_idle_enab &&                        /* idling enabled? */
+                ((MA == ((PC - 1) & AMASK)) ||          /* JMP . or */
+                 ((MA == ((PC - 2) & AMASK)) &&         /* JMP .-1 to skip? */
+                  ((M[MA] & 0160000) == 060000) &&
+                  (I_GETIOT (M[MA]) == ioSKP))))
+                sim_idle_loop (0, (PC - 1) & AMASK, MA,
+                    (int_req & INT_ION) != 0);
             PC = MA;
             break;
         case 002:                                       /* ISZ */
@@ -26,6 +26,7 @@
    tti          terminal input
    tto          terminal output
 
+   18-Oct-26    RMS     Added UNIT_IDLE flag to TTI
    31-Mar-15    RMS     Backported parity capability from GitHub master
    04-Jul-07    BKR     fixed Dasher CR/LF swap function in 'tti_svc()',
                         DEV_SET/CLR macros now used,
@@ -73,7 +74,7 @@ t_stat ttx_setpar (UNIT *uptr, int32 val, char *cptr, void *desc);
 
 DIB tti_dib = { DEV_TTI, INT_TTI, PI_TTI, &tti };
 
-UNIT tti_unit = { UDATA (&tti_svc, 0, 0), KBD_POLL_WAIT };
+UNIT tti_unit = { UDATA (&tti_svc, UNIT_IDLE, 0), KBD_POLL_WAIT };
 
 REG tti_reg[] = {
     { ORDATA (BUF, tti_unit.buf, 8) },
@@ -25,6 +25,8 @@
 
    cpu          KS10 central processor
 
+   18-Oct-26    RMS     Added dirty page tracking
+                        Exposed memory array for SAVE/RESTORE
    07-Sep-17    RMS     Fixed sim_eval declaration in history routine (COVERITY)
    14-Jan-17    RMS     Fixed bugs in 1-proceed
    09-Feb-16    RMS     Fixed nested indirects and executes (Tim Litt)
@@ -2378,6 +2380,9 @@ if (M == NULL)
     M = (d10 *) calloc (MAXMEMSIZE, sizeof (d10));
 if (M == NULL)
     return SCPE_MEM;
+cpu_unit.filebuf = M;                                   /* for SAVE/RESTORE */
+if (sim_dirty_setup (&cpu_unit, PAG_N_OFF) != SCPE_OK)  /* dirty page map */
+    return SCPE_MEM;
 pcq_r = find_reg ("PCQ", NULL, dptr);
 if (pcq_r)
     pcq_r->qptr = 0;
@@ -2422,6 +2427,7 @@ else {
     if (ea >= MEMSIZE)
         return SCPE_NXM;
     M[ea] = val & DMASK;
+    SIM_DIRTY (ea);
     }
 return SCPE_OK;
 }
@@ -25,6 +25,7 @@
 
    fe           KS10 console front end
 
+   18-Oct-26    RMS     Added dirty page tracking
    02-Apr-15    RMS     Backported keepalive mechanism
    18-Apr-12    RMS     Added clock coscheduling
    18-Jun-07    RMS     Added UNIT_IDLE flag to console input
@@ -187,6 +188,7 @@ if ((r = sim_putchar_s (uptr->buf)) != SCPE_OK) {       /* output; error? */
     return ((r == SCPE_STALL)? SCPE_OK: r);             /* !stall? report */
     }
 M[FE_CTYOUT] = 0;                                       /* clear char */
+SIM_DIRTY (FE_CTYOUT);
 apr_flg = apr_flg | APRF_CON;                           /* interrupt KS10 */
 return SCPE_OK;
 }
@@ -203,6 +205,7 @@ if (temp & SCPE_BREAK)                                  /* ignore break */
 uptr->buf = temp & 0177;
 uptr->pos = uptr->pos + 1;
 M[FE_CTYIN] = uptr->buf | FE_CVALID;                    /* put char in mem */
+SIM_DIRTY (FE_CTYIN);
 apr_flg = apr_flg | APRF_CON;                           /* interrupt KS10 */
 return SCPE_OK;
 }
@@ -236,6 +239,7 @@ if (M[FE_KEEPA] & INT64_C(0020000000000)) {              /* KSRLD - "Forced" (ac
     fei_unit.buf = feo_unit.buf = 0;
     M[FE_CTYIN] = M[FE_CTYOUT] = 0;
     M[FE_KLININ] = M[FE_KLINOUT] = 0;
+    sim_dirty_all ();                                   /* boot writes memory */
 
     /* The 8080 has the disk RH address & unit in its memory, even if
      * the previous boot was from tape.  It has no NVM, so the last opr
@@ -278,6 +282,7 @@ else if (M[FE_KEEPA] & INT64_C(0010000000000)) {        /* KPACT */
         fei_unit.buf = feo_unit.buf = 0;
         M[FE_CTYIN] = M[FE_CTYOUT] = 0;
         M[FE_KLININ] = M[FE_KLINOUT] = 0;
+        SIM_DIRTY (FE_KEEPA);                           /* one page */
         fe_xct = 071;
         }
     }
@@ -299,6 +304,7 @@ M[FE_CTYIN] = M[FE_CTYOUT] = 0;
 M[FE_KLININ] = M[FE_KLINOUT] = 0;
 
 M[FE_KEEPA] = INT64_C(0003740000000);                  /* PARITY STOP, CRM, DP PAREN, CACHE EN, 1MSTMR, TRAPEN */
+SIM_DIRTY (FE_KEEPA);                                   /* one page */
 kaf_unit.u3 = 0;
 kaf_unit.u4 = 0;
 apr_flg = apr_flg & ~(APRF_ITC | APRF_CON);
@@ -312,5 +318,6 @@ return SCPE_OK;
 t_stat fe_stop_os (UNIT *uptr, int32 val, char *cptr, void *desc)
 {
 M[FE_SWITCH] = IOBA_RP;                                /* tell OS to stop */
+SIM_DIRTY (FE_SWITCH);
 return SCPE_OK;
 }
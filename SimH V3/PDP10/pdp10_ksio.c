@@ -25,6 +25,7 @@
 
    uba          Unibus adapters
 
+   18-Oct-26    RMS     Added dirty page tracking
    7-Mar-17     RMS     Added BR level to vector display
    27-May-13    RMS     Fixed bugs in Unibus adapter code
    22-Sep-05    RMS     Fixed declarations (from Sterling Garwood)
@@ -1098,6 +1099,7 @@ if (seg) {                                      /* Unaligned head */
     default:
         assert (FALSE);
         }
+    SIM_DIRTY (pa10);
     M[pa10++] = m;
     if (bc == 0) {
         uba_debug_dma_in (dpy_ba, dpy_pa10, pa10-dpy_pa10);
@@ -1124,6 +1126,7 @@ if (seg > 0) {
                 }
             cp = np;
             }
+        SIM_DIRTY (pa10);
         M[pa10++] = (((d10)((buf[1] << 8) | buf[0])) << 18) | /* <0:1,18:19> = 0 */
                            ((buf[3] << 8) | buf[2]);
         buf += 4;
@@ -1176,6 +1179,7 @@ if (bc) {
             assert (FALSE);
             }
         }
+    SIM_DIRTY (pa10);
     M[pa10++] = m;
     }
 
@@ -1232,6 +1236,7 @@ if (seg) {                                      /* Unaligned head */
         uba_debug_dma_nxm ("Write Word", pa10, ba, bc);
         return bc;                              /* return bc */
         }
+    SIM_DIRTY (pa10);
     M[pa10] = (M[pa10] & M_WORD1) | ((d10) (*buf++));
     pa10++;
 
@@ -1261,6 +1266,7 @@ if (seg > 0) {
                 }
             cp = np;
             }
+        SIM_DIRTY (pa10);
         M[pa10++] = (((d10)(buf[0])) << V_WORD0) | buf[1];/* <0:1,18:19> = 0
                                                            * V_WORD1
                                                            */
@@ -1283,6 +1289,7 @@ if (bc) {
             return (bc);                        /* return bc */
             }
         }
+    SIM_DIRTY (pa10);
     if (ubm & UMAP_RRV )                        /* Read reverse preserves RH */
         M[pa10] = (((d10)(buf[0])) << V_WORD0) | (M[pa10] & M_WORD0);
     else
@@ -1344,6 +1351,7 @@ if (seg) {                                      /* Unaligned head */
         uba_debug_dma_nxm ("Write 18b Word", pa10, ba, bc);
         return bc;                              /* return bc */
         }
+    SIM_DIRTY (pa10);
     M[pa10] = (M[pa10] & M_WORD1) | ((d10) (M_WORD18 & *buf++)); /* V_WORD1 */
     pa10++;
 
@@ -1373,6 +1381,7 @@ if (seg > 0) {
                 }
             cp = np;
             }
+        SIM_DIRTY (pa10);
         M[pa10++] = (((d10)(M_WORD18 & buf[0])) << V_WORD0) | (M_WORD18 & buf[1]);/* V_WORD1 */
         buf += 2;
         }
@@ -1393,6 +1402,7 @@ if (bc) {
             return (bc);                        /* return bc */
             }
         }
+    SIM_DIRTY (pa10);
     if (ubm & UMAP_RRV )                        /* Read reverse preserves RH */
         M[pa10] = (M[pa10] & M_WORD0) | (((d10)(M_WORD18 & buf[0])) << V_WORD0);
     else
@@ -1460,6 +1470,7 @@ if (seg > 0) {
                 }
             cp = np;
             }
+        SIM_DIRTY (pa10);
         M[pa10++] = (((d10)(M_WORD18 & buf[0])) << V_WORD0) | (M_WORD18 & buf[1]);/* V_WORD1 */
         buf += 2;
         }
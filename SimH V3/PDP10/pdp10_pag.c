@@ -25,6 +25,7 @@
 
    pag          KS10 pager
 
+   18-Oct-26    RMS     Added dirty page tracking
    22-Sep-05    RMS     Fixed declarations (from Sterling Garwood)
    02-Dec-01    RMS     Fixed bug in ITS LPMR (found by Dave Conroy)
    21-Aug-01    RMS     Fixed bug in ITS paging (found by Miriam Lennox)
@@ -237,7 +238,10 @@ else {
     pa = PAG_XPTEPA (xpte, ea);                         /* calc phys addr */
     if (MEM_ADDR_NXM (pa))                              /* process nxm */
         pag_nxm (pa, REF_V, PF_TR);
-    else M[pa] = val;                                   /* write data */
+    else {
+        M[pa] = val;                                    /* write data */
+        SIM_DIRTY (pa);
+        }
     }
 return;
 }
@@ -248,8 +252,10 @@ int32 pa, vpn, xpte;
 
 if (ea < AC_NUM)                                        /* AC? use current */
     AC(ea) = val;
-else if (!PAGING)                                       /* phys? no mapping */
+else if (!PAGING) {                                     /* phys? no mapping */
     M[ea] = val;
+    SIM_DIRTY (ea);
+    }
 else {
     vpn = PAG_GETVPN (ea);                              /* get page num */
     xpte = eptbl[vpn];                                  /* get exp pte, exec tbl */
@@ -258,7 +264,10 @@ else {
     pa = PAG_XPTEPA (xpte, ea);                         /* calc phys addr */
     if (MEM_ADDR_NXM (pa))                              /* process nxm */
         pag_nxm (pa, REF_V, PF_TR);
-    else M[pa] = val;                                   /* write data */
+    else {
+        M[pa] = val;                                    /* write data */
+        SIM_DIRTY (pa);
+        }
     }
 return;
 }
@@ -271,6 +280,7 @@ else {
     if (MEM_ADDR_NXM (ea))                              /* process nxm */
         pag_nxm (ea, REF_P, PF_TR);
     M[ea] = val;                                        /* memory */
+    SIM_DIRTY (ea);
     }
 return;
 }
@@ -25,6 +25,7 @@
 
    rp           RH/RP/RM moving head disks
 
+   18-Oct-26    RMS     Added dirty page tracking
    13-Mar-17    RMS     Annotated fall through in switch
    17-Mar-13    RMS     Fixed incorrect copy/paste from pdp11_rp.c
    08-Dec-12    RMS     UNLOAD does not set ATTN (Mark Pizzolato)
@@ -1001,8 +1002,10 @@ switch (uptr->FUNC) {                                   /* case on function */
                     break;
                     }
                 if ((uptr->FUNC == FNC_READ) ||         /* read or */
-                    (uptr->FUNC == FNC_READH))          /* read header */
+                    (uptr->FUNC == FNC_READH)) {        /* read header */
                      M[mpa10] = dbuf[twc10];
+                     SIM_DIRTY (mpa10);
+                     }
                 else if (M[mpa10] != dbuf[twc10]) {     /* wchk, mismatch? */
                      rpcs2 = rpcs2 | CS2_WCE;           /* set error */
                      break;
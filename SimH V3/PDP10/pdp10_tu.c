@@ -25,6 +25,7 @@
 
    tu           RH11/TM03/TU45 magtape
 
+   18-Oct-26    RMS     Added dirty page tracking
    26-Mar-22    RMS     Added extra case points for new MTSE definitions
    07-Sep-20    RMS     Fixed || -> | in macro (Mark Pizzolato)
    23-Mar-20    RMS     Unload should call sim_tape_detach (Mark Pizzolato)
@@ -928,8 +929,10 @@ switch (fnc) {                                          /* case on function */
             val = (v[0] << 28) | (v[1] << 20) | (v[2] << 12) | (v[3] << 4);
             if (fmt == TC_10C)
                 val = val | ((d10) xbuf[j++] & 017);
-            if (fnc == FNC_READF)                       /* read? store */
+            if (fnc == FNC_READF) {                     /* read? store */
                 M[mpa10] = val;
+                SIM_DIRTY (mpa10);
+                }
             else if (M[mpa10] != val) {                 /* wchk, mismatch? */
                 tucs2 = tucs2 | CS2_WCE;                /* flag, stop */
                 break;
@@ -989,8 +992,10 @@ switch (fnc) {                                          /* case on function */
             for (k = 0; k < 4; k++)
                 v[k] = xbuf[--j];
             val = val | (v[0] << 4) | (v[1] << 12) | (v[2] << 20) | (v[3] << 28);
-            if (fnc == FNC_READR)                       /* read? store */
+            if (fnc == FNC_READR) {                     /* read? store */
                 M[mpa10] = val;
+                SIM_DIRTY (mpa10);
+                }
             else if (M[mpa10] != val) {                 /* wchk, mismatch? */
                 tucs2 = tucs2 | CS2_WCE;                /* flag, stop */
                 break;
@@ -25,6 +25,14 @@
 
    cpu          PDP-11 CPU
 
+   18-Oct-26    RMS     Freed memory with its mapped length
+   18-Oct-26    RMS     Fixed threaded dispatch of register mode DOPs
+                        Added SHOW CPU PREDECODE
+                        Added dirty page tracking
+                        Exposed memory array for SAVE/RESTORE
+                        Added optional threaded dispatch (PDP11_THREADED)
+                        Allocated memory with sim_mem_alloc
+                        Added PC sampling hook
    04-Feb-23    RMS     WRTLCK reads and tosses destination data
                         Writes must test for aborts before changing CCs
    27-Dec-22    RMS     Vector with T set traps immediately (Walter Mueller)
@@ -268,6 +276,46 @@
 #define HIST_MIN        64
 #define HIST_MAX        (1u << 18)
 #define HIST_VLD        1                               /* make PC odd */
+
+/* Threaded dispatch
+
+   If PDP11_THREADED is defined, each instruction word is first looked up
+   in a predecode table, which gives a handler number and an argument.
+   Instructions that need no operand address calculation - branches, SOB,
+   and register mode word instructions - are executed directly by their
+   handlers, with the decision tree of the full decode (including model
+   tests) already resolved in the table.  All other instructions
+   (PD_DECODE) go through the full decode.  The handler depends only on
+   the instruction word and the CPU model, so the table is indexed by the
+   word and rebuilt only when the model changes; writes to memory never
+   invalidate it.
+*/
+
+#if defined (PDP11_THREADED)
+#define PD_DECODE       0                               /* full decode */
+#define PD_BRANCH       1                               /* branch, arg = cond */
+#define PD_SOB          2                               /* SOB */
+#define PD_CLR          3                               /* register mode SOPs */
+#define PD_COM          4
+#define PD_INC          5
+#define PD_DEC          6
+#define PD_NEG          7
+#define PD_ADC          8
+#define PD_SBC          9
+#define PD_TST          10
+#define PD_MOV          11                              /* R,R DOPs */
+#define PD_CMP          12
+#define PD_BIT          13
+#define PD_BIC          14
+#define PD_BIS          15
+#define PD_ADD          16
+#define PD_SUB          17
+#define PD_N_OPS        18                              /* # handlers */
+#define PD_V_ARG        8                               /* argument */
+#define PD_GETOP(x)     ((x) & 0377)
+#define PD_GETARG(x)    (((x) >> PD_V_ARG) & 0377)
+#define PD_CC           ((N << 3) | (Z << 2) | (V << 1) | C)
+#endif
 #define HIST_ILNT       4                               /* max inst length */
 
 typedef struct {
@@ -283,6 +331,7 @@ typedef struct {
 /* Global state */
 
 uint16 *M = NULL;                                       /* memory */
+size_t M_lnt = 0;                                       /* mapped length of M */
 int32 REGFILE[6][2] = { {0} };                          /* R0-R5, two sets */
 int32 STACKFILE[4] = { 0 };                             /* SP, four modes */
 int32 saved_PC = 0;                                     /* program counter */
@@ -318,6 +367,11 @@ int32 stop_spabort = 1;                                 /* stop on SP abort */
 int32 wait_enable = 0;                                  /* wait state enable */
 int32 autcon_enb = 1;                                   /* autoconfig enable */
 uint32 cpu_model = INIMODEL;                            /* CPU model */
+#if defined (PDP11_THREADED)
+static uint16 cpu_pdt[0200000];                         /* predecode table */
+static uint16 cpu_pd_cond[16];                          /* branch cond, by CC */
+static int32 cpu_pdt_model = -1;                        /* model of table */
+#endif
 uint32 cpu_type = 1u << INIMODEL;                       /* model as bit mask */
 uint32 cpu_opt = INIOPTNS;                              /* CPU options */
 uint16 pcq[PCQ_SIZE] = { 0 };                           /* PC queue */
@@ -337,11 +391,16 @@ extern CPUTAB cpu_tab[];
 t_stat cpu_ex (t_value *vptr, t_addr addr, UNIT *uptr, int32 sw);
 t_stat cpu_dep (t_value val, t_addr addr, UNIT *uptr, int32 sw);
 t_stat cpu_reset (DEVICE *dptr);
+t_addr cpu_sample_pc (uint32 *mode);
 t_stat cpu_set_hist (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, void *desc);
 t_stat cpu_show_virt (FILE *st, UNIT *uptr, int32 val, void *desc);
 int32 GeteaB (int32 spec);
 int32 GeteaW (int32 spec);
+#if defined (PDP11_THREADED)
+void cpu_pdt_build (void);
+t_stat cpu_show_pdt (FILE *st, UNIT *uptr, int32 val, void *desc);
+#endif
 int32 relocR (int32 addr);
 int32 relocW (int32 addr);
 void relocR_test (int32 va, int32 apridx);
@@ -666,6 +725,10 @@ MTAB cpu_mod[] = {
       &cpu_set_hist, &cpu_show_hist },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "VIRTUAL", NULL,
       NULL, &cpu_show_virt },
+#if defined (PDP11_THREADED)
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "PREDECODE", NULL,
+      NULL, &cpu_show_pdt },
+#endif
     { 0 }
     };
 
@@ -700,6 +763,10 @@ if (MEMSIZE >= (cpu_tab[cpu_model].maxm - IOPAGESIZE))  /* mem size >= max - io
     MEMSIZE = cpu_tab[cpu_model].maxm - IOPAGESIZE;     /* max - io page */
 cpu_type = 1u << cpu_model;                             /* reset type mask */
 cpu_bme = (MMR3 & MMR3_BME) && (cpu_opt & OPT_UBM);     /* map enabled? */
+#if defined (PDP11_THREADED)
+if (cpu_pdt_model != (int32) cpu_model)                 /* model changed? */
+    cpu_pdt_build ();                                   /* rebuild predecode */
+#endif
 PC = saved_PC;
 put_PSW (PSW, 0);                                       /* set PSW, call calc_xs */
 for (i = 0; i < 6; i++)
@@ -895,6 +962,163 @@ while (reason == 0)  {
             hst_p = 0;
         }
     PC = (PC + 2) & 0177777;                            /* incr PC, mod 65k */
+
+#if defined (PDP11_THREADED)
+    t = cpu_pdt[IR];                                    /* predecoded */
+    switch (PD_GETOP (t)) {                             /* dispatch */
+
+    case PD_BRANCH:                                     /* branches */
+        if ((cpu_pd_cond[PD_GETARG (t)] >> PD_CC) & 1) {
+            if (IR & 0200) {
+                BRANCH_B (IR);
+                }
+            else {
+                BRANCH_F (IR);
+                }
+            }
+        continue;
+
+    case PD_SOB:                                        /* SOB */
+        srcspec = srcspec & 07;
+        R[srcspec] = (R[srcspec] - 1) & 0177777;
+        if (R[srcspec]) {
+            JMP_PC ((PC - dstspec - dstspec) & 0177777);
+            }
+        continue;
+
+    case PD_CLR:                                        /* CLR R */
+        N = V = C = 0;
+        Z = 1;
+        R[dstspec] = 0;
+        continue;
+
+    case PD_COM:                                        /* COM R */
+        dst = R[dstspec] ^ 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = 0;
+        C = 1;
+        R[dstspec] = dst;
+        continue;
+
+    case PD_INC:                                        /* INC R */
+        dst = (R[dstspec] + 1) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = (dst == 0100000);
+        R[dstspec] = dst;
+        continue;
+
+    case PD_DEC:                                        /* DEC R */
+        dst = (R[dstspec] - 1) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = (dst == 077777);
+        R[dstspec] = dst;
+        continue;
+
+    case PD_NEG:                                        /* NEG R */
+        dst = (-R[dstspec]) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = (dst == 0100000);
+        C = Z ^ 1;
+        R[dstspec] = dst;
+        continue;
+
+    case PD_ADC:                                        /* ADC R */
+        dst = (R[dstspec] + C) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = (C && (dst == 0100000));
+        C = C & Z;
+        R[dstspec] = dst;
+        continue;
+
+    case PD_SBC:                                        /* SBC R */
+        dst = (R[dstspec] - C) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = (C && (dst == 077777));
+        C = (C && (dst == 0177777));
+        R[dstspec] = dst;
+        continue;
+
+    case PD_TST:                                        /* TST R */
+        dst = R[dstspec];
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = C = 0;
+        continue;
+
+    case PD_MOV:                                        /* MOV R,R */
+        dst = R[srcspec];
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = 0;
+        R[dstspec] = dst;
+        continue;
+
+    case PD_CMP:                                        /* CMP R,R */
+        src = R[srcspec];
+        src2 = R[dstspec];
+        dst = (src - src2) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = GET_SIGN_W ((src ^ src2) & (~src2 ^ dst));
+        C = (src < src2);
+        continue;
+
+    case PD_BIT:                                        /* BIT R,R */
+        dst = R[dstspec] & R[srcspec];
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = 0;
+        continue;
+
+    case PD_BIC:                                        /* BIC R,R */
+        dst = R[dstspec] & ~R[srcspec];
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = 0;
+        R[dstspec] = dst;
+        continue;
+
+    case PD_BIS:                                        /* BIS R,R */
+        dst = R[dstspec] | R[srcspec];
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = 0;
+        R[dstspec] = dst;
+        continue;
+
+    case PD_ADD:                                        /* ADD R,R */
+        src = R[srcspec];
+        src2 = R[dstspec];
+        dst = (src2 + src) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = GET_SIGN_W ((~src ^ src2) & (src ^ dst));
+        C = (dst < src);
+        R[dstspec] = dst;
+        continue;
+
+    case PD_SUB:                                        /* SUB R,R */
+        src = R[srcspec];
+        src2 = R[dstspec];
+        dst = (src2 - src) & 0177777;
+        N = GET_SIGN_W (dst);
+        Z = GET_Z (dst);
+        V = GET_SIGN_W ((src ^ src2) & (~src ^ dst));
+        C = (src2 < src);
+        R[dstspec] = dst;
+        continue;
+
+    default:                                            /* PD_DECODE */
+        break;
+        }
+#endif
+
     switch ((IR >> 12) & 017) {                         /* decode IR<15:12> */
 
 /* Opcode 0: no operands, specials, branches, JSR, SOPs */
@@ -3104,6 +3328,99 @@ else if (CPUT (HAS_STKLR)) {                            /* register limit? */
 return;                                                 /* no stack limit */
 }
 
+/* Build threaded dispatch table for the current model */
+
+#if defined (PDP11_THREADED)
+
+void cpu_pdt_build (void)
+{
+uint32 ir, cc, n, z, v, c, tk;
+uint16 pd;
+static const uint16 dop[8] = {
+    PD_DECODE, PD_MOV, PD_CMP, PD_BIT, PD_BIC, PD_BIS, PD_ADD, PD_DECODE
+    };
+static const uint16 sop[8] = {
+    PD_CLR, PD_COM, PD_INC, PD_DEC, PD_NEG, PD_ADC, PD_SBC, PD_TST
+    };
+
+for (ir = 0; ir < 16; ir++)
+    cpu_pd_cond[ir] = 0;
+for (cc = 0; cc < 16; cc++) {                           /* branch cond x CC */
+    n = (cc >> 3) & 1;
+    z = (cc >> 2) & 1;
+    v = (cc >> 1) & 1;
+    c = cc & 1;
+    for (ir = 0; ir < 16; ir++) {
+        switch (ir) {
+        case 001: tk = 1; break;                        /* BR */
+        case 002: tk = (z == 0); break;                 /* BNE */
+        case 003: tk = z; break;                        /* BEQ */
+        case 004: tk = ((n ^ v) == 0); break;           /* BGE */
+        case 005: tk = (n ^ v); break;                  /* BLT */
+        case 006: tk = ((z | (n ^ v)) == 0); break;     /* BGT */
+        case 007: tk = (z | (n ^ v)); break;            /* BLE */
+        case 010: tk = (n == 0); break;                 /* BPL */
+        case 011: tk = n; break;                        /* BMI */
+        case 012: tk = ((c | z) == 0); break;           /* BHI */
+        case 013: tk = (c | z); break;                  /* BLOS */
+        case 014: tk = (v == 0); break;                 /* BVC */
+        case 015: tk = v; break;                        /* BVS */
+        case 016: tk = (c == 0); break;                 /* BCC */
+        case 017: tk = c; break;                        /* BCS */
+        default: tk = 0; break;
+            }
+        if (tk)
+            cpu_pd_cond[ir] = cpu_pd_cond[ir] | (1u << cc);
+        }
+    }
+for (ir = 0; ir < 0200000; ir++) {                      /* instructions */
+    pd = PD_DECODE;
+    if (((ir & 0074000) == 0) &&                        /* branch? */
+        ((ir & 0100000) || (ir & 0003400)))
+        pd = PD_BRANCH | ((((ir >> 8) & 07) | ((ir >> 12) & 010)) << PD_V_ARG);
+    else if ((ir & 0177000) == 0077000) {               /* SOB */
+        if (CPUT (HAS_SXS))
+            pd = PD_SOB;
+        }
+    else if (((ir & 0177000) == 0005000) &&             /* SOP, mode 0 */
+        ((ir & 0000070) == 0))
+        pd = sop[(ir >> 6) & 07];
+    else if (((ir & 0007070) == 0) && ((ir & 0170000) != 0)) {
+        if ((ir & 0100000) == 0)                        /* DOP word R,R */
+            pd = dop[(ir >> 12) & 07];
+        else if ((ir & 0170000) == 0160000)             /* SUB R,R */
+            pd = PD_SUB;
+        }
+    cpu_pdt[ir] = pd;
+    }
+cpu_pdt_model = cpu_model;
+return;
+}
+
+/* Show threaded dispatch table, as the number of instruction words
+   assigned to each handler */
+
+t_stat cpu_show_pdt (FILE *st, UNIT *uptr, int32 val, void *desc)
+{
+uint32 ir, op, cnt[PD_N_OPS];
+static const char *pdname[PD_N_OPS] = {
+    "DECODE", "BRANCH", "SOB", "CLR", "COM", "INC", "DEC", "NEG", "ADC",
+    "SBC", "TST", "MOV", "CMP", "BIT", "BIC", "BIS", "ADD", "SUB"
+    };
+
+if (cpu_pdt_model != (int32) cpu_model)                 /* model changed? */
+    cpu_pdt_build ();
+for (op = 0; op < PD_N_OPS; op++)
+    cnt[op] = 0;
+for (ir = 0; ir < 0200000; ir++)
+    cnt[PD_GETOP (cpu_pdt[ir])]++;
+for (op = 0; op < PD_N_OPS; op++)
+    fprintf (st, "%-8s%6d\n", pdname[op], cnt[op]);
+return SCPE_OK;
+}
+
+#endif
+
 /* Reset routine */
 
 t_stat cpu_reset (DEVICE *dptr)
@@ -3119,19 +3436,33 @@ MMR2 = 0;
 MMR3 = 0;
 trap_req = 0;
 wait_state = 0;
-if (M == NULL)
-    M = (uint16 *) calloc (MEMSIZE >> 1, sizeof (uint16));
-if (M == NULL)
+if (M == NULL) {
+    M = (uint16 *) sim_mem_alloc ((size_t) MEMSIZE);
+    if (M == NULL)
+        return SCPE_MEM;
+    M_lnt = (size_t) MEMSIZE;
+    }
+cpu_unit.filebuf = M;                                   /* for SAVE/RESTORE */
+if (sim_dirty_setup (&cpu_unit, MEM_N_DIRTY) != SCPE_OK) /* dirty page map */
     return SCPE_MEM;
 pcq_r = find_reg ("PCQ", NULL, dptr);
 if (pcq_r)
     pcq_r->qptr = 0;
 else return SCPE_IERR;
 sim_brk_types = sim_brk_dflt = SWMASK ('E');
+sim_vm_sample_pc = &cpu_sample_pc;
 set_r_display (0, MD_KER);
 return build_dib_tab ();
 }
 
+/* PC sampling - PC is live in R[7] during sim_instr */
+
+t_addr cpu_sample_pc (uint32 *mode)
+{
+*mode = (uint32) cm;
+return (t_addr) (PC & 0177777);
+}
+
 /* Boot setup routine */
 
 void cpu_set_boot (int32 pc)
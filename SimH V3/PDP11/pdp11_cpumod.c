@@ -25,6 +25,10 @@
 
    system       PDP-11 model-specific registers
 
+   18-Oct-26    RMS     Freed memory with its mapped length
+   18-Oct-26    RMS     Added dirty page tracking
+                        Exposed memory array for SAVE/RESTORE
+                        Allocated memory with sim_mem_alloc
    19-Nov-22    RMS     Fixed byte access errors in PIRQ, STKLIM, CDR (Walter Mueller)
    15-Sep-20    RMS     Fixed problem in KDJ11E programmable clock (Paul Koning)
    04-Mar-16    RMS     Fixed maximum memory sizes to exclude IO page
@@ -97,6 +101,7 @@ uint8 toy_data[TOY_LNT] = { 0 };
 static int32 clk_tps_map[4] = { 0, 50, 60, 800 };       /* 0 = use BEVENT */
 
 extern uint16 *M;
+extern size_t M_lnt;
 extern int32 R[8];
 extern DEVICE cpu_dev;
 extern UNIT cpu_unit;
@@ -1187,15 +1192,19 @@ for (i = val; i < MEMSIZE; i = i + 2)
     mc = mc | M[i >> 1];
 if ((mc != 0) && !get_yn ("Really truncate memory [N]?", FALSE))
     return SCPE_OK;
-nM = (uint16 *) calloc (val >> 1, sizeof (uint16));
+nM = (uint16 *) sim_mem_alloc (val);
 if (nM == NULL)
     return SCPE_MEM;
 clim = (((t_addr) val) < MEMSIZE)? (uint32)val: MEMSIZE;
 for (i = 0; i < clim; i = i + 2)
     nM[i >> 1] = M[i >> 1];
-free (M);
+sim_mem_free (M, M_lnt);                                /* free mapped length */
 M = nM;
+M_lnt = (size_t) val;
+cpu_unit.filebuf = M;                                   /* for SAVE/RESTORE */
 MEMSIZE = val;
+if (sim_dirty_setup (&cpu_unit, MEM_N_DIRTY) != SCPE_OK) /* resize dirty map */
+    return SCPE_MEM;
 if (!(sim_switches & SIM_SW_REST))                      /* unless restore, */
     cpu_set_bus (cpu_opt);                              /* alter periph config */
 return SCPE_OK;
@@ -26,6 +26,7 @@
    The author gratefully acknowledges the help of Max Burnet, Megan Gentry,
    and John Wilson in resolving questions about the PDP-11
 
+   18-Oct-26    RMS     Added dirty page tracking
    12-May-23    RMS     Added fourth Massbus adapter
    23-Oct-22    RMS     Moved NXM abort priority above MME trap priority
    25-Jul-22    RMS     Removed OPT_RH11 (Mark Pizzolato)
@@ -111,6 +112,7 @@
 #define MAXMEMSIZE      020000000                       /* 2**22 */
 #define PAMASK          (MAXMEMSIZE - 1)                /* 2**22 - 1 */
 #define MEMSIZE         (cpu_unit.capac)
+#define MEM_N_DIRTY     9                               /* log2 dirty page size */
 #define DMASK           0177777
 
 /* CPU models */
@@ -930,10 +932,11 @@ int32 Map_Write18 (uint32 ba, int32 bc, uint32 *buf);
 
 #define RdMemW(pa)      (M[(pa) >> 1])
 #define RdMemB(pa)      ((((pa) & 1)? M[(pa) >> 1] >> 8: M[(pa) >> 1]) & 0377)
-#define WrMemW(pa,d)    M[(pa) >> 1] = (d)
+#define WrMemW(pa,d)    M[(pa) >> 1] = (d), SIM_DIRTY (pa)
 #define WrMemB(pa,d)    M[(pa) >> 1] = ((pa) & 1)? \
                             ((M[(pa) >> 1] & 0377) | (((d) & 0377) << 8)): \
-                            ((M[(pa) >> 1] & ~0377) | ((d) & 0377))
+                            ((M[(pa) >> 1] & ~0377) | ((d) & 0377)), \
+                        SIM_DIRTY (pa)
 
 #endif
 
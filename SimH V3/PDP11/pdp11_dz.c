@@ -25,6 +25,7 @@
 
    dz           DZ11 terminal multiplexor
 
+   18-Oct-26    RMS     Poll interval stretches while all lines are idle
    23-Feb-23    RMS     Fixed line number calculation in connect (Walter Mueller)
    29-Dec-08    RMS     Added MTAB_NC to SET LOG command (Walter Mueller)
    19-Nov-08    RMS     Revised for common TMXR show routines
@@ -387,7 +388,9 @@ return SCPE_OK;
    The DZ11 polls to see if asynchronous activity has occurred and now
    needs to be processed.  The polling interval is controlled by the clock
    simulator, so for most environments, it is calibrated to real time.
-   Typical polling intervals are 50-60 times per second.
+   Typical polling intervals are 50-60 times per second.  While no line
+   has a new connection, input, or output, the interval stretches by whole
+   clock ticks (see tmxr_poll_scale).
 
    The simulator assumes that software enables all of the multiplexors,
    or none of them.
@@ -412,7 +415,8 @@ if (t) {                                                /* any enabled? */
     dz_update_rcvi ();                                  /* upd rcv intr */
     tmxr_poll_tx (&dz_desc);                            /* poll output */
     dz_update_xmti ();                                  /* upd xmt intr */
-    sim_activate (uptr, clk_cosched (tmxr_poll));       /* reactivate */
+    t = tmxr_poll_scale (&dz_desc, tmxr_poll) - tmxr_poll; /* idle stretch */
+    sim_activate (uptr, clk_cosched (tmxr_poll) + t);   /* reactivate */
     }
 return SCPE_OK;
 }
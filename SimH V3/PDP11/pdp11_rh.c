@@ -25,6 +25,7 @@
 
    rha, rhb, rhc, rhd   RH11/RH70 Massbus adapter
 
+   18-Oct-26    RMS     Added dirty page tracking
    12-May-23    RMS     Added fourth adapter
    25-Jul-22    RMS     Removed OPT_RH11, changed adapter type test
    02-Sep-13    RMS     Added third Massbus adapter, debug printouts
@@ -651,6 +652,7 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
         pbc = bc - i;
     for (j = 0; j < pbc; j = j + 2) {                   /* loop by words */
         M[pa >> 1] = *buf++;                            /* put word */
+        SIM_DIRTY (pa);
         if (!(massbus[mb].cs2 & CS2_UAI)) {             /* if not inhb */
             ba = ba + 2;                                /* incr ba, pa */
             pa = pa + 2;
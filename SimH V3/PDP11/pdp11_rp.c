@@ -25,6 +25,7 @@
 
    rp           RH/RP/RM moving head disks
 
+   18-Oct-26    RMS     Added direct transfers to and from mapped images
    13-Mar-17    RMS     Annotated intentional fall through in switch
    23-Oct-13    RMS     Revised for new boot setup routine
    08-Dec-12    RMS     UNLOAD shouldn't set ATTN (Mark Pizzolato)
@@ -783,6 +784,7 @@ t_stat rp_svc (UNIT *uptr)
 {
 int32 i, fnc, dtype, drv, err;
 int32 wc, abc, awc, mbc, da;
+uint16 *xb, *mp;
 
 dtype = GET_DTYPE (uptr->flags);                        /* get drive type */
 drv = (int32) (uptr - rp_dev.units);                    /* get drv number */
@@ -829,7 +831,6 @@ switch (fnc) {                                          /* case on function */
     case FNC_WCHK:                                      /* write check */
     case FNC_READ:                                      /* read */
     case FNC_READH:                                     /* read headers */
-        err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
         mbc = mba_get_bc (rp_dib.ba);                   /* get byte count */
         wc = (mbc + 1) >> 1;                            /* convert to words */
         if ((da + wc) > drv_tab[dtype].size) {          /* disk overrun? */
@@ -842,25 +843,38 @@ switch (fnc) {                                          /* case on function */
                 break;
                 }
             }
+        awc = (wc + (RP_NUMWD - 1)) & ~(RP_NUMWD - 1);  /* whole sectors */
+        mp = sim_end? (uint16 *) sim_fmap_ptr (uptr,    /* mapped image? */
+            ((t_offset) da) * sizeof (int16), awc * sizeof (int16)): NULL;
+        if (mp != NULL) {                               /* yes, use directly */
+            xb = mp;
+            err = 0;
+            }
+        else {                                          /* no, use file */
+            xb = rpxb;
+            err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
+            }
         if (fnc == FNC_WRITE) {                         /* write? */
-            abc = mba_rdbufW (rp_dib.ba, mbc, rpxb);    /* get buffer */
+            abc = mba_rdbufW (rp_dib.ba, mbc, xb);      /* get buffer */
             wc = (abc + 1) >> 1;                        /* actual # wds */
             awc = (wc + (RP_NUMWD - 1)) & ~(RP_NUMWD - 1);
             for (i = wc; i < awc; i++)                  /* fill buf */
-                rpxb[i] = 0;
-            if (wc && !err) {                           /* write buf */
-                fxwrite (rpxb, sizeof (uint16), awc, uptr->fileref);
+                xb[i] = 0;
+            if (wc && !err && (mp == NULL)) {           /* write buf */
+                fxwrite (xb, sizeof (uint16), awc, uptr->fileref);
                 err = ferror (uptr->fileref);
                 }
             }                                           /* end if wr */
         else {                                          /* read or wchk */
-            awc = fxread (rpxb, sizeof (uint16), wc, uptr->fileref);
-            err = ferror (uptr->fileref);
-            for (i = awc; i < wc; i++)                  /* fill buf */
-                rpxb[i] = 0;
+            if (mp == NULL) {                           /* file? */
+                awc = fxread (xb, sizeof (uint16), wc, uptr->fileref);
+                err = ferror (uptr->fileref);
+                for (i = awc; i < wc; i++)              /* fill buf */
+                    xb[i] = 0;
+                }
             if (fnc == FNC_WCHK)                        /* write check? */
-                mba_chbufW (rp_dib.ba, mbc, rpxb);      /* check vs mem */
-            else mba_wrbufW (rp_dib.ba, mbc, rpxb);     /* store in mem */
+                mba_chbufW (rp_dib.ba, mbc, xb);        /* check vs mem */
+            else mba_wrbufW (rp_dib.ba, mbc, xb);       /* store in mem */
             }                                           /* end if read */
         da = da + wc + (RP_NUMWD - 1);
         if (da >= drv_tab[dtype].size)
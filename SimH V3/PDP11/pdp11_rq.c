@@ -26,6 +26,8 @@
 
    rq           RQDX3 disk controller
 
+   18-Oct-26    RMS     Added direct transfers to and from mapped images
+                        Added asynchronous data transfers, per-drive buffers
    06=Mar-22    RMS     Added more disk types (Mark Pizzolato)
    31-Jan-21    RMS     Revised for new register macros
    28-May-18    RMS     Changed to avoid nested comment warnings (Mark Pizzolato)
@@ -143,6 +145,7 @@ extern uint32 cpu_opt;
 #define pktq            u4                              /* packet queue */
 #define uf              buf                             /* settable unit flags */
 #define cnum            wait                            /* controller index */
+#define RQ_AIO(u)       (&rq_aio[(u)->cnum][(u) - rq_devmap[(u)->cnum]->units])
 #define UNIT_WPRT       (UNIT_WLK | UNIT_RO)            /* write prot */
 #define RQ_RMV(u)       ((drv_tab[GET_DTYPE (u->flags)].flgs & RQDF_RMV)? \
                         UF_RMV: 0)
@@ -796,7 +799,7 @@ extern int32 int_req[IPL_HLVL];
 extern int32 tmr_poll, clk_tps;
 extern UNIT cpu_unit;
 
-uint16 *rqxb = NULL;                                    /* xfer buffer */
+SIM_AIO rq_aio[RQ_NUMCT][RQ_NUMDR];                     /* xfer requests */
 int32 rq_itime = 200;                                   /* init time, except */
 int32 rq_itime4 = 10;                                   /* stage 4 */
 int32 rq_qtime = RQ_QTIME;                              /* queue time */
@@ -870,6 +873,7 @@ t_bool rq_getdesc (MSC *cp, struct uq_ring *ring, uint32 *desc);
 t_bool rq_putdesc (MSC *cp, struct uq_ring *ring, uint32 desc);
 int32 rq_rw_valid (MSC *cp, int32 pkt, UNIT *uptr, uint32 cmd);
 t_bool rq_rw_end (MSC *cp, UNIT *uptr, uint32 flg, uint32 sts);
+t_stat rq_rw_done (MSC *cp, UNIT *uptr, SIM_AIO *aio, uint16 *xb);
 void rq_putr (MSC *cp, int32 pkt, uint32 cmd, uint32 flg,
     uint32 sts, uint32 lnt, uint32 typ);
 void rq_putr_unit (MSC *cp, int32 pkt, UNIT *uptr, uint32 lu, t_bool all);
@@ -1605,6 +1609,7 @@ if (uptr = rq_getucb (cp, lu)) {                        /* get unit */
         (GETP32 (uptr->cpkt, CMD_REFL) == ref)) {       /* match ref? */
         tpkt = uptr->cpkt;                              /* save match */
         uptr->cpkt = 0;                                 /* gonzo */
+        sim_aio_cancel (RQ_AIO (uptr));                 /* finish xfer */
         sim_cancel (uptr);                              /* cancel unit */
         sim_activate (dptr->units + RQ_QUEUE, rq_qtime);
         }
@@ -1923,14 +1928,26 @@ if ((cmd == OP_WR) || (cmd == OP_ERS)) {                /* write op? */
 return 0;                                               /* success! */
 }
 
-/* Unit service for data transfer commands */
+/* Unit service for data transfer commands
+
+   The transfer is done in two steps.  First, the file transfer is set up
+   and started as an asynchronous I/O request.  If the request is queued,
+   the unit is reactivated when it completes; otherwise, it is complete on
+   return.  Second, rq_rw_done moves the data to or from memory, and
+   either schedules the next transfer or ends the command.
+
+   If the image is mapped to memory, the drive buffer is the image itself:
+   the file transfer step is skipped, and the data moves directly between
+   the image and memory.
+*/
 
 t_stat rq_svc (UNIT *uptr)
 {
 MSC *cp = rq_ctxmap[uptr->cnum];
-
+SIM_AIO *aio = RQ_AIO (uptr);
+uint16 *xb = (uint16 *) aio->buf;                       /* drive buffer */
+uint16 *mp;
 uint32 i, t, tbc, abc, wwc;
-uint32 err = 0;
 int32 pkt = uptr->cpkt;                                 /* get packet */
 uint32 cmd = GETP (pkt, CMD_OPC, OPC);                  /* get cmd */
 uint32 ba = GETP32 (pkt, RW_WBAL);                      /* buf addr */
@@ -1940,6 +1957,8 @@ t_addr da = ((t_addr) bl) * RQ_NUMBY;                   /* disk addr */
 
 if ((cp == NULL) || (pkt == 0))                         /* what??? */
     return STOP_RQ;
+if (aio->state == AIO_DONE)                             /* xfer complete? */
+    return rq_rw_done (cp, uptr, aio, xb);
 tbc = (bc > RQ_MAXFR)? RQ_MAXFR: bc;                    /* trim cnt to max */
 
 if ((uptr->flags & UNIT_ATT) == 0) {                    /* not attached? */
@@ -1962,46 +1981,78 @@ if ((cmd == OP_ERS) || (cmd == OP_WR)) {                /* write op? */
         }
     }
 
+wwc = ((tbc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
+mp = sim_end? (uint16 *) sim_fmap_ptr (uptr, (t_offset) da, wwc << 1): NULL;
+if (mp != NULL)                                         /* mapped image? */
+    xb = mp;                                            /* use directly */
+aio->uptr = uptr;                                       /* set up xfer */
+aio->pos = (t_offset) da;
+aio->size = sizeof (int16);
 if (cmd == OP_ERS) {                                    /* erase? */
-    wwc = ((tbc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
     for (i = 0; i < wwc; i++)                           /* clr buf */
-        rqxb[i] = 0;
-    err = sim_fseek (uptr->fileref, da, SEEK_SET);      /* set pos */
-    if (!err)
-        sim_fwrite (rqxb, sizeof (int16), wwc, uptr->fileref);
-    err = ferror (uptr->fileref);                       /* end if erase */
+        xb[i] = 0;
+    aio->op = AIO_WRITE;
+    aio->count = wwc;
     }
 
 else if (cmd == OP_WR) {                                /* write? */
-    t = Map_ReadW (ba, tbc, rqxb);                      /* fetch buffer */
-    if (abc = tbc - t) {                                /* any xfer? */
-        wwc = ((abc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
-        for (i = (abc >> 1); i < wwc; i++)
-            rqxb[i] = 0;
-        err = sim_fseek (uptr->fileref, da, SEEK_SET);
-        if (!err)
-            sim_fwrite (rqxb, sizeof (int16), wwc, uptr->fileref);
-        err = ferror (uptr->fileref);
-        }
+    t = Map_ReadW (ba, tbc, xb);                        /* fetch buffer */
     if (t) {                                            /* nxm? */
+        if (abc = tbc - t) {                            /* any xfer? */
+            wwc = ((abc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
+            for (i = (abc >> 1); i < wwc; i++)
+                xb[i] = 0;
+            if ((mp == NULL) &&                         /* not mapped? */
+                (sim_fseek (uptr->fileref, da, SEEK_SET) == 0))
+                sim_fwrite (xb, sizeof (int16), wwc, uptr->fileref);
+            }
         PUTP32 (pkt, RW_WBCL, bc - abc);                /* adj bc */
         PUTP32 (pkt, RW_WBAL, ba + abc);                /* adj ba */
         if (rq_hbe (cp, uptr))                          /* post err log */
             rq_rw_end (cp, uptr, EF_LOG, ST_HST | SB_HST_NXM);  
         return SCPE_OK;                                 /* end else wr */
         }
+    for (i = (tbc >> 1); i < wwc; i++)
+        xb[i] = 0;
+    aio->op = AIO_WRITE;
+    aio->count = wwc;
     }
 
-else {
-    err = sim_fseek (uptr->fileref, da, SEEK_SET);      /* set pos */
+else {                                                  /* read, compare */
+    aio->op = AIO_READ;
+    aio->count = tbc >> 1;
+    }
+
+if (mp != NULL) {                                       /* mapped? */
+    aio->xfer = aio->count;                             /* already done */
+    aio->err = 0;
+    }
+else if (sim_aio_start (aio))                           /* queued? */
+    return SCPE_OK;                                     /* wait for done */
+return rq_rw_done (cp, uptr, aio, xb);
+}
+
+/* Data transfer complete - finish read or compare, advance to next */
+
+t_stat rq_rw_done (MSC *cp, UNIT *uptr, SIM_AIO *aio, uint16 *xb)
+{
+uint32 i, t, tbc;
+uint32 err = aio->err;
+int32 pkt = uptr->cpkt;                                 /* get packet */
+uint32 cmd = GETP (pkt, CMD_OPC, OPC);                  /* get cmd */
+uint32 ba = GETP32 (pkt, RW_WBAL);                      /* buf addr */
+uint32 bc = GETP32 (pkt, RW_WBCL);                      /* byte count */
+uint32 bl = GETP32 (pkt, RW_WBLL);                      /* block addr */
+
+aio->state = AIO_IDLE;                                  /* request free */
+tbc = (bc > RQ_MAXFR)? RQ_MAXFR: bc;                    /* trim cnt to max */
+if ((cmd != OP_ERS) && (cmd != OP_WR)) {                /* read, compare? */
     if (!err) {
-        i = sim_fread (rqxb, sizeof (int16), tbc >> 1, uptr->fileref);
-        for ( ; i < (tbc >> 1); i++)                    /* fill */
-            rqxb[i] = 0;
-        err = ferror (uptr->fileref);
+        for (i = aio->xfer; i < (tbc >> 1); i++)        /* fill */
+            xb[i] = 0;
         }
     if ((cmd == OP_RD) && !err) {                       /* read? */
-        if (t = Map_WriteW (ba, tbc, rqxb)) {           /* store, nxm? */
+        if (t = Map_WriteW (ba, tbc, xb)) {             /* store, nxm? */
             PUTP32 (pkt, RW_WBCL, bc - (tbc - t));      /* adj bc */
             PUTP32 (pkt, RW_WBAL, ba + (tbc - t));      /* adj ba */
             if (rq_hbe (cp, uptr))                      /* post err log */
@@ -2019,7 +2070,7 @@ else {
                     rq_rw_end (cp, uptr, EF_LOG, ST_HST | SB_HST_NXM);
                 return SCPE_OK;
                 }
-            dby = (rqxb[i >> 1] >> ((i & 1)? 8: 0)) & 0xFF;
+            dby = (xb[i >> 1] >> ((i & 1)? 8: 0)) & 0xFF;
             if (mby != dby) {                           /* cmp err? */
                 PUTP32 (pkt, RW_WBCL, bc - i);          /* adj bc */
                 rq_rw_end (cp, uptr, 0, ST_CMP);        /* done */
@@ -2027,7 +2078,7 @@ else {
                 }                                       /* end if */
             }                                           /* end for */
         }                                               /* end else if */
-    }                                                   /* end else read */
+    }                                                   /* end if read */
 if (err != 0) {                                         /* error? */
     if (rq_dte (cp, uptr, ST_DRV))                      /* post err log */
         rq_rw_end (cp, uptr, EF_LOG, ST_DRV);           /* if ok, report err */
@@ -2593,6 +2644,8 @@ t_stat rq_detach (UNIT *uptr)
 {
 t_stat r;
 
+if (uptr->flags & UNIT_ATT)                             /* attached? */
+    sim_aio_cancel (RQ_AIO (uptr));                     /* finish xfer */
 r = detach_unit (uptr);                                 /* detach unit */
 if (r != SCPE_OK)
     return r;
@@ -2652,16 +2705,19 @@ cp->pip = 0;                                            /* not polling */
 rq_clrint (cp);                                         /* clr intr req */
 for (i = 0; i < (RQ_NUMDR + 2); i++) {                  /* init units */
     uptr = dptr->units + i;
+    if (i < RQ_NUMDR) {                                 /* drive? */
+        sim_aio_cancel (&rq_aio[cidx][i]);              /* finish xfer */
+        if (rq_aio[cidx][i].buf == NULL)                /* alloc buffer */
+            rq_aio[cidx][i].buf = calloc (RQ_MAXFR >> 1, sizeof (uint16));
+        if (rq_aio[cidx][i].buf == NULL)
+            return SCPE_MEM;
+        }
     sim_cancel (uptr);                                  /* clr activity */
     uptr->cnum = cidx;                                  /* set ctrl index */
     uptr->flags = uptr->flags & ~(UNIT_ONL | UNIT_ATP);
     uptr->uf = 0;                                       /* clr unit flags */
     uptr->cpkt = uptr->pktq = 0;                        /* clr pkt q's */
     }
-if (rqxb == NULL)
-    rqxb = (uint16 *) calloc (RQ_MAXFR >> 1, sizeof (uint16));
-if (rqxb == NULL)
-    return SCPE_MEM;
 return auto_config (0, 0);                              /* run autoconfig */
 }
 
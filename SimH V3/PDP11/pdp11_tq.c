@@ -25,6 +25,7 @@
 
    tq           TQK50 tape controller
 
+   18-Oct-26    RMS     Added asynchronous record read/write, per-drive buffers
    26-Mar-22    RMS     Added extra case points for new MTSE definitions
    31-Jan-21    RMS     Revised for new register macros
    28-May-18    RMS     Changed to avoid nested comment warnings (Mark Pizzolato)
@@ -121,6 +122,7 @@ extern uint32 cpu_opt;
 #define pktq            u4                              /* packet queue */
 #define uf              buf                             /* settable unit flags */
 #define objp            wait                            /* object position */
+#define TQ_AIO(u)       (&tq_aio[(u) - tq_dev.units])
 #define TQ_WPH(u)       ((sim_tape_wrp (u))? UF_WPH: 0)
 
 #define CST_S1          0                               /* init stage 1 */
@@ -244,7 +246,7 @@ static struct drvtyp drv_tab[] = {
 extern int32 int_req[IPL_HLVL];
 extern int32 tmr_poll, clk_tps;
 
-uint8 *tqxb = NULL;                                     /* xfer buffer */
+SIM_AIO tq_aio[TQ_NUMDR];                               /* xfer requests */
 uint32 tq_sa = 0;                                       /* status, addr */
 uint32 tq_saw = 0;                                      /* written data */
 uint32 tq_s1dat = 0;                                    /* S1 data */
@@ -380,7 +382,7 @@ t_bool tq_una (UNIT *uptr);
 uint32 tq_map_status (UNIT *uptr, t_stat st);
 uint32 tq_spacef (UNIT *uptr, uint32 cnt, uint32 *skipped, t_bool qrec);
 uint32 tq_skipff (UNIT *uptr, uint32 cnt, uint32 *skipped);
-uint32 tq_rdbuff (UNIT *uptr, t_mtrlnt *tbc);
+uint32 tq_rdbuff (UNIT *uptr, t_stat st);
 uint32 tq_spacer (UNIT *uptr, uint32 cnt, uint32 *skipped, t_bool qrec);
 uint32 tq_skipfr (UNIT *uptr, uint32 cnt, uint32 *skipped);
 uint32 tq_rdbufr (UNIT *uptr, t_mtrlnt *tbc);
@@ -866,6 +868,7 @@ if (uptr = tq_getucb (lu)) {                            /* get unit */
         (GETP32 (uptr->cpkt, CMD_REFL) == ref)) {       /* match ref? */
         tpkt = uptr->cpkt;                              /* save match */
         uptr->cpkt = 0;                                 /* gonzo */
+        sim_aio_cancel (TQ_AIO (uptr));                 /* finish xfer */
         sim_cancel (uptr);                              /* cancel unit */
         sim_activate (&tq_unit[TQ_QUEUE], tq_qtime);
         }
@@ -1197,10 +1200,17 @@ if (tq_cmf[cmd] & CMF_WR) {                             /* write op? */
 return ST_SUC;                                          /* success! */
 }
 
-/* Unit service for motion commands */
+/* Unit service for motion commands
+
+   Forward reads and writes are started as asynchronous I/O requests.  If
+   the request is queued, the unit is reactivated in state AIO_DONE when it
+   completes, and the command picks up where it left off.
+*/
 
 t_stat tq_svc (UNIT *uptr)
 {
+SIM_AIO *aio = TQ_AIO (uptr);
+uint8 *xb = (uint8 *) aio->buf;                         /* drive buffer */
 uint32 t, sts, sktmk, skrec;
 t_mtrlnt i, tbc, wbc;
 int32 pkt = uptr->cpkt;                                 /* get packet */
@@ -1218,7 +1228,8 @@ if ((uptr->flags & UNIT_ATT) == 0) {                    /* not attached? */
     return SCPE_OK;
     }
 
-if (tq_cmf[cmd] & CMF_WR) {                             /* write op? */
+if ((tq_cmf[cmd] & CMF_WR) &&                           /* write op, */
+    (aio->state != AIO_DONE)) {                         /* not complete? */
     if (TQ_WPH (uptr)) {                                /* hwre write prot? */
         uptr->flags = uptr->flags | UNIT_SXC;           /* set ser exc */
         tq_mot_end (uptr, 0, ST_WPR | SB_WPR_HW, 0);
@@ -1237,7 +1248,14 @@ switch (cmd) {                                          /* case on command */
     case OP_RD:case OP_ACC:case OP_CMP:                 /* read-like op */
         if (mdf & MD_REV)                               /* read record */
             sts = tq_rdbufr (uptr, &tbc);
-        else sts = tq_rdbuff (uptr, &tbc);
+        else {
+            if ((aio->state != AIO_DONE) &&             /* start read fwd */
+                sim_tape_rdrecf_a (uptr, aio, xb, MT_MAXFR))
+                return SCPE_OK;                         /* queued, wait */
+            aio->state = AIO_IDLE;                      /* read complete */
+            tbc = (t_mtrlnt) aio->xfer;
+            sts = tq_rdbuff (uptr, aio->stat);
+            }
         if (sts == ST_DRV) {                            /* read error? */
             PUTP32 (pkt, RW_BCL, 0);                    /* no bytes processed */
             return tq_mot_err (uptr, tbc);              /* log, done */
@@ -1255,7 +1273,7 @@ switch (cmd) {                                          /* case on command */
             }
         else wbc = tbc;
         if (cmd == OP_RD) {                             /* read? */
-            if (t = Map_WriteB (ba, wbc, tqxb)) {       /* store, nxm? */
+            if (t = Map_WriteB (ba, wbc, xb)) {         /* store, nxm? */
                 PUTP32 (pkt, RW_BCL, wbc - t);          /* adj bc */
                 if (tq_hbe (uptr, ba + wbc - t))        /* post err log */
                     tq_mot_end (uptr, EF_LOG, ST_HST | SB_HST_NXM, tbc);        
@@ -1268,11 +1286,11 @@ switch (cmd) {                                          /* case on command */
             for (i = 0; i < wbc; i++) {                 /* loop */
                 if (mdf & MD_REV) {                     /* reverse? */
                     mba = ba + bc - 1 - i;              /* mem addr */
-                    dby = tqxb[tbc - 1 - i];            /* byte */
+                    dby = xb[tbc - 1 - i];              /* byte */
                     }
                 else {
                     mba = ba + i;
-                    dby = tqxb[i];
+                    dby = xb[i];
                     }
                 if (Map_ReadB (mba, 1, &mby)) {         /* fetch, nxm? */
                     PUTP32 (pkt, RW_BCL, i);            /* adj bc */
@@ -1292,13 +1310,18 @@ switch (cmd) {                                          /* case on command */
         break;
 
     case OP_WR:                                         /* write */
-        if (t = Map_ReadB (ba, bc, tqxb)) {             /* fetch buf, nxm? */
-            PUTP32 (pkt, RW_BCL, 0);                    /* no bytes xfer'd */
-            if (tq_hbe (uptr, ba + bc - t))             /* post err log */
-                tq_mot_end (uptr, EF_LOG, ST_HST | SB_HST_NXM, bc);     
-            return SCPE_OK;                             /* end else wr */
+        if (aio->state != AIO_DONE) {                   /* start write? */
+            if (t = Map_ReadB (ba, bc, xb)) {           /* fetch buf, nxm? */
+                PUTP32 (pkt, RW_BCL, 0);                /* no bytes xfer'd */
+                if (tq_hbe (uptr, ba + bc - t))         /* post err log */
+                    tq_mot_end (uptr, EF_LOG, ST_HST | SB_HST_NXM, bc);     
+                return SCPE_OK;                         /* end else wr */
+                }
+            if (sim_tape_wrrecf_a (uptr, aio, xb, bc))  /* write rec fwd */
+                return SCPE_OK;                         /* queued, wait */
             }
-        if (sim_tape_wrrecf (uptr, tqxb, bc))           /* write rec fwd, err? */
+        aio->state = AIO_IDLE;                          /* write complete */
+        if (aio->stat != MTSE_OK)                       /* err? */
             return tq_mot_err (uptr, bc);               /* log, end */
         uptr->objp = uptr->objp + 1;                    /* upd obj pos */
         if (TEST_EOT (uptr))                            /* EOT on write? */
@@ -1535,13 +1558,13 @@ while (*skipped < cnt) {                                /* loopo */
 return ST_SUC;
 }
 
-/* Read buffer - can return ST_TMK, ST_FMT, or ST_DRV */
+/* Read buffer - can return ST_TMK, ST_FMT, or ST_DRV
 
-uint32 tq_rdbuff (UNIT *uptr, t_mtrlnt *tbc)
-{
-t_stat st;
+   The forward read has already been done (asynchronously) by tq_svc;
+   tq_rdbuff processes its status. */
 
-st = sim_tape_rdrecf (uptr, tqxb, tbc, MT_MAXFR);       /* read rec fwd */
+uint32 tq_rdbuff (UNIT *uptr, t_stat st)
+{
 if (st == MTSE_TMK) {                                   /* tape mark? */
     uptr->flags = uptr->flags | UNIT_SXC | UNIT_TMK;    /* serious exc */
     uptr->objp = uptr->objp + 1;                        /* update obj cnt */
@@ -1558,7 +1581,7 @@ uint32 tq_rdbufr (UNIT *uptr, t_mtrlnt *tbc)
 {
 t_stat st;
 
-st = sim_tape_rdrecr (uptr, tqxb, tbc, MT_MAXFR);       /* read rec rev */
+st = sim_tape_rdrecr (uptr, (uint8 *) TQ_AIO (uptr)->buf, tbc, MT_MAXFR); /* read rec rev */
 if (st == MTSE_TMK) {                                   /* tape mark? */
     uptr->flags = uptr->flags | UNIT_SXC;               /* serious exc */
     uptr->objp = uptr->objp - 1;                        /* update obj cnt */
@@ -1986,6 +2009,8 @@ t_stat tq_detach (UNIT *uptr)
 {
 t_stat r;
 
+if (uptr->flags & UNIT_ATT)                             /* attached? */
+    sim_aio_cancel (TQ_AIO (uptr));                     /* finish xfer */
 r = sim_tape_detach (uptr);                             /* detach unit */
 if (r != SCPE_OK)
     return r;
@@ -2027,6 +2052,13 @@ tq_pip = 0;                                             /* not polling */
 CLR_INT (TQ);                                           /* clr intr req */
 for (i = 0; i < TQ_NUMDR + 2; i++) {                    /* init units */
     uptr = tq_dev.units + i;
+    if (i < TQ_NUMDR) {                                 /* drive? */
+        sim_aio_cancel (&tq_aio[i]);                    /* finish xfer */
+        if (tq_aio[i].buf == NULL)                      /* alloc buffer */
+            tq_aio[i].buf = calloc (TQ_MAXFR, sizeof (uint8));
+        if (tq_aio[i].buf == NULL)
+            return SCPE_MEM;
+        }
     sim_cancel (uptr);                                  /* clr activity */
     sim_tape_reset (uptr);
     uptr->flags = uptr->flags &                         /* not online */
@@ -2034,10 +2066,6 @@ for (i = 0; i < TQ_NUMDR + 2; i++) {                    /* init units */
     uptr->uf = 0;                                       /* clr unit flags */
     uptr->cpkt = uptr->pktq = 0;                        /* clr pkt q's */
     }
-if (tqxb == NULL)
-    tqxb = (uint8 *) calloc (TQ_MAXFR, sizeof (uint8));
-if (tqxb == NULL)
-    return SCPE_MEM;
 return SCPE_OK;
 }
 
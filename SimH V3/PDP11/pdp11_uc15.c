@@ -55,6 +55,7 @@
    The signals may be polled with non-atomic operations but must be
    verified with an atomic compare-and-swap.
 
+   18-Oct-26    RMS         Added dirty page tracking
    21-Jul-18    RMS         Fixed missing size multiplier in reset (Mark Pizzolato)
 */
 
@@ -480,8 +481,10 @@ else {
 
 void uc15_WrMemW (int32 pa, int32 d)
 {
-if (((uint32) pa) < MEMSIZE)
+if (((uint32) pa) < MEMSIZE) {
     M[pa >> 1] = d;
+    SIM_DIRTY (pa);
+    }
 else {
     pa = pa - MEMSIZE;
     pdp15_mem[pa >> 1] = d & DMASK;
@@ -491,10 +494,12 @@ return;
 
 void uc15_WrMemB (int32 pa, int32 d)
 {
-if (((uint32) pa) < MEMSIZE)
+if (((uint32) pa) < MEMSIZE) {
     M[pa >> 1] = (pa & 1)?
          ((M[pa >> 1] & 0377) | ((d & 0377) << 8)): \
          ((M[pa >> 1] & ~0377) | (d & 0377));
+    SIM_DIRTY (pa);
+    }
 else {
     pa = pa - MEMSIZE;
     pdp15_mem[pa >> 1] = (pa & 1)?
@@ -537,8 +542,10 @@ else if (ba < uc15_memsize)                              /* no, strt ok? */
     alim = uc15_memsize;
 else return bc;                                         /* no, err */
 for ( ; ba < alim; ba = ba + 2) {                       /* by 18 bit words */
-    if (ba < MEMSIZE)
+    if (ba < MEMSIZE) {
         M[ba >> 1] = *buf++ & DMASK;
+        SIM_DIRTY (ba);
+        }
     else pdp15_mem[(ba - MEMSIZE) >> 1] = *buf++ & 0777777;
     }
 return (lim - alim);
@@ -68,6 +68,9 @@
 
   Modification history:
 
+  18-Oct-26  RMS  Received packets are processed in place in the read ring
+                  Received packets are taken from the read ring in batches;
+                  DELQA-T transmit frames are written in batches
   31-Jan-21  RMS  Fixed structure save/restore macros (Mark Pizzolato)
   20-Apr-11  MP   Fixed missing information from save/restore which
                   caused operations to not complete correctly after 
@@ -283,6 +286,7 @@ t_stat xq_process_xbdl(CTLR* xq);
 t_stat xq_dispatch_xbdl(CTLR* xq);
 t_stat xq_process_turbo_rbdl(CTLR* xq);
 t_stat xq_process_turbo_xbdl(CTLR* xq);
+void xq_xbatch_flush(CTLR* xq);
 void xq_start_receiver(CTLR* xq);
 void xq_stop_receiver(CTLR* xq);
 void xq_sw_reset(CTLR* xq);
@@ -1551,6 +1555,21 @@ t_stat xq_process_turbo_rbdl(CTLR* xq)
   return SCPE_OK;
 }
 
+/* Write the DELQA-T frames gathered by xq_process_turbo_xbdl in one request */
+
+void xq_xbatch_flush(CTLR* xq)
+{
+  ETH_PACK* packs[ETH_BATCH_MAX];
+  int i;
+
+  if (xq->var->xbatch_count == 0)
+    return;
+  for (i = 0; i < xq->var->xbatch_count; i++)
+    packs[i] = &xq->var->xbatch[i];
+  xq->var->xbatch_status = eth_write_batch(xq->var->etherface, packs, xq->var->xbatch_count, NULL);
+  xq->var->xbatch_count = 0;
+}
+
 t_stat xq_process_turbo_xbdl(CTLR* xq)
 {
   int i;
@@ -1575,8 +1594,10 @@ t_stat xq_process_turbo_xbdl(CTLR* xq)
 
     /* Get transmit descriptor from memory */
     status = Map_ReadW (tdra+i*sizeof(xq->var->xring[i]), sizeof(xq->var->xring[i]), (uint16 *)&xq->var->xring[i]);
-    if (status != SCPE_OK)
+    if (status != SCPE_OK) {
+      xq_xbatch_flush(xq);
       return xq_nxm_error(xq);
+    }
 
     if (xq->var->xring[i].tmd3 & XQ_TMD3_OWN)
         break;
@@ -1592,8 +1613,10 @@ t_stat xq_process_turbo_xbdl(CTLR* xq)
     if ((xq->var->write_buffer.len + b_length) > sizeof(xq->var->write_buffer.msg))
       b_length = (uint16)(sizeof(xq->var->write_buffer.msg) - xq->var->write_buffer.len);
     status = Map_ReadB(address, b_length, &xq->var->write_buffer.msg[xq->var->write_buffer.len]);
-    if (status != SCPE_OK)
+    if (status != SCPE_OK) {
+      xq_xbatch_flush(xq);
       return xq_nxm_error(xq);
+    }
 
     xq->var->write_buffer.len += b_length;
     if (!(xq->var->xring[i].tmd3 & XQ_TMD3_FOT)) {
@@ -1607,8 +1630,20 @@ t_stat xq_process_turbo_xbdl(CTLR* xq)
           /* External loopback fails when not connected */
           status = SCPE_NOFNC;
         }
+      } else if (xq->var->etherface) {
+        /* queue frame for a batch write; like eth_write, status is from a prior write */
+        ETH_PACK* pack = &xq->var->xbatch[xq->var->xbatch_count++];
+
+        pack->len = xq->var->write_buffer.len;
+        pack->used = xq->var->write_buffer.used;
+        pack->status = xq->var->write_buffer.status;
+        pack->crc_len = xq->var->write_buffer.crc_len;
+        memcpy(pack->msg, xq->var->write_buffer.msg, pack->len);
+        status = xq->var->xbatch_status;
+        if (xq->var->xbatch_count == ETH_BATCH_MAX)
+          xq_xbatch_flush(xq);
       } else
-        status = eth_write(xq->var->etherface, &xq->var->write_buffer, NULL);
+        status = SCPE_UNATT;
 
       xq->var->stats.xmit += 1;
       if (status != SCPE_OK) {         /* not implemented or unattached */
@@ -1639,11 +1674,16 @@ t_stat xq_process_turbo_xbdl(CTLR* xq)
     /*       is noted so we avoid walking on its changes */
     xq->var->xring[i].tmd3 |= XQ_TMD3_OWN; /* Return Descriptor to Driver */
     status = Map_WriteW (tdra+i*sizeof(xq->var->xring[i]), sizeof(xq->var->xring[i])-8, (uint16 *)&xq->var->xring[i]);
-    if (status != SCPE_OK)
+    if (status != SCPE_OK) {
+      xq_xbatch_flush(xq);
       return xq_nxm_error(xq);
+    }
 
   } while (0 == (xq->var->xring[xq->var->tbindx].tmd3 & XQ_TMD3_OWN));
 
+  /* write any frames still gathered */
+  xq_xbatch_flush(xq);
+
   if (descriptors_consumed) {
 
     /* Interrupt for Packet Transmission Completion */
@@ -1778,27 +1818,32 @@ t_stat xq_process_local (CTLR* xq, ETH_PACK* pack)
   return SCPE_NOFNC;
 }
 
-void xq_read_callback(CTLR* xq, int status)
+void xq_receive(CTLR* xq, ETH_PACK* pack)
 {
   xq->var->stats.recv += 1;
 
   if (DBG_PCK & xq->dev->dctrl)
-    eth_packet_trace_ex(xq->var->etherface, xq->var->read_buffer.msg, xq->var->read_buffer.len, "xq-recvd", DBG_DAT & xq->dev->dctrl, DBG_PCK);
+    eth_packet_trace_ex(xq->var->etherface, pack->msg, pack->len, "xq-recvd", DBG_DAT & xq->dev->dctrl, DBG_PCK);
 
   if ((xq->var->csr & XQ_CSR_RE) || (xq->var->mode == XQ_T_DELQA_PLUS)) { /* receiver enabled */
 
     /* process any packets locally that can be */
-    t_stat status = xq_process_local (xq, &xq->var->read_buffer);
+    t_stat status = xq_process_local (xq, pack);
 
     /* add packet to read queue */
     if (status != SCPE_OK)
-      ethq_insert(&xq->var->ReadQ, 2, &xq->var->read_buffer, status);
+      ethq_insert(&xq->var->ReadQ, 2, pack, status);
   } else {
     xq->var->stats.dropped += 1;
     sim_debug(DBG_WRN, xq->dev, "packet received with receiver disabled\n");
   }
 }
 
+void xq_read_callback(CTLR* xq, int status)
+{
+  xq_receive(xq, &xq->var->read_buffer);
+}
+
 void xqa_read_callback(int status)
 {
   xq_read_callback(&xq_ctrl[0], status);
@@ -2501,7 +2546,8 @@ t_stat xq_svc(UNIT* uptr)
 
   /* if the receiver is enabled */
   if ((xq->var->mode == XQ_T_DELQA_PLUS) || (xq->var->csr & XQ_CSR_RE)) {
-    t_stat status;
+    ETH_PACK* packs[ETH_BATCH_MAX];
+    int i, n;
 
     /* First pump any queued packets into the system */
     if ((xq->var->ReadQ.count > 0) && ((xq->var->mode == XQ_T_DELQA_PLUS) || (~xq->var->csr & XQ_CSR_RL)))
@@ -2509,10 +2555,12 @@ t_stat xq_svc(UNIT* uptr)
 
     /* Now read and queue packets that have arrived */
     /* This is repeated as long as they are available */
-    do {
-      /* read a packet from the ethernet - processing is via the callback */
-      status = eth_read (xq->var->etherface, &xq->var->read_buffer, xq->var->rcallback);
-    } while (status);
+    /* Packets are processed in place in the receive ring, a batch at a time */
+    while ((n = eth_read_batch (xq->var->etherface, packs, ETH_BATCH_MAX)) > 0) {
+      for (i = 0; i < n; i++)
+        xq_receive(xq, packs[i]);
+      eth_read_batch_done (xq->var->etherface, n);
+    }
 
     /* Now pump any still queued packets into the system */
     if ((xq->var->ReadQ.count > 0) && ((xq->var->mode == XQ_T_DELQA_PLUS) || (~xq->var->csr & XQ_CSR_RL)))
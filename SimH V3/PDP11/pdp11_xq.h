@@ -28,6 +28,7 @@
 
   Modification history:
 
+  18-Oct-26  RMS  Added DELQA-T transmit batch
   03-Mar-08  MP   Added DELQA-T (aka DELQA Plus) device emulation support.
   06-Feb-08  MP   Added dropped frame statistics to record when the receiver discards
                   received packets due to the receiver being disabled, or due to the
@@ -297,6 +298,9 @@ struct xq_device {
   ETH_DEV*          etherface;
   ETH_PACK          read_buffer;
   ETH_PACK          write_buffer;
+  ETH_PACK          xbatch[ETH_BATCH_MAX];              /* DELQA-T frames awaiting write */
+  int               xbatch_count;
+  t_stat            xbatch_status;                      /* status of last batch write */
   ETH_QUE           ReadQ;
   int32             idtmr;                              /* countdown for ID Timer */
   uint32            must_poll;                          /* receiver must poll instead of counting on asynch polls */
@@ -62,6 +62,10 @@
 
   Modification history:
 
+  18-Oct-26  RMS  Received packets are processed in place in the read ring
+                  Receive is driven by reader thread wakeups when available;
+                  the receive unit polls only while frames await buffers
+                  Received packets are taken from the read ring in batches
   28-May-18  RMS  Changed to avoid nested comment warnings (Mark Pizzolato)
   12-Jan-11  DTH  Added SHOW XU FILTERS modifier
   11-Jan-11  DTH  Corrected SELFTEST command, enabling use by VMS 3.7, VMS 4.7, and Ultrix 1.1
@@ -466,17 +470,24 @@ t_stat xu_process_local (CTLR* xu, ETH_PACK* pack)
   return SCPE_NOFNC;
 }
 
-void xu_read_callback(CTLR* xu, int status)
+void xu_receive(CTLR* xu, ETH_PACK* pack)
 {
+  t_stat status;
+
   if (DBG_PCK & xu->dev->dctrl)
-      eth_packet_trace_ex(xu->var->etherface, xu->var->read_buffer.msg, xu->var->read_buffer.len, "xu-recvd", DBG_DAT & xu->dev->dctrl, DBG_PCK);
+      eth_packet_trace_ex(xu->var->etherface, pack->msg, pack->len, "xu-recvd", DBG_DAT & xu->dev->dctrl, DBG_PCK);
 
   /* process any packets locally that can be */
-  status = xu_process_local (xu, &xu->var->read_buffer);
+  status = xu_process_local (xu, pack);
 
   /* add packet to read queue */
   if (status != SCPE_OK)
-    ethq_insert(&xu->var->ReadQ, 2, &xu->var->read_buffer, 0);
+    ethq_insert(&xu->var->ReadQ, 2, pack, 0);
+}
+
+void xu_read_callback(CTLR* xu, int status)
+{
+  xu_receive(xu, &xu->var->read_buffer);
 }
 
 void xua_read_callback(int status)
@@ -555,7 +566,8 @@ t_stat xu_system_id (CTLR* xu, const ETH_MAC dest, uint16 receipt_id)
 
 t_stat xu_svc(UNIT* uptr)
 {
-  int queue_size;
+  ETH_PACK* packs[ETH_BATCH_MAX];
+  int i, n;
   CTLR* xu = xu_unit2ctlr(uptr);
 
   /* First pump any queued packets into the system */
@@ -563,23 +575,25 @@ t_stat xu_svc(UNIT* uptr)
     xu_process_receive(xu);
 
   /* Now read and queue packets that have arrived */
-  /* This is repeated as long as they are available and we have room */
-  do
-    {
-    queue_size = xu->var->ReadQ.count;
-    /* read a packet from the ethernet - processing is via the callback */
-    eth_read (xu->var->etherface, &xu->var->read_buffer, xu->var->rcallback);
-  } while (queue_size != xu->var->ReadQ.count);
+  /* This is repeated as long as they are available */
+  /* Packets are processed in place in the receive ring, a batch at a time */
+  while ((n = eth_read_batch (xu->var->etherface, packs, ETH_BATCH_MAX)) > 0) {
+    for (i = 0; i < n; i++)
+      xu_receive(xu, packs[i]);
+    eth_read_batch_done (xu->var->etherface, n);
+  }
 
   /* Now pump any still queued packets into the system */
   if ((xu->var->ReadQ.count > 0) && ((xu->var->pcsr1 & PCSR1_STATE) == STATE_RUNNING))
     xu_process_receive(xu);
 
-  /* resubmit service timer if controller not halted */
+  /* resubmit service timer if controller not halted; with asynch
+     wakeups, only while received packets are waiting for buffers */
   switch (xu->var->pcsr1 & PCSR1_STATE) {
     case STATE_READY:
     case STATE_RUNNING:
-      sim_activate(&xu->unit[0], clk_cosched(tmxr_poll));
+      if (xu->var->must_poll || (xu->var->ReadQ.count > 0))
+        sim_activate(&xu->unit[0], clk_cosched(tmxr_poll));
       break;
   };
 
@@ -1375,6 +1389,8 @@ void xu_port_command (CTLR* xu)
     case CMD_PDMD:            /* POLLING DEMAND */
       /* process transmit buffers, receive buffers are done in the service timer */
       xu_process_transmit(xu);
+      if (!xu->var->must_poll)                  /* not polling? kick receiver */
+        sim_activate(&xu->unit[0], 0);
       xu->var->pcsr0 |= PCSR0_DNI;
       break;
 
@@ -1410,6 +1426,10 @@ void xu_port_command (CTLR* xu)
         xu->var->rxnext = 0;
         xu->var->txnext = 0;
 
+        /* start receiver if not polling */
+        if (!xu->var->must_poll)
+          sim_activate(&xu->unit[0], 0);
+
       } else
         xu->var->pcsr0 |= PCSR0_PCEI;
       break;
@@ -1609,6 +1629,11 @@ t_stat xu_attach(UNIT* uptr, char* cptr)
   uptr->flags |= UNIT_ATT;
   eth_setcrc(xu->var->etherface, 1); /* enable CRC */
 
+  /* receive on reader thread wakeups if possible, otherwise poll */
+  xu->var->must_poll = (SCPE_OK != eth_clr_async(xu->var->etherface));
+  if (!xu->var->must_poll)
+    eth_set_async(xu->var->etherface, 0);
+
   /* reset the device with the new attach info */
   xu_reset(xu->dev);
 
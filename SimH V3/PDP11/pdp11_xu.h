@@ -28,6 +28,7 @@
 
   Modification history:
 
+  18-Oct-26  RMS  Added must_poll
   23-Jan-08  MP   Added debugging support to display packet headers and packet data
   08-Dec-05  DTH  Added load_server, increased UDBSIZE for system ID parameters
   07-Jul-05  RMS  Removed extraneous externs
@@ -124,6 +125,7 @@ struct xu_device {
 
                                                         /* buffers, etc. */
   ETH_DEV*          etherface;
+  uint32            must_poll;                          /* receiver must poll instead of counting on asynch polls */
   ETH_PACK          read_buffer;
   ETH_PACK          write_buffer;
   ETH_QUE           ReadQ;
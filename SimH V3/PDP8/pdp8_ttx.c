@@ -25,6 +25,8 @@
 
    ttix,ttox    PT08/KL8JA terminal input/output
 
+   18-Oct-26    RMS     Fixed batch output service to poll before stalled lines
+                        Added batch output service
    21-Oct-21    RMS     Added device number display from V4
    18-Sep-16    RMS     Expanded support to 16 terminals
    27-Mar-15    RMS     Backported Dave Gesswein's fix to prevent data loss
@@ -84,6 +86,7 @@ int32 ttix (int32 IR, int32 AC);
 int32 ttox (int32 IR, int32 AC);
 t_stat ttix_svc (UNIT *uptr);
 t_stat ttox_svc (UNIT *uptr);
+t_stat ttox_svcbatch (DEVICE *dptr, UNIT **ulist, int32 cnt);
 int32 ttx_getln (int32 inst);
 void ttx_new_flags (uint32 newi, uint32 newo, uint32 newe);
 t_stat ttx_reset (DEVICE *dptr);
@@ -227,7 +230,9 @@ DEVICE ttox_dev = {
     TTX_MAXL, 10, 31, 1, 8, 8,
     NULL, NULL, &ttx_reset, 
     NULL, NULL, NULL,
-    NULL, DEV_DISABLE
+    NULL, DEV_DISABLE, 0,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    &ttox_svcbatch
     };
 
 /* Terminal input: IOT routine */
@@ -371,6 +376,44 @@ TTOX_SET_DONE (ln);                                     /* set done */
 return SCPE_OK;
 }
 
+/* Batch service - all output lines that complete on the same tick
+
+   Each line's character is queued first, and then the multiplexer is
+   polled for transmission once, rather than once per line.  Polling can
+   only re-enable transmission, so a line that finds transmission enabled
+   sees what it would have seen with a poll after each earlier line; a
+   line that finds it disabled is rechecked after an immediate poll, so
+   timing is as with per-line polling.
+*/
+
+t_stat ttox_svcbatch (DEVICE *dptr, UNIT **ulist, int32 cnt)
+{
+int32 i, c, ln;
+t_bool poll = FALSE;
+
+for (i = 0; i < cnt; i++) {
+    ln = ulist[i] - ttox_unit;                          /* line # */
+    if (ttx_ldsc[ln].conn) {                            /* connected? */
+        if (!ttx_ldsc[ln].xmte && poll)                 /* stalled, output queued? */
+            tmxr_poll_tx (&ttx_desc);                   /* poll xmt, recheck */
+        poll = TRUE;
+        if (ttx_ldsc[ln].xmte) {                        /* tx enabled? */
+            c = sim_tt_outcvt (ttox_buf[ln], TT_GET_MODE (ttox_unit[ln].flags));
+            if (c >= 0)                                 /* output char */
+                tmxr_putc_ln (&ttx_ldsc[ln], c);
+            }
+        else {
+            sim_activate (ulist[i], ttox_unit[ln].wait); /* wait */
+            continue;
+            }
+        }
+    TTOX_SET_DONE (ln);                                 /* set done */
+    }
+if (poll)                                               /* poll xmt once */
+    tmxr_poll_tx (&ttx_desc);
+return SCPE_OK;
+}
+
 /* Flag routine
 
    Global dev_done is used as a master interrupt; therefore, global
@@ -26,6 +26,7 @@
    cpu          central processor
    rtc          real time clock
 
+   18-Oct-26    RMS     Added idle support
    17-Feb-21    kenr    Added C register implementation to support console
    07-Sep-17    RMS     Fixed sim_eval declaration in history routine (COVERITY)
    09-Mar-17    RMS     trap_P not set if mem mgt trap during fetch (COVERITY)
@@ -292,6 +293,8 @@ MTAB cpu_mod[] = {
     { UNIT_MSIZE, 65536, NULL, "64K", &cpu_set_size },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "HISTORY", "HISTORY",
       &cpu_set_hist, &cpu_show_hist },
+    { MTAB_XTD|MTAB_VDV, 0, "IDLE", "IDLE", &sim_set_idle, &sim_show_idle },
+    { MTAB_XTD|MTAB_VDV, 0, NULL, "NOIDLE", &sim_clr_idle, NULL },
     { 0 }
     };
 
@@ -310,7 +313,7 @@ DEVICE cpu_dev = {
    rtc_reg      RTC register list
 */
 
-UNIT rtc_unit = { UDATA (&rtc_svc, 0, 0), 16000 };
+UNIT rtc_unit = { UDATA (&rtc_svc, UNIT_IDLE, 0), 16000 };
 
 REG rtc_reg[] = {
     { FLDATA (PIE, rtc_pie, 0) },
@@ -839,6 +842,11 @@ switch (op) {                                           /* case on opcode */
         }
         PCQ_ENTRY;
         P = va & VA_MASK;                               /* branch */
+        if (sim_idle_enab &&                            /* idling enabled? */
+            ((P == pc) ||                               /* BRU * or */
+             ((P == ((pc - 1) & VA_MASK)) &&            /* BRU *-1 to SKS? */
+              ((dat & I_POP) == 0) && (I_GETOP (dat) == SKS))))
+            sim_idle_loop (TMR_RTC, pc, P, ion != 0);
         if ((va & VA_USR) && (cpu_mode == MON_MODE)) {  /* user ref from mon. mode? */
             cpu_mode = USR_MODE;                        /* transition to user mode */
             if (mon_usr_trap)
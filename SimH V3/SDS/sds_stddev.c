@@ -28,6 +28,7 @@
    tti          keyboard
    tto          teleprinter
 
+   18-Oct-26    RMS     Added UNIT_IDLE flag to TTI
    12-Feb-21    kenr    Added C register support to PTR boot
    23-Oct-20    RMS     TTO recognizes no leader flag (Ken Rector)
    29-Dec-03    RMS     Added console backpressure support
@@ -155,7 +156,7 @@ DEVICE ptp_dev = {
 
 DIB tti_dib = { CHAN_W, DEV_TTI, XFR_TTI, std_tplt, &tti };
 
-UNIT tti_unit = { UDATA (&tti_svc, 0, 0), KBD_POLL_WAIT };
+UNIT tti_unit = { UDATA (&tti_svc, UNIT_IDLE, 0), KBD_POLL_WAIT };
 
 REG tti_reg[] = {
     { ORDATA (BUF, tti_unit.buf, 6) },
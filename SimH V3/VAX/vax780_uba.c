@@ -25,6 +25,7 @@
 
    uba                  DW780 Unibus adapter
 
+   18-Oct-26    RMS     Copy buffers a page at a time on little endian hosts
    13-Mar-17    RMS     Fixed bad test for UBA intr level (COVERITY)
    25-Mar-12    RMS     Added parameter to int_ack prototype (Mark Pizzolata)
    19-Nov-08    RMS     Moved I/O support routines to I/O library
@@ -177,6 +178,7 @@ uint32 uba_aitime = 250;                                /* adapter init time */
 uint32 uba_uitime = 12250;                              /* Unibus init time */
 int32 autcon_enb = 1;                                   /* autoconfig enable */
 
+extern uint32 *M;
 extern int32 trpirq;
 extern int32 autcon_enb;
 extern jmp_buf save_env;
@@ -606,6 +608,10 @@ return vec;
    Map_ReadW    -       fetch word buffer from memory
    Map_WriteB   -       store byte buffer into memory
    Map_WriteW   -       store word buffer into memory
+
+   On a little endian host, memory is a byte array in bus order, and the
+   part of the transfer that falls in each page is copied as a block,
+   unless a word transfer is not word aligned in memory.
 */
 
 int32 Map_ReadB (uint32 ba, int32 bc, uint8 *buf)
@@ -622,7 +628,11 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
         pbc = bc - i;
     if (DEBUG_PRI (uba_dev, UBA_DEB_XFR))
         fprintf (sim_deb, ">>UBA: 8b read, ma = %X, bc = %X\n", ma, pbc);
-    if ((ma | pbc) & 3) {                               /* aligned LW? */
+    if (sim_end) {                                      /* little endian? */
+        memcpy (buf, ((uint8 *) M) + ma, pbc);          /* copy run */
+        buf = buf + pbc;
+        }
+    else if ((ma | pbc) & 3) {                          /* aligned LW? */
         for (j = 0; j < pbc; ma++, j++) {               /* no, do by bytes */
             *buf++ = ReadB (ma);
             }
@@ -665,6 +675,10 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
             else *buf = (*buf & ~BMASK) | ReadB (ma);
             }
         }
+    else if (sim_end) {                                 /* little endian? */
+        memcpy (buf, ((uint8 *) M) + ma, pbc);          /* copy run */
+        buf = buf + (pbc >> 1);
+        }
     else if ((ma | pbc) & 3) {                          /* aligned LW? */
         for (j = 0; j < pbc; ma = ma + 2, j = j + 2) {  /* no, words */
             *buf++ = ReadW (ma);                        /* get word */
@@ -696,7 +710,12 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
         pbc = bc - i;
     if (DEBUG_PRI (uba_dev, UBA_DEB_XFR))
         fprintf (sim_deb, ">>UBA: 8b write, ma = %X, bc = %X\n", ma, pbc);
-    if ((ma | pbc) & 3) {                               /* aligned LW? */
+    if (sim_end) {                                      /* little endian? */
+        memcpy (((uint8 *) M) + ma, buf, pbc);          /* copy run */
+        SIM_DIRTY (ma);
+        buf = buf + pbc;
+        }
+    else if ((ma | pbc) & 3) {                          /* aligned LW? */
         for (j = 0; j < pbc; ma++, j++) {               /* no, do by bytes */
             WriteB (ma, *buf);
             buf++;
@@ -740,6 +759,11 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
             else WriteB (ma, *buf & BMASK);
             }
         }
+    else if (sim_end) {                                 /* little endian? */
+        memcpy (((uint8 *) M) + ma, buf, pbc);          /* copy run */
+        SIM_DIRTY (ma);
+        buf = buf + (pbc >> 1);
+        }
     else if ((ma | pbc) & 3) {                          /* aligned LW? */
         for (j = 0; j < pbc; ma = ma + 2, j = j + 2) {  /* no, words */
             WriteW (ma, *buf);                          /* write word */
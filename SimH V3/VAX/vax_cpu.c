@@ -25,6 +25,15 @@
 
    cpu          VAX central processor
 
+   18-Oct-26    RMS     Freed memory with its mapped length
+   18-Oct-26    RMS     Added dirty page tracking
+                        Exposed memory array for SAVE/RESTORE
+                        Added decoded instruction cache
+                        Allocated memory with sim_mem_alloc
+                        Added PC sampling hook
+                        Added binary history stream, SET CPU HSTREAM
+                        Read history instruction bytes from memory
+                        Cached decoded specifiers, not just I-stream values
    20-May-20    RMS     Added idle test for VMS 5.0/5.1 (Mark Pizzolato)
    23-Apr-19    RMS     Added hook for unpredictable indexed immediate .aw
    14-Apr-19    RMS     Added hook for non-standard MxPR CC's
@@ -249,7 +258,117 @@ typedef struct {
     int32               opnd[OPND_SIZE];
     } InstHistory;
 
+/* History stream records, little endian, packed
+
+        byte 0<3:0>     condition codes
+        byte 0<4>       PC present
+        byte 0<5>       PSL present
+        byte 0<6>       instruction present
+        byte 1          number of operands, n
+        4 bytes         if PC present, PC
+        4 bytes         if PSL present, PSL<31:4>
+        1 byte          if instruction present, number of instruction
+                        bytes, l (0 if unreadable)
+        2 bytes         if l = 0, opcode (0x100 set for two byte opcodes)
+        l bytes         instruction bytes
+        4n bytes        operands, as in the history ring
+
+   Fields that can be predicted are omitted.  The PC is omitted if it is
+   the previous PC plus the previous l; the PSL is omitted if it is
+   unchanged.  Instructions are remembered in a table of HSR_NIT entries
+   indexed by PC<HSR_V_NIT-1:0>, and an instruction is omitted if the
+   entry for its PC holds the same bytes.  Each instruction present with
+   l > 0 replaces the entry for its PC.  The opcode, if not present, is
+   the first byte of the instruction, or 0x100 plus the second byte if the
+   first is 0xFD.  At the start of the stream, the previous PC, l, and PSL
+   are 0, and the table is empty.
+*/
+
+#define HSR_V_NIT       10
+#define HSR_NIT         (1u << HSR_V_NIT)               /* inst table size */
+#define HSR_PC          0x10                            /* PC present */
+#define HSR_PSL         0x20                            /* PSL present */
+#define HSR_INST        0x40                            /* inst present */
+#define HSR_TAG         "VAX"                           /* format tag */
+
+typedef struct {
+    int32               pc;                             /* PC */
+    int32               lnt;                            /* length, 0 = empty */
+    uint8               inst[INST_SIZE];
+    } HSR_ENTRY;
+
+/* Decoded instruction cache
+
+   The cache is indexed by the physical address of the instruction.  Each
+   entry holds the opcode, the decoded specifiers (the specifier byte
+   merged with its decode ROM dispatch), and the remaining I-stream values
+   (displacements, immediates, branch displacements) fetched by the
+   specifier flows, in fetch order.  A hit skips the opcode fetch, the
+   decode ROM lookups, and the dispatch merge, and replays the I-stream
+   values without going through the prefetch buffer; only the operand
+   evaluation, which depends on registers and memory, is redone.  Only
+   instructions that lie within one page of main memory, and fit in
+   DC_MAXLW aligned longwords, are cached.
+
+   An entry also holds a copy of the memory longwords the instruction
+   occupies.  A hit requires that memory still match, so an entry is
+   implicitly invalidated by any write to the instruction (by the CPU, by
+   DMA, or from the console).  Because the cache is physically indexed,
+   mapping changes need no special handling; the physical PC is only
+   known, and the cache only used, while the prefetch state is valid, and
+   the prefetch state is flushed on every change of flow.
+*/
+
+#define DC_N_SIZE       12                              /* log2 entries */
+#define DC_SIZE         (1u << DC_N_SIZE)
+#define DC_MASK         (DC_SIZE - 1)
+#define DC_MAXLW        4                               /* max inst longwords */
+#define DC_MAXVAL       (DC_MAXLW * 4)                  /* max I-stream values */
+#define DC_MAXSPEC      (DR_NSPMASK + 1)                /* max specifiers */
+#define DC_V_DISP       8                               /* dispatch position */
+#define DC_HASH(pa)     ((((uint32) (pa)) ^ (((uint32) (pa)) >> DC_N_SIZE)) & DC_MASK)
+
+typedef struct {
+    int32               pa;                             /* phys PC, -1 = inv */
+    int32               opc;                            /* opcode */
+    int32               lnt;                            /* inst length */
+    int32               nlw;                            /* # longwords */
+    int32               nspec;                          /* # operand specs */
+    int32               brch;                           /* branch disp? */
+    int32               sdsp[DC_MAXSPEC];               /* decoded specs */
+    uint32              ilw[DC_MAXLW];                  /* inst longwords */
+    int32               val[DC_MAXVAL];                 /* I-stream values */
+    uint8               vlnt[DC_MAXVAL];                /* value lengths */
+    } DC_ENTRY;
+
+/* Physical PC is derivable from the prefetch state unless the last longword
+   fetched crossed a page boundary (see get_istr) */
+
+#define DC_PPC_OK       ((ppc >= 0) && ((ibcnt == 4) || \
+                        (VA_GETOFF (ppc) != ((ibcnt == 0)? 0: 4))))
+
+/* Fetch an I-stream value in the specifier flows, replaying it from the
+   cache on a hit, or recording it on a miss */
+
+#define GET_ISPEC(d,l)  do { \
+                            int32 dc_t; \
+                            if (dc_hit) { \
+                                dc_t = dcp->val[dc_nv]; \
+                                PC = PC + dcp->vlnt[dc_nv]; \
+                                } \
+                            else { \
+                                dc_t = get_istr (l, acc); \
+                                if (dc_nv < DC_MAXVAL) { \
+                                    dcp->val[dc_nv] = dc_t; \
+                                    dcp->vlnt[dc_nv] = (uint8) (l); \
+                                    } \
+                                } \
+                            dc_nv++; \
+                            d = dc_t; \
+                            } while (0)
+
 uint32 *M = NULL;                                       /* memory */
+static size_t M_lnt = 0;                                /* mapped length of M */
 int32 R[16];                                            /* registers */
 int32 STK[5];                                           /* stack pointers */
 int32 PSL;                                              /* PSL */
@@ -289,6 +408,12 @@ jmp_buf save_env;
 REG *pcq_r = NULL;                                      /* PC queue reg ptr */
 int32 pcq[PCQ_SIZE] = { 0 };                            /* PC queue */
 InstHistory *hst = NULL;                                /* instruction history */
+SIM_HSTREAM cpu_hs;                                     /* history stream */
+int32 hsr_npc = 0;                                      /* predicted PC */
+int32 hsr_psl = 0;                                      /* last PSL<31:4> */
+HSR_ENTRY hsr_itab[HSR_NIT];                            /* inst table */
+DC_ENTRY *cpu_dc = NULL;                                /* decoded inst cache */
+DC_ENTRY cpu_dc_tmp;                                    /* uncached decode */
 
 const uint32 byte_mask[33] = { 0x00000000,
  0x00000001, 0x00000003, 0x00000007, 0x0000000F,
@@ -390,11 +515,15 @@ extern t_stat cpu_boot (int32 unitno, DEVICE *dptr);
 extern int32 con_halt (int32 code, int32 cc);
 
 t_stat cpu_reset (DEVICE *dptr);
+t_addr cpu_sample_pc (uint32 *mode);
 t_stat cpu_ex (t_value *vptr, t_addr exta, UNIT *uptr, int32 sw);
 t_stat cpu_dep (t_value val, t_addr exta, UNIT *uptr, int32 sw);
 t_stat cpu_set_size (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat cpu_set_hist (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat cpu_set_hstr (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat cpu_show_hstr (FILE *st, UNIT *uptr, int32 val, void *desc);
+int32 cpu_hist_inst (uint8 *buf, int32 va, int32 lnt, int32 pa);
 t_stat cpu_show_virt (FILE *st, UNIT *uptr, int32 val, void *desc);
 t_stat cpu_set_idle (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat cpu_show_idle (FILE *st, UNIT *uptr, int32 val, void *desc);
@@ -403,6 +532,8 @@ SIM_INLINE int32 get_istr (int32 lnt, int32 acc);
 int32 ReadOcta (int32 va, int32 *opnd, int32 j, int32 acc);
 t_bool cpu_show_opnd (FILE *st, InstHistory *h, int32 line);
 void cpu_idle (void);
+void cpu_dc_flush (void);
+void cpu_dc_fill (DC_ENTRY *dcp, int32 pa, int32 opc, int32 lnt, int32 nv, int32 ns);
 
 /* CPU data structures
 
@@ -486,6 +617,10 @@ MTAB cpu_mod[] = {
 #endif
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "HISTORY", "HISTORY",
       &cpu_set_hist, &cpu_show_hist },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_NC, 0, "HSTREAM", "HSTREAM",
+      &cpu_set_hstr, &cpu_show_hstr },
+    { MTAB_XTD|MTAB_VDV, 1, NULL, "NOHSTREAM",
+      &cpu_set_hstr, NULL },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "VIRTUAL", NULL,
       NULL, &cpu_show_virt },
     { 0 }
@@ -617,6 +752,8 @@ for ( ;; ) {
     int32 i, j, r, rh, temp;
     uint32 va, iad;
     int32 opnd[OPND_SIZE];                              /* operand queue */
+    DC_ENTRY *dcp;                                      /* decode cache entry */
+    int32 dc_pa, dc_hit, dc_nv;
 
     if (cpu_astop) {
         cpu_astop = 0;
@@ -695,12 +832,37 @@ for ( ;; ) {
         }
 
     sim_interval = sim_interval - 1;                    /* count instr */
-    GET_ISTR (opc, L_BYTE);                             /* get opcode */
-    if (opc == 0xFD) {                                  /* 2 byte op? */
-        GET_ISTR (opc, L_BYTE);                         /* get second byte */
-        opc = opc | 0x100;                              /* flag */
+    dcp = &cpu_dc_tmp;                                  /* assume uncached */
+    dc_pa = -1;
+    dc_hit = 0;
+    dc_nv = 0;
+    if (DC_PPC_OK && ((PSL & PSL_FPD) == 0)) {          /* phys PC known? */
+        dc_pa = ppc - ibcnt + (PC & 03);
+        dcp = &cpu_dc[DC_HASH (dc_pa)];                 /* probe cache */
+        if (dcp->pa == dc_pa) {
+            for (i = 0; i < dcp->nlw; i++) {            /* inst unchanged? */
+                if (M[(dc_pa >> 2) + i] != dcp->ilw[i])
+                    break;
+                }
+            dc_hit = (i == dcp->nlw);
+            }
+        if (dc_hit) {                                   /* hit? */
+            opc = dcp->opc;                             /* opcode */
+            PC = PC + ((opc & 0x100)? 2: 1);
+            }
+        else {
+            dcp->pa = -1;                               /* no, refill */
+            dcp->brch = 0;
+            }
+        }
+    if (!dc_hit) {
+        GET_ISTR (opc, L_BYTE);                         /* get opcode */
+        if (opc == 0xFD) {                              /* 2 byte op? */
+            GET_ISTR (opc, L_BYTE);                     /* get second byte */
+            opc = opc | 0x100;                          /* flag */
+            }
         }
-    numspec = drom[opc][0];                             /* get # specs */
+    numspec = dc_hit? dcp->nspec: drom[opc][0];         /* get # specs */
     if (PSL & PSL_FPD) {
         if ((numspec & DR_F) == 0)
             RSVD_INST_FAULT;
@@ -728,14 +890,23 @@ for ( ;; ) {
 */
 
         for (i = 1, j = 0; i <= numspec; i++) {         /* loop thru specs */
-            disp = drom[opc][i];                        /* get dispatch */
-            if (disp >= BB) {
-                GET_ISTR (brdisp, DR_LNT (disp & 1));
-                break;
+            if (dc_hit) {                               /* decoded? */
+                spec = dcp->sdsp[i] & BMASK;            /* spec byte */
+                disp = dcp->sdsp[i] >> DC_V_DISP;       /* merged dispatch */
+                PC = PC + 1;
+                }
+            else {
+                disp = drom[opc][i];                    /* get dispatch */
+                if (disp >= BB) {
+                    GET_ISPEC (brdisp, DR_LNT (disp & 1));
+                    dcp->brch = 1;                      /* last is branch */
+                    break;
+                    }
+                spec = get_istr (L_BYTE, acc);          /* get spec byte */
+                disp = (spec & ~RGMASK) | disp;         /* merge w dispatch */
+                dcp->sdsp[i] = (disp << DC_V_DISP) | spec;
                 }
-            GET_ISTR (spec, L_BYTE);                    /* get spec byte */
             rn = spec & RGMASK;                         /* get reg # */
-            disp = (spec & ~RGMASK) | disp;             /* merge w dispatch */
             switch (disp) {                             /* dispatch spec */
 
 /* Short literal - only read access permitted */
@@ -903,7 +1074,7 @@ for ( ;; ) {
             case AIN|RB: case AIN|RW: case AIN|RL: case AIN|RF:
                 va = R[rn];
                 if (rn == nPC) {
-                    GET_ISTR (opnd[j++], DR_LNT (disp));
+                    GET_ISPEC (opnd[j++], DR_LNT (disp));
                     }
                 else {
                     opnd[j++] = Read (R[rn], DR_LNT (disp), RA);
@@ -915,8 +1086,8 @@ for ( ;; ) {
             case AIN|RQ: case AIN|RD: case AIN|RG:
                 va = R[rn];
                 if (rn == nPC) {
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
                     }
                 else {
                     opnd[j++] = Read (va, L_LONG, RA);
@@ -929,10 +1100,10 @@ for ( ;; ) {
             case AIN|RO: case AIN|RH:
                 va = R[rn];
                 if (rn == nPC) {
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
                     }
                 else {
                     j = ReadOcta (va, opnd, j, RA);
@@ -944,7 +1115,7 @@ for ( ;; ) {
             case AIN|MB: case AIN|MW: case AIN|ML:
                 va = R[rn];
                 if (rn == nPC) {
-                    GET_ISTR (opnd[j++], DR_LNT (disp));
+                    GET_ISPEC (opnd[j++], DR_LNT (disp));
                     }
                 else {
                     opnd[j++] = Read (R[rn], DR_LNT (disp), WA);
@@ -956,8 +1127,8 @@ for ( ;; ) {
             case AIN|MQ:
                 va = R[rn];
                 if (rn == nPC) {
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
                     }
                 else {
                     opnd[j++] = Read (va, L_LONG, WA);
@@ -970,10 +1141,10 @@ for ( ;; ) {
             case AIN|MO:
                 va = R[rn];
                 if (rn == nPC) {
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
-                    GET_ISTR (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
+                    GET_ISPEC (opnd[j++], L_LONG);
                     }
                 else {
                     j = ReadOcta (va, opnd, j, WA);
@@ -989,7 +1160,7 @@ for ( ;; ) {
                 opnd[j++] = OP_MEM;
             case AID|AB: case AID|AW: case AID|AL: case AID|AQ: case AID|AO:
                 if (rn == nPC) {
-                    GET_ISTR (va = opnd[j++], L_LONG);
+                    GET_ISPEC (va = opnd[j++], L_LONG);
                     }
                 else {
                     va = opnd[j++] = Read (R[rn], L_LONG, RA);
@@ -1000,7 +1171,7 @@ for ( ;; ) {
 
             case AID|RB: case AID|RW: case AID|RL: case AID|RF:
                 if (rn == nPC) {
-                    GET_ISTR (va, L_LONG);
+                    GET_ISPEC (va, L_LONG);
                     }
                 else {
                     va = Read (R[rn], L_LONG, RA);
@@ -1012,7 +1183,7 @@ for ( ;; ) {
 
             case AID|RQ: case AID|RD: case AID|RG:
                 if (rn == nPC) {
-                    GET_ISTR (va, L_LONG);
+                    GET_ISPEC (va, L_LONG);
                     }
                 else {
                     va = Read (R[rn], L_LONG, RA);
@@ -1025,7 +1196,7 @@ for ( ;; ) {
 
             case AID|RO: case AID|RH:
                 if (rn == nPC) {
-                    GET_ISTR (va, L_LONG);
+                    GET_ISPEC (va, L_LONG);
                     }
                 else {
                     va = Read (R[rn], L_LONG, RA);
@@ -1037,7 +1208,7 @@ for ( ;; ) {
 
             case AID|MB: case AID|MW: case AID|ML:
                 if (rn == nPC) {
-                    GET_ISTR (va, L_LONG);
+                    GET_ISPEC (va, L_LONG);
                     }
                 else {
                     va = Read (R[rn], L_LONG, RA);
@@ -1049,7 +1220,7 @@ for ( ;; ) {
 
             case AID|MQ:
                 if (rn == nPC) {
-                    GET_ISTR (va, L_LONG);
+                    GET_ISPEC (va, L_LONG);
                     }
                 else {
                     va = Read (R[rn], L_LONG, RA);
@@ -1062,7 +1233,7 @@ for ( ;; ) {
 
             case AID|MO:
                 if (rn == nPC) {
-                    GET_ISTR (va, L_LONG);
+                    GET_ISPEC (va, L_LONG);
                     }
                 else {
                     va = Read (R[rn], L_LONG, RA);
@@ -1078,44 +1249,44 @@ for ( ;; ) {
             case BDP|WB: case BDP|WW: case BDP|WL: case BDP|WQ: case BDP|WO:
                 opnd[j++] = OP_MEM;
             case BDP|AB: case BDP|AW: case BDP|AL: case BDP|AQ: case BDP|AO:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 va = opnd[j++] = R[rn] + SXTB (temp);
                 break;
 
             case BDP|RB: case BDP|RW: case BDP|RL: case BDP|RF:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 va = R[rn] + SXTB (temp);
                 opnd[j++] = Read (va, DR_LNT (disp), RA);
                 break;
 
             case BDP|RQ: case BDP|RD: case BDP|RG:
-                GET_ISTR (temp, L_BYTE);        
+                GET_ISPEC (temp, L_BYTE);        
                 va = R[rn] + SXTB (temp);
                 opnd[j++] = Read (va, L_LONG, RA);
                 opnd[j++] = Read (va + 4, L_LONG, RA);
                 break;
 
             case BDP|RO: case BDP|RH:
-                GET_ISTR (temp, L_BYTE);        
+                GET_ISPEC (temp, L_BYTE);        
                 va = R[rn] + SXTB (temp);
                 j = ReadOcta (va, opnd, j, RA);
                 break;
 
             case BDP|MB: case BDP|MW: case BDP|ML:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 va = R[rn] + SXTB (temp);
                 opnd[j++] = Read (va, DR_LNT (disp), WA);
                 break;
 
             case BDP|MQ:
-                GET_ISTR (temp, L_BYTE);        
+                GET_ISPEC (temp, L_BYTE);        
                 va = R[rn] + SXTB (temp);
                 opnd[j++] = Read (va, L_LONG, WA);
                 opnd[j++] = Read (va + 4, L_LONG, WA);
                 break;
 
             case BDP|MO:
-                GET_ISTR (temp, L_BYTE);        
+                GET_ISPEC (temp, L_BYTE);        
                 va = R[rn] + SXTB (temp);
                 j = ReadOcta (va, opnd, j, WA);
                 break;
@@ -1126,20 +1297,20 @@ for ( ;; ) {
             case BDD|WB: case BDD|WW: case BDD|WL: case BDD|WQ: case BDD|WO:
                 opnd[j++] = OP_MEM;
             case BDD|AB: case BDD|AW: case BDD|AL: case BDD|AQ: case BDD|AO:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 iad = R[rn] + SXTB (temp);
                 va = opnd[j++] = Read (iad, L_LONG, RA);
                 break;
 
             case BDD|RB: case BDD|RW: case BDD|RL: case BDD|RF:
-                GET_ISTR (temp, L_BYTE);        
+                GET_ISPEC (temp, L_BYTE);        
                 iad = R[rn] + SXTB (temp);
                 va = Read (iad, L_LONG, RA);    
                 opnd[j++] = Read (va, DR_LNT (disp), RA);
                 break;
 
             case BDD|RQ: case BDD|RD: case BDD|RG:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 iad = R[rn] + SXTB (temp);
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, L_LONG, RA);
@@ -1147,21 +1318,21 @@ for ( ;; ) {
                 break;  
 
             case BDD|RO: case BDD|RH:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 iad = R[rn] + SXTB (temp);
                 va = Read (iad, L_LONG, RA);
                 j = ReadOcta (va, opnd, j, RA);
                 break;  
 
             case BDD|MB: case BDD|MW: case BDD|ML:
-                GET_ISTR (temp, L_BYTE);        
+                GET_ISPEC (temp, L_BYTE);        
                 iad = R[rn] + SXTB (temp);
                 va = Read (iad, L_LONG, RA);    
                 opnd[j++] = Read (va, DR_LNT (disp), WA);
                 break;
 
             case BDD|MQ:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 iad = R[rn] + SXTB (temp);
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, L_LONG, WA);
@@ -1169,7 +1340,7 @@ for ( ;; ) {
                 break;  
 
             case BDD|MO:
-                GET_ISTR (temp, L_BYTE);
+                GET_ISPEC (temp, L_BYTE);
                 iad = R[rn] + SXTB (temp);
                 va = Read (iad, L_LONG, RA);
                 j = ReadOcta (va, opnd, j, WA);
@@ -1181,44 +1352,44 @@ for ( ;; ) {
             case WDP|WB: case WDP|WW: case WDP|WL: case WDP|WQ: case WDP|WO:
                 opnd[j++] = OP_MEM;
             case WDP|AB: case WDP|AW: case WDP|AL: case WDP|AQ: case WDP|AO:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 va = opnd[j++] = R[rn] + SXTW (temp);
                 break;
 
             case WDP|RB: case WDP|RW: case WDP|RL: case WDP|RF:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 va = R[rn] + SXTW (temp);
                 opnd[j++] = Read (va, DR_LNT (disp), RA);
                 break;
 
             case WDP|RQ: case WDP|RD: case WDP|RG:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 va = R[rn] + SXTW (temp);
                 opnd[j++] = Read (va, L_LONG, RA);
                 opnd[j++] = Read (va + 4, L_LONG, RA);
                 break;
 
             case WDP|RO: case WDP|RH:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 va = R[rn] + SXTW (temp);
                 j = ReadOcta (va, opnd, j, RA);
                 break;
 
             case WDP|MB: case WDP|MW: case WDP|ML:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 va = R[rn] + SXTW (temp);
                 opnd[j++] = Read (va, DR_LNT (disp), WA);
                 break;
 
             case WDP|MQ:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 va = R[rn] + SXTW (temp);
                 opnd[j++] = Read (va, L_LONG, WA);
                 opnd[j++] = Read (va + 4, L_LONG, WA);
                 break;
 
             case WDP|MO:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 va = R[rn] + SXTW (temp);
                 j = ReadOcta (va, opnd, j, WA);
                 break;
@@ -1229,20 +1400,20 @@ for ( ;; ) {
             case WDD|WB: case WDD|WW: case WDD|WL: case WDD|WQ: case WDD|WO:
                 opnd[j++] = OP_MEM;
             case WDD|AB: case WDD|AW: case WDD|AL: case WDD|AQ: case WDD|AO:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 iad = R[rn] + SXTW (temp);
                 va = opnd[j++] = Read (iad, L_LONG, RA);
                 break;
 
             case WDD|RB: case WDD|RW: case WDD|RL: case WDD|RF:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 iad = R[rn] + SXTW (temp);
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, DR_LNT (disp), RA);
                 break;
 
             case WDD|RQ: case WDD|RD: case WDD|RG:
-                GET_ISTR (temp, L_WORD);        
+                GET_ISPEC (temp, L_WORD);        
                 iad = R[rn] + SXTW (temp);
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, L_LONG, RA);
@@ -1250,21 +1421,21 @@ for ( ;; ) {
                 break;
 
             case WDD|RO: case WDD|RH:
-                GET_ISTR (temp, L_WORD);        
+                GET_ISPEC (temp, L_WORD);        
                 iad = R[rn] + SXTW (temp);
                 va = Read (iad, L_LONG, RA);
                 j = ReadOcta (va, opnd, j, RA);
                 break;
 
             case WDD|MB: case WDD|MW: case WDD|ML:
-                GET_ISTR (temp, L_WORD);
+                GET_ISPEC (temp, L_WORD);
                 iad = R[rn] + SXTW (temp);
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, DR_LNT (disp), WA);
                 break;
 
             case WDD|MQ:
-                GET_ISTR (temp, L_WORD);        
+                GET_ISPEC (temp, L_WORD);        
                 iad = R[rn] + SXTW (temp);
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, L_LONG, WA);
@@ -1272,7 +1443,7 @@ for ( ;; ) {
                 break;
 
             case WDD|MO:
-                GET_ISTR (temp, L_WORD);        
+                GET_ISPEC (temp, L_WORD);        
                 iad = R[rn] + SXTW (temp);
                 va = Read (iad, L_LONG, RA);
                 j = ReadOcta (va, opnd, j, WA);
@@ -1284,44 +1455,44 @@ for ( ;; ) {
             case LDP|WB: case LDP|WW: case LDP|WL: case LDP|WQ: case LDP|WO:
                 opnd[j++] = OP_MEM;
             case LDP|AB: case LDP|AW: case LDP|AL: case LDP|AQ: case LDP|AO:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 va = opnd[j++] = R[rn] + temp;
                 break;
 
             case LDP|RB: case LDP|RW: case LDP|RL: case LDP|RF:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 va = R[rn] + temp;
                 opnd[j++] = Read (va, DR_LNT (disp), RA);
                 break;
 
             case LDP|RQ: case LDP|RD: case LDP|RG:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 va = R[rn] + temp;
                 opnd[j++] = Read (va, L_LONG, RA);
                 opnd[j++] = Read (va + 4, L_LONG, RA);
                 break;
 
             case LDP|RO: case LDP|RH:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 va = R[rn] + temp;
                 j = ReadOcta (va, opnd, j, RA);
                 break;
 
             case LDP|MB: case LDP|MW: case LDP|ML:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 va = R[rn] + temp;
                 opnd[j++] = Read (va, DR_LNT (disp), WA);
                 break;
 
             case LDP|MQ:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 va = R[rn] + temp;
                 opnd[j++] = Read (va, L_LONG, WA);
                 opnd[j++] = Read (va + 4, L_LONG, WA);
                 break;
 
             case LDP|MO:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 va = R[rn] + temp;
                 j = ReadOcta (va, opnd, j, WA);
                 break;
@@ -1332,20 +1503,20 @@ for ( ;; ) {
             case LDD|WB: case LDD|WW: case LDD|WL: case LDD|WQ: case LDD|WO:
                 opnd[j++] = OP_MEM;
             case LDD|AB: case LDD|AW: case LDD|AL: case LDD|AQ: case LDD|AO:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 iad = R[rn] + temp;
                 va = opnd[j++] = Read (iad, L_LONG, RA);
                 break;
 
             case LDD|RB: case LDD|RW: case LDD|RL: case LDD|RF:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 iad = R[rn] + temp;
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, DR_LNT (disp), RA);
                 break;
 
             case LDD|RQ: case LDD|RD: case LDD|RG:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 iad = R[rn] + temp;
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, L_LONG, RA);
@@ -1353,21 +1524,21 @@ for ( ;; ) {
                 break;
 
             case LDD|RO: case LDD|RH:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 iad = R[rn] + temp;
                 va = Read (iad, L_LONG, RA);
                 j = ReadOcta (va, opnd, j, RA);
                 break;
 
             case LDD|MB: case LDD|MW: case LDD|ML:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 iad = R[rn] + temp;
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, DR_LNT (disp), WA);
                 break;
 
             case LDD|MQ:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 iad = R[rn] + temp;
                 va = Read (iad, L_LONG, RA);
                 opnd[j++] = Read (va, L_LONG, WA);
@@ -1375,7 +1546,7 @@ for ( ;; ) {
                 break;
 
             case LDD|MO:
-                GET_ISTR (temp, L_LONG);
+                GET_ISPEC (temp, L_LONG);
                 iad = R[rn] + temp;
                 va = Read (iad, L_LONG, RA);
                 j = ReadOcta (va, opnd, j, WA);
@@ -1391,7 +1562,7 @@ for ( ;; ) {
             case IDX|RF: case IDX|RD: case IDX|RG: case IDX|RH:
                 CHECK_FOR_PC;
                 index = R[rn] << (disp & DR_LNMASK);
-                GET_ISTR (spec, L_BYTE);
+                GET_ISPEC (spec, L_BYTE);
                 rn = spec & RGMASK;
                 switch (spec & ~RGMASK) {
                 case ADC:
@@ -1416,7 +1587,7 @@ for ( ;; ) {
 
                 case AID:
                     if (rn == nPC) {
-                        GET_ISTR (temp, L_LONG);
+                        GET_ISPEC (temp, L_LONG);
                         }
                     else {
                         temp = Read (R[rn], L_LONG, RA);
@@ -1427,32 +1598,32 @@ for ( ;; ) {
                     break;
 
                 case BDP:
-                    GET_ISTR (temp, L_BYTE);
+                    GET_ISPEC (temp, L_BYTE);
                     index = index + R[rn] + SXTB (temp);
                     break;
 
                 case BDD:
-                    GET_ISTR (temp, L_BYTE);
+                    GET_ISPEC (temp, L_BYTE);
                     index = index + Read (R[rn] + SXTB (temp), L_LONG, RA);
                     break;
 
                 case WDP:
-                    GET_ISTR (temp, L_WORD);
+                    GET_ISPEC (temp, L_WORD);
                     index = index + R[rn] + SXTW (temp);
                     break;
 
                 case WDD:
-                    GET_ISTR (temp, L_WORD);
+                    GET_ISPEC (temp, L_WORD);
                     index = index + Read (R[rn] + SXTW (temp), L_LONG, RA);
                     break;
 
                 case LDP:
-                    GET_ISTR (temp, L_LONG);
+                    GET_ISPEC (temp, L_LONG);
                     index = index + R[rn] + temp;
                     break;
 
                 case LDD:
-                    GET_ISTR (temp, L_LONG);
+                    GET_ISPEC (temp, L_LONG);
                     index = index + Read (R[rn] + temp, L_LONG, RA);
                     break;
 
@@ -1505,34 +1676,74 @@ for ( ;; ) {
                 break;
                 }                                       /* end case spec */
             }                                           /* end for */
+        if (dc_hit) {                                   /* cached? */
+            if (dcp->brch)                              /* branch disp? */
+                GET_ISPEC (brdisp, L_BYTE);
+            ibcnt = 0;                                  /* resync prefetch */
+            ppc = (dc_pa + dcp->lnt) & ~03;
+            }
+        else if (dc_pa >= 0)                            /* cacheable? */
+            cpu_dc_fill (dcp, dc_pa, opc, PC - fault_PC, dc_nv, i - 1);
         }                                               /* end if not FPD */
 
 /* Optionally record instruction history */
 
     if (hst_lnt) {
-        int32 lim;
-        t_value wd;
-
         hst[hst_p].iPC = fault_PC;
         hst[hst_p].PSL = PSL | cc;
         hst[hst_p].opc = opc;
         for (i = 0; i < j; i++)
             hst[hst_p].opnd[i] = opnd[i];
-        lim = PC - fault_PC;
-        if ((uint32) lim > INST_SIZE)
-            lim = INST_SIZE;
-        for (i = 0; i < lim; i++) {
-            if ((cpu_ex (&wd, fault_PC + i, &cpu_unit, SWMASK ('V'))) == SCPE_OK)
-                hst[hst_p].inst[i] = (uint8) wd;
-            else {
-                hst[hst_p].inst[0] = hst[hst_p].inst[1] = 0xFF;
-                break;
-                }
-            }
+        if (cpu_hist_inst (hst[hst_p].inst, fault_PC, PC - fault_PC, dc_pa) < 0)
+            hst[hst_p].inst[0] = hst[hst_p].inst[1] = 0xFF;
         hst_p = hst_p + 1;
         if (hst_p >= hst_lnt)
             hst_p = 0;
         }
+    if (cpu_hs.ptr) {                                   /* history stream? */
+        uint8 *hp = SIM_HS_ROOM (&cpu_hs);
+        uint8 *rp = hp + 2;
+        HSR_ENTRY *ep = &hsr_itab[fault_PC & (HSR_NIT - 1)];
+        int32 hl;
+
+        hp[0] = (uint8) (cc & CC_MASK);
+        hp[1] = (uint8) j;
+        if (fault_PC != hsr_npc) {                      /* not sequential? */
+            hp[0] |= HSR_PC;
+            SIM_HS_PUT4 (rp, fault_PC);
+            rp = rp + 4;
+            }
+        if ((PSL & ~CC_MASK) != hsr_psl) {              /* PSL changed? */
+            hsr_psl = PSL & ~CC_MASK;
+            hp[0] |= HSR_PSL;
+            SIM_HS_PUT4 (rp, hsr_psl);
+            rp = rp + 4;
+            }
+        hl = cpu_hist_inst (rp + 1, fault_PC, PC - fault_PC, dc_pa);
+        if ((hl <= 0) || (ep->pc != fault_PC) || (ep->lnt != hl) ||
+            (memcmp (ep->inst, rp + 1, hl) != 0)) {     /* inst not known? */
+            hp[0] |= HSR_INST;
+            if (hl <= 0) {                              /* unreadable? */
+                hl = 0;
+                rp[0] = 0;
+                SIM_HS_PUT2 (rp + 1, opc);
+                rp = rp + 3;
+                }
+            else {
+                ep->pc = fault_PC;                      /* remember it */
+                ep->lnt = hl;
+                memcpy (ep->inst, rp + 1, hl);
+                rp[0] = (uint8) hl;
+                rp = rp + 1 + hl;
+                }
+            }
+        hsr_npc = fault_PC + hl;
+        for (i = 0; i < j; i++, rp = rp + 4) {
+            SIM_HS_PUT4 (rp, opnd[i]);
+            }
+        cpu_hs.ptr = rp;
+        cpu_hs.nrec = cpu_hs.nrec + 1;
+        }
 
 /* Dispatch to instructions */
 
@@ -3113,6 +3324,36 @@ if ((bo + lnt) >= 4) {                                  /* retire ibufl? */
 return val;
 }
 
+/* Decoded instruction cache routines */
+
+void cpu_dc_fill (DC_ENTRY *dcp, int32 pa, int32 opc, int32 lnt, int32 nv, int32 ns)
+{
+int32 i;
+
+if ((nv > DC_MAXVAL) ||                                 /* too many values? */
+    (((pa & 03) + lnt) > (DC_MAXLW << 2)) ||            /* too long? */
+    ((VA_GETOFF (pa) + lnt) > VA_PAGSIZE) ||            /* crosses page? */
+    !ADDR_IS_MEM (pa + lnt - 1))                        /* not in memory? */
+    return;
+dcp->opc = opc;
+dcp->lnt = lnt;
+dcp->nspec = ns;
+dcp->nlw = ((pa & 03) + lnt + 3) >> 2;
+for (i = 0; i < dcp->nlw; i++)                          /* save inst */
+    dcp->ilw[i] = M[(pa >> 2) + i];
+dcp->pa = pa;                                           /* validate */
+return;
+}
+
+void cpu_dc_flush (void)
+{
+uint32 i;
+
+for (i = 0; i < DC_SIZE; i++)
+    cpu_dc[i].pa = -1;
+return;
+}
+
 /* Read octaword specifier */
 
 int32 ReadOcta (int32 va, int32 *opnd, int32 j, int32 acc)
@@ -3150,13 +3391,32 @@ if (M == NULL) {                                        /* first time init? */
     if (pcq_r == NULL)
         return SCPE_IERR;
     pcq_r->qptr = 0;
-    M = (uint32 *) calloc (((uint32) MEMSIZE) >> 2, sizeof (uint32));
+    M = (uint32 *) sim_mem_alloc ((size_t) MEMSIZE);
     if (M == NULL)
         return SCPE_MEM;
+    M_lnt = (size_t) MEMSIZE;
     }
+cpu_unit.filebuf = sim_end? M: NULL;                    /* bytes, if little endian */
+if (sim_dirty_setup (&cpu_unit, VA_N_OFF) != SCPE_OK)   /* dirty page map */
+    return SCPE_MEM;
+if (cpu_dc == NULL) {                                   /* alloc decode cache */
+    cpu_dc = (DC_ENTRY *) calloc (DC_SIZE, sizeof (DC_ENTRY));
+    if (cpu_dc == NULL)
+        return SCPE_MEM;
+    }
+cpu_dc_flush ();                                        /* flush decode cache */
+sim_vm_sample_pc = &cpu_sample_pc;
 return build_dib_tab ();
 }
 
+/* PC sampling - PC is live during sim_instr, mode is in the PSL */
+
+t_addr cpu_sample_pc (uint32 *mode)
+{
+*mode = (uint32) PSL_GETCUR (PSL);
+return (t_addr) (uint32) PC;
+}
+
 /* Memory examine */
 
 t_stat cpu_ex (t_value *vptr, t_addr exta, UNIT *uptr, int32 sw)
@@ -3217,14 +3477,15 @@ for (i = val; i < MEMSIZE; i = i + 4)
     mc = mc | M[i >> 2];
 if ((mc != 0) && !get_yn ("Really truncate memory [N]?", FALSE))
     return SCPE_OK;
-nM = (uint32 *) calloc (uval >> 2, sizeof (uint32));
+nM = (uint32 *) sim_mem_alloc (uval);
 if (nM == NULL)
     return SCPE_MEM;
 clim = (uint32)((uval < MEMSIZE)? uval: MEMSIZE);
 for (i = 0; i < clim; i = i + 4)
     nM[i >> 2] = M[i >> 2];
-free (M);
+sim_mem_free (M, M_lnt);                                /* free mapped length */
 M = nM;
+M_lnt = (size_t) uval;
 MEMSIZE = uval; 
 reset_all (0);
 return SCPE_OK;
@@ -3313,6 +3574,59 @@ if (lnt) {
 return SCPE_OK;
 }
 
+/* Get instruction bytes for history.  If the physical address of the
+   instruction is known, and the instruction lies within a page of memory,
+   the bytes are taken from memory; otherwise, they are examined through
+   the current mapping.  Returns the number of bytes, or -1 if the
+   instruction could not be read. */
+
+int32 cpu_hist_inst (uint8 *buf, int32 va, int32 lnt, int32 pa)
+{
+int32 i;
+t_value wd;
+
+if (lnt <= 0)
+    return 0;
+if (lnt > INST_SIZE)
+    lnt = INST_SIZE;
+if ((pa >= 0) && (((pa ^ (pa + lnt - 1)) & ~VA_M_OFF) == 0) &&
+    ADDR_IS_MEM (pa + lnt - 1)) {
+    if (sim_end)                                        /* little endian? */
+        memcpy (buf, ((uint8 *) M) + pa, lnt);
+    else {
+        for (i = 0; i < lnt; i++, pa++)
+            buf[i] = (uint8) (M[pa >> 2] >> ((pa & 03) << 3));
+        }
+    return lnt;
+    }
+for (i = 0; i < lnt; i++) {
+    if ((cpu_ex (&wd, va + i, &cpu_unit, SWMASK ('V'))) != SCPE_OK)
+        return -1;
+    buf[i] = (uint8) wd;
+    }
+return lnt;
+}
+
+/* Set history stream */
+
+t_stat cpu_set_hstr (UNIT *uptr, int32 val, char *cptr, void *desc)
+{
+if (val)                                                /* NOHSTREAM? */
+    return sim_hs_close (&cpu_hs);
+if ((cptr == NULL) || (*cptr == 0))
+    return SCPE_2FARG;
+hsr_npc = hsr_psl = 0;                                  /* initial state */
+memset (hsr_itab, 0, sizeof (hsr_itab));
+return sim_hs_open (&cpu_hs, cptr, HSR_TAG);
+}
+
+/* Show history stream */
+
+t_stat cpu_show_hstr (FILE *st, UNIT *uptr, int32 val, void *desc)
+{
+return sim_hs_show (st, &cpu_hs);
+}
+
 /* Show history */
 
 t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, void *desc)
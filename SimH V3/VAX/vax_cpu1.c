@@ -23,6 +23,7 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added page at a time flows to MOVCx, CMPCx, LOCC, SKPC
    13-Mar-17    RMS     Annotated fall through in switch
    14-Jul-16    RMS     Corrected REI rule 9
    21-Jun-16    RMS     Removed reserved check on SIRR (Mark Pizzolato)
@@ -823,12 +824,18 @@ return 0;                                               /* q can't be empty */
         R3      =       current dest address
         R4      =       dstlen - srclen (loop count if fill state)
         R5      =       cc/state
+
+   Where both strings are in main memory, each state first moves as much
+   as it can a page at a time, directly in host memory.  The byte and
+   longword flows finish what is left.
 */
 
 int32 op_movc (int32 *opnd, int32 movc5, int32 acc)
 {
 int32 i, cc, fill, wd;
 int32 j, lnt, mlnt[3];
+int32 sl, dl;
+uint8 *sp, *dp;
 static const int32 looplnt[3] = { L_BYTE, L_LONG, L_BYTE };
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
@@ -880,6 +887,17 @@ else {
 switch (R[5] & MVC_M_STATE) {                           /* case on state */
 
     case MVC_FRWD:                                      /* move forward */
+        while (R[2] > 0) {                              /* page at a time */
+            if ((sp = MapStr (R[1], R[2], RA, &sl)) == NULL)
+                break;
+            if ((dp = MapStr (R[3], sl, WA, &dl)) == NULL)
+                break;
+            memmove (dp, sp, dl);                       /* move chunk */
+            R[1] = R[1] + dl;                           /* inc src addr */
+            R[3] = R[3] + dl;                           /* inc dst addr */
+            R[2] = R[2] - dl;                           /* dec move lnt */
+            sim_interval = sim_interval - ((dl + 3) >> 2);
+            }
         mlnt[0] = (4 - R[3]) & 3;                       /* length to align */
         if (mlnt[0] > R[2])                             /* cant exceed total */
             mlnt[0] = R[2];
@@ -898,6 +916,23 @@ switch (R[5] & MVC_M_STATE) {                           /* case on state */
         goto FILL;                                      /* check for fill */
 
     case MVC_BACK:                                      /* move backward */
+        while (R[2] > 0) {                              /* page at a time */
+            if ((sp = MapStr (R[1] - 1, 1, RA, &sl)) == NULL)
+                break;                                  /* map last bytes */
+            if ((dp = MapStr (R[3] - 1, 1, WA, &dl)) == NULL)
+                break;
+            sl = VA_GETOFF (R[1] - 1) + 1;              /* bytes in pages */
+            dl = VA_GETOFF (R[3] - 1) + 1;
+            if (dl < sl)
+                sl = dl;
+            if (R[2] < sl)
+                sl = R[2];
+            memmove (dp + 1 - sl, sp + 1 - sl, sl);     /* move chunk */
+            R[1] = R[1] - sl;                           /* dec src addr */
+            R[3] = R[3] - sl;                           /* dec dst addr */
+            R[2] = R[2] - sl;                           /* dec move lnt */
+            sim_interval = sim_interval - ((sl + 3) >> 2);
+            }
         mlnt[0] = R[3] & 03;                            /* length to align */
         if (mlnt[0] > R[2])                             /* cant exceed total */
             mlnt[0] = R[2];
@@ -921,6 +956,14 @@ switch (R[5] & MVC_M_STATE) {                           /* case on state */
         if (R[4] <= 0)                                  /* any fill? */
             break;
         R[5] = R[5] | MVC_FILL;                         /* set state */
+        while (R[4] > 0) {                              /* page at a time */
+            if ((dp = MapStr (R[3], R[4], WA, &dl)) == NULL)
+                break;
+            memset (dp, fill & BMASK, dl);              /* fill chunk */
+            R[3] = R[3] + dl;                           /* inc dst addr */
+            R[4] = R[4] - dl;                           /* dec fill lnt */
+            sim_interval = sim_interval - ((dl + 3) >> 2);
+            }
         mlnt[0] = (4 - R[3]) & 3;                       /* length to align */
         if (mlnt[0] > R[4])                             /* cant exceed total */
             mlnt[0] = R[4];
@@ -974,6 +1017,8 @@ return cc;
 int32 op_cmpc (int32 *opnd, int32 cmpc5, int32 acc)
 {
 int32 cc, s1, s2, fill;
+int32 i, lnt;
+uint8 *p1, *p2;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -995,6 +1040,23 @@ else {
     PSL = PSL | PSL_FPD;
     }
 R[2] = R[2] & STR_LNMASK;                               /* mask src2len */
+while (((R[0] & STR_LNMASK) != 0) && (R[2] != 0)) {     /* both strings left */
+    lnt = ((R[0] & STR_LNMASK) < R[2])? (R[0] & STR_LNMASK): R[2];
+    if ((p1 = MapStr (R[1], lnt, RA, &lnt)) == NULL)    /* map page of each */
+        break;
+    if ((p2 = MapStr (R[3], lnt, RA, &lnt)) == NULL)
+        break;
+    if (memcmp (p1, p2, lnt) == 0)                      /* all equal? */
+        i = lnt;
+    else for (i = 0; p1[i] == p2[i]; i++) ;             /* no, find diff */
+    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - i) & STR_LNMASK);
+    R[1] = R[1] + i;
+    R[2] = R[2] - i;
+    R[3] = R[3] + i;
+    sim_interval = sim_interval - i;
+    if (i < lnt)                                        /* mismatch? */
+        break;
+    }
 for (s1 = s2 = 0; ((R[0] | R[2]) & STR_LNMASK) != 0; sim_interval--) {
     if (R[0] & STR_LNMASK)                              /* src1? read */
         s1 = Read (R[1], L_BYTE, RA);
@@ -1034,6 +1096,8 @@ return cc;
 int32 op_locskp (int32 *opnd, int32 skpc, int32 acc)
 {
 int32 c, match;
+int32 i, lnt;
+uint8 *sp, *mp;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -1045,6 +1109,21 @@ else {
     R[1] = opnd[2];                                     /* src addr */
     PSL = PSL | PSL_FPD;
     }
+while ((R[0] & STR_LNMASK) != 0) {                      /* page at a time */
+    if ((sp = MapStr (R[1], R[0] & STR_LNMASK, RA, &lnt)) == NULL)
+        break;
+    if (skpc)                                           /* SKPC? */
+        for (i = 0; (i < lnt) && (sp[i] == match); i++) ;
+    else {                                              /* LOCC */
+        mp = (uint8 *) memchr (sp, match, lnt);
+        i = mp? (int32) (mp - sp): lnt;
+        }
+    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - i) & STR_LNMASK);
+    R[1] = R[1] + i;                                    /* incr src1adr */
+    sim_interval = sim_interval - i;
+    if (i < lnt)                                        /* found? */
+        break;
+    }
 for ( ; (R[0] & STR_LNMASK) != 0; sim_interval-- ) {    /* loop thru string */
     c = Read (R[1], L_BYTE, RA);                        /* get src byte */
     if ((c == match) ^ skpc)                            /* match & locc? */
@@ -25,6 +25,8 @@
 
    qba          Qbus adapter
 
+   18-Oct-26    RMS     Revised buffer routines to copy a page at a time
+                        Added dirty page tracking
    05-May-19    RMS     Added length parameter to ReadReg routines
                         Revamped Qbus memory as Qbus peripheral
    20-Dec-13    RMS     Added unaligned access routines
@@ -577,6 +579,7 @@ if (ADDR_IS_MEM (ma)) {
         val = ((val & mask) << sc) | (t & ~(mask << sc));
         }
     M[ma >> 2] = val;
+    SIM_DIRTY (ma);
     }
 else {
     cq_serr (ma);                                       /* error */
@@ -632,6 +635,7 @@ if (qba_map_addr (qa, &ma)) {                           /* in map? */
             M[ma >> 2] = (M[ma >> 2] & ~(BMASK << sc)) |
                 ((dat & BMASK) << sc);
             }
+        SIM_DIRTY (ma);
         }                                               /* end if mem */
     else mem_err = 1;
     return SCPE_OK;
@@ -735,41 +739,35 @@ for (i = 0; i < IPL_HLVL; i++)
 return SCPE_OK;
 }
 
-/* Qbus I/O buffer routines, aligned access
+/* Qbus I/O buffer routines
 
    Map_ReadB    -       fetch byte buffer from memory
    Map_ReadW    -       fetch word buffer from memory
    Map_WriteB   -       store byte buffer into memory
    Map_WriteW   -       store word buffer into memory
+
+   The bus address is translated once per page.  On a little endian host,
+   memory is a byte array in bus order, and the part of the transfer that
+   falls in each page is copied as a block; otherwise, it is moved a byte
+   or word at a time.
 */
 
 int32 Map_ReadB (uint32 ba, int32 bc, uint8 *buf)
 {
-int32 i;
-uint32 ma, dat;
+int32 i, j, pbc;
+uint32 ma;
 
-if ((ba | bc) & 03) {                                   /* check alignment */
-    for (i = ma = 0; i < bc; i++, buf++) {              /* by bytes */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        *buf = (uint8)ReadB (ma);
-        ma = ma + 1;
-        }
-    }
-else {
-    for (i = ma = 0; i < bc; i = i + 4, buf++) {        /* by longwords */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        dat = ReadL (ma);                               /* get lw */
-        *buf++ = dat & BMASK;                           /* low 8b */
-        *buf++ = (dat >> 8) & BMASK;                    /* next 8b */
-        *buf++ = (dat >> 16) & BMASK;                   /* next 8b */
-        *buf = (dat >> 24) & BMASK;
-        ma = ma + 4;
+for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
+    if (!qba_map_addr (ba + i, &ma))                    /* inv or NXM? */
+        return (bc - i);
+    pbc = VA_PAGSIZE - VA_GETOFF (ma);                  /* left in page */
+    if (pbc > (bc - i))                                 /* limit to rem xfr */
+        pbc = bc - i;
+    if (sim_end)                                        /* little endian? */
+        memcpy (buf + i, ((uint8 *) M) + ma, pbc);      /* copy run */
+    else {
+        for (j = 0; j < pbc; j++)                       /* no, by bytes */
+            buf[i + j] = (uint8) ReadB (ma + j);
         }
     }
 return 0;
@@ -777,31 +775,22 @@ return 0;
 
 int32 Map_ReadW (uint32 ba, int32 bc, uint16 *buf)
 {
-int32 i;
-uint32 ma,dat;
+int32 i, j, pbc;
+uint32 ma;
 
 ba = ba & ~01;
 bc = bc & ~01;
-if ((ba | bc) & 03) {                                   /* check alignment */
-    for (i = ma = 0; i < bc; i = i + 2, buf++) {        /* by words */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        *buf = (uint16)ReadW (ma);
-        ma = ma + 2;
-        }
-    }
-else {
-    for (i = ma = 0; i < bc; i = i + 4, buf++) {        /* by longwords */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        dat = ReadL (ma);                               /* get lw */
-        *buf++ = dat & WMASK;                           /* low 16b */
-        *buf = (dat >> 16) & WMASK;                     /* high 16b */
-        ma = ma + 4;
+for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
+    if (!qba_map_addr (ba + i, &ma))                    /* inv or NXM? */
+        return (bc - i);
+    pbc = VA_PAGSIZE - VA_GETOFF (ma);                  /* left in page */
+    if (pbc > (bc - i))                                 /* limit to rem xfr */
+        pbc = bc - i;
+    if (sim_end)                                        /* little endian? */
+        memcpy (buf + (i >> 1), ((uint8 *) M) + ma, pbc);
+    else {
+        for (j = 0; j < pbc; j = j + 2)                 /* no, by words */
+            buf[(i + j) >> 1] = (uint16) ReadW (ma + j);
         }
     }
 return 0;
@@ -809,31 +798,22 @@ return 0;
 
 int32 Map_WriteB (uint32 ba, int32 bc, uint8 *buf)
 {
-int32 i;
-uint32 ma, dat;
+int32 i, j, pbc;
+uint32 ma;
 
-if ((ba | bc) & 03) {                                   /* check alignment */
-    for (i = ma = 0; i < bc; i++, buf++) {              /* by bytes */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        WriteB (ma, *buf);
-        ma = ma + 1;
+for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
+    if (!qba_map_addr (ba + i, &ma))                    /* inv or NXM? */
+        return (bc - i);
+    pbc = VA_PAGSIZE - VA_GETOFF (ma);                  /* left in page */
+    if (pbc > (bc - i))                                 /* limit to rem xfr */
+        pbc = bc - i;
+    if (sim_end) {                                      /* little endian? */
+        memcpy (((uint8 *) M) + ma, buf + i, pbc);      /* copy run */
+        SIM_DIRTY (ma);
         }
-    }
-else {
-    for (i = ma = 0; i < bc; i = i + 4, buf++) {        /* by longwords */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        dat = (uint32) *buf++;                          /* get low 8b */
-        dat = dat | (((uint32) *buf++) << 8);           /* merge next 8b */
-        dat = dat | (((uint32) *buf++) << 16);          /* merge next 8b */
-        dat = dat | (((uint32) *buf) << 24);            /* merge hi 8b */
-        WriteL (ma, dat);                               /* store lw */
-        ma = ma + 4;
+    else {
+        for (j = 0; j < pbc; j++)                       /* no, by bytes */
+            WriteB (ma + j, buf[i + j]);
         }
     }
 return 0;
@@ -841,31 +821,24 @@ return 0;
 
 int32 Map_WriteW (uint32 ba, int32 bc, uint16 *buf)
 {
-int32 i;
-uint32 ma, dat;
+int32 i, j, pbc;
+uint32 ma;
 
 ba = ba & ~01;
 bc = bc & ~01;
-if ((ba | bc) & 03) {                                   /* check alignment */
-    for (i = ma = 0; i < bc; i = i + 2, buf++) {        /* by words */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        WriteW (ma, *buf);
-        ma = ma + 2;
+for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
+    if (!qba_map_addr (ba + i, &ma))                    /* inv or NXM? */
+        return (bc - i);
+    pbc = VA_PAGSIZE - VA_GETOFF (ma);                  /* left in page */
+    if (pbc > (bc - i))                                 /* limit to rem xfr */
+        pbc = bc - i;
+    if (sim_end) {                                      /* little endian? */
+        memcpy (((uint8 *) M) + ma, buf + (i >> 1), pbc);
+        SIM_DIRTY (ma);
         }
-    }
-else {
-    for (i = ma = 0; i < bc; i = i + 4, buf++) {        /* by longwords */
-        if ((ma & VA_M_OFF) == 0) {                     /* need map? */
-            if (!qba_map_addr (ba + i, &ma))            /* inv or NXM? */
-                return (bc - i);
-            }
-        dat = (uint32) *buf++;                          /* get low 16b */
-        dat = dat | (((uint32) *buf) << 16);            /* merge hi 16b */
-        WriteL (ma, dat);                               /* store lw */
-        ma = ma + 4;
+    else {
+        for (j = 0; j < pbc; j = j + 2)                 /* no, by words */
+            WriteW (ma + j, buf[(i + j) >> 1]);
         }
     }
 return 0;
@@ -23,6 +23,9 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added dirty page tracking
+                        Added string mapping routine
+                        Added host pointer fast path to TLB
    29-Nov-13    RMS     Reworked unaligned flows
    21-Jul-08    RMS     Removed inlining support
    28-May-08    RMS     Inlined physical memory routines
@@ -41,6 +44,7 @@
         ReadB(W)        -       read aligned physical byte (word)
         WriteB(W)       -       write aligned physical byte (word)
         Test            -       test acccess
+        MapStr          -       map string to host memory
 
         zap_tb          -       clear TB
         zap_tb_ent      -       clear TB entry
@@ -51,9 +55,18 @@
 #include "vax_defs.h"
 #include <setjmp.h>
 
+/* A TLB entry for a page of main memory also holds a pointer to the page
+   in M and the read and write access masks that allow a direct reference.
+   The fast path masks are zero if the page is not memory, and the write
+   mask is zero until pte<m> is set, so a single test of the mask against
+   the access code qualifies a hit. */
+
 typedef struct {
     int32       tag;                                    /* tag */
     int32       pte;                                    /* pte */
+    uint32      *hp;                                    /* host page ptr */
+    int32       racc;                                   /* fast path rd acc */
+    int32       wacc;                                   /* fast path wr acc */
     } TLBENT;
 
 extern uint32 *M;
@@ -103,6 +116,7 @@ t_stat tlb_dep (t_value val, t_addr addr, UNIT *uptr, int32 sw);
 t_stat tlb_reset (DEVICE *dptr);
 
 TLBENT fill (uint32 va, int32 lnt, int32 acc, int32 *stat);
+void tlb_set_ent (TLBENT *tlbp, int32 tag, int32 pte);
 extern int32 ReadIO (uint32 pa, int32 lnt);
 extern void WriteIO (uint32 pa, int32 val, int32 lnt);
 extern int32 ReadReg (uint32 pa, int32 lnt);
@@ -149,6 +163,9 @@ DEVICE tlb_dev = {
         write, with three cases: unaligned long, unaligned word within
         a longword, unaligned word crossing a longword boundary.
 
+   An aligned reference that hits in a TLB entry for a page of main
+   memory is done directly through the entry's host page pointer.
+
    Note that these routines do not handle quad or octa references.
 */
 
@@ -166,14 +183,24 @@ int32 Read (uint32 va, int32 lnt, int32 acc)
 {
 int32 vpn, off, tbi, pa;
 int32 pa1, bo, sc, wl, wh;
-TLBENT xpte;
+TLBENT xpte, *tlbp;
 
 mchk_va = va;
 if (mapen) {                                            /* mapping on? */
     vpn = VA_GETVPN (va);                               /* get vpn, offset */
     off = VA_GETOFF (va);
     tbi = VA_GETTBI (vpn);
-    xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
+    tlbp = (va & VA_S0)? &stlb[tbi]: &ptlb[tbi];        /* access tlb */
+    if ((tlbp->tag == vpn) && (tlbp->racc & acc) &&     /* mem page hit, */
+        ((off & (lnt - 1)) == 0)) {                     /* aligned? */
+        wl = tlbp->hp[off >> 2];
+        if (lnt >= L_LONG)
+            return wl;
+        if (lnt == L_WORD)
+            return ((wl >> ((off & 2)? 16: 0)) & WMASK);
+        return ((wl >> ((off & 3) << 3)) & BMASK);
+        }
+    xpte = *tlbp;
     if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
         ((acc & TLB_WACC) && ((xpte.pte & TLB_M) == 0)))
         xpte = fill (va, lnt, acc, NULL);               /* fill if needed */
@@ -228,14 +255,30 @@ void Write (uint32 va, int32 val, int32 lnt, int32 acc)
 {
 int32 vpn, off, tbi, pa;
 int32 pa1, bo, sc;
-TLBENT xpte;
+TLBENT xpte, *tlbp;
 
 mchk_va = va;
 if (mapen) {
     vpn = VA_GETVPN (va);
     off = VA_GETOFF (va);
     tbi = VA_GETTBI (vpn);
-    xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
+    tlbp = (va & VA_S0)? &stlb[tbi]: &ptlb[tbi];        /* access tlb */
+    if ((tlbp->tag == vpn) && (tlbp->wacc & acc) &&     /* mem page hit, */
+        ((off & (lnt - 1)) == 0)) {                     /* aligned? */
+        uint32 *mp = &tlbp->hp[off >> 2];
+        SIM_DIRTY (tlbp->pte & TLB_PFN);
+        if (lnt >= L_LONG)
+            *mp = val;
+        else if (lnt == L_WORD)
+            *mp = (off & 2)? (*mp & 0xFFFF) | (val << 16):
+                (*mp & ~0xFFFF) | val;
+        else {
+            sc = (off & 3) << 3;
+            *mp = (*mp & ~(0xFF << sc)) | (val << sc);
+            }
+        return;
+        }
+    xpte = *tlbp;
     if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
         ((xpte.pte & TLB_M) == 0))
         xpte = fill (va, lnt, acc, NULL);
@@ -298,6 +341,60 @@ if (mapen) {                                            /* mapping on? */
 return va & PAMASK;                                     /* ret phys addr */
 }
 
+/* Map string to host memory
+
+   Inputs:
+        va      =       virtual address
+        lnt     =       length of string at va, in bytes
+        acc     =       access code (KESU, read or write)
+        mlnt    =       pointer to mapped length
+   Output:
+        pointer to host memory for va, or NULL if the string must be
+        referenced through Read and Write (not main memory, or a big
+        endian host); *mlnt is set to the length that can be referenced
+        through the pointer, that is, lnt or the rest of the page
+
+   Translation is done exactly as it would be for the first byte of the
+   string in Read or Write, including any fault.  For write access, the
+   whole page is marked dirty, so callers may store anywhere in it.
+   Callers that process a string a page at a time, keeping their state
+   in the registers, take faults at the same point, and with the same
+   state, as the byte by byte flows.
+*/
+
+uint8 *MapStr (uint32 va, int32 lnt, int32 acc, int32 *mlnt)
+{
+int32 vpn, off, tbi;
+uint32 pa;
+TLBENT *tlbp;
+
+off = VA_GETOFF (va);
+*mlnt = ((VA_PAGSIZE - off) < (uint32) lnt)? VA_PAGSIZE - off: lnt;
+if ((lnt <= 0) || !sim_end)                             /* nothing, big endian? */
+    return NULL;
+mchk_va = va;
+if (mapen) {                                            /* mapping on? */
+    vpn = VA_GETVPN (va);
+    tbi = VA_GETTBI (vpn);
+    tlbp = (va & VA_S0)? &stlb[tbi]: &ptlb[tbi];        /* access tlb */
+    if ((tlbp->tag != vpn) || (((tlbp->racc | tlbp->wacc) & acc) == 0)) {
+        fill (va, L_BYTE, acc, NULL);                   /* fill, can fault */
+        if (((tlbp->racc | tlbp->wacc) & acc) == 0)     /* not memory? */
+            return NULL;
+        }
+    if (acc & TLB_WACC)                                 /* write? */
+        SIM_DIRTY (tlbp->pte & TLB_PFN);
+    return ((uint8 *) tlbp->hp) + off;
+    }
+pa = va & PAMASK;
+if (ADDR_IS_MEM (pa)) {                                 /* memory? */
+    if (acc & TLB_WACC)                                 /* write? */
+        SIM_DIRTY (pa);
+    return ((uint8 *) M) + pa;
+    }
+return NULL;
+}
+
 /* Read aligned physical (in virtual context, unless indicated)
 
    Inputs:
@@ -397,6 +494,7 @@ if (ADDR_IS_MEM (pa)) {
     int32 sc = (pa & 3) << 3;
     int32 mask = 0xFF << sc;
     M[id] = (M[id] & ~mask) | (val << sc);
+    SIM_DIRTY (pa);
     }
 else {
     mchk_ref = REF_V;
@@ -413,6 +511,7 @@ if (ADDR_IS_MEM (pa)) {
     int32 id = pa >> 2;
     M[id] = (pa & 2)? (M[id] & 0xFFFF) | (val << 16):
         (M[id] & ~0xFFFF) | val;
+    SIM_DIRTY (pa);
     }
 else {
     mchk_ref = REF_V;
@@ -425,8 +524,10 @@ return;
 
 SIM_INLINE void WriteL (uint32 pa, int32 val)
 {
-if (ADDR_IS_MEM (pa))
+if (ADDR_IS_MEM (pa)) {
     M[pa >> 2] = val;
+    SIM_DIRTY (pa);
+    }
 else {
     mchk_ref = REF_V;
     if (ADDR_IS_IO (pa))
@@ -438,8 +539,10 @@ return;
 
 void WriteLP (uint32 pa, int32 val)
 {
-if (ADDR_IS_MEM (pa))
+if (ADDR_IS_MEM (pa)) {
     M[pa >> 2] = val;
+    SIM_DIRTY (pa);
+    }
 else {
     mchk_va = pa;
     mchk_ref = REF_P;
@@ -466,6 +569,7 @@ if (ADDR_IS_MEM (pa)) {
     int32 bo = pa & 3;
     int32 sc = bo << 3;
     M[pa >> 2] = (M[pa >> 2] & ~(insert[lnt] << sc)) | ((val & insert[lnt]) << sc);
+    SIM_DIRTY (pa);
     }
 else {
     mchk_ref = REF_V;
@@ -501,7 +605,7 @@ TLBENT fill (uint32 va, int32 lnt, int32 acc, int32 *stat)
 {
 int32 ptidx = (((uint32) va) >> 7) & ~03;
 int32 tlbpte, ptead, pte, tbi, vpn;
-static TLBENT zero_pte = { 0, 0 };
+static TLBENT zero_pte = { 0, 0, NULL, 0, 0 };
 
 if (va & VA_S0) {                                       /* system space? */
     if (ptidx >= d_slr)                                 /* system */
@@ -534,9 +638,8 @@ else {
 #endif
         if ((pte & PTE_V) == 0)                         /* spte TNV? */
             MM_ERR (PR_PTNV);
-        stlb[tbi].tag = vpn;                            /* set stlb tag */
-        stlb[tbi].pte = cvtacc[PTE_GETACC (pte)] |
-            ((pte << VA_N_OFF) & TLB_PFN);              /* set stlb data */
+        tlb_set_ent (&stlb[tbi], vpn, cvtacc[PTE_GETACC (pte)] |
+            ((pte << VA_N_OFF) & TLB_PFN));             /* set stlb ent */
         }
     ptead = (stlb[tbi].pte & TLB_PFN) | VA_GETOFF (ptead);
     }
@@ -555,17 +658,35 @@ if (acc & TLB_WACC) {                                   /* write? */
 vpn = VA_GETVPN (va);
 tbi = VA_GETTBI (vpn);
 if ((va & VA_S0) == 0) {                                /* process space? */
-    ptlb[tbi].tag = vpn;                                /* store tlb ent */
-    ptlb[tbi].pte = tlbpte;
+    tlb_set_ent (&ptlb[tbi], vpn, tlbpte);              /* store tlb ent */
     return ptlb[tbi];
     }
-stlb[tbi].tag = vpn;                                    /* system space */
-stlb[tbi].pte = tlbpte;                                 /* store tlb ent */
+tlb_set_ent (&stlb[tbi], vpn, tlbpte);                  /* system space */
 return stlb[tbi];
 }
 
 /* Utility routines */
 
+/* Set TLB entry, including the fast path fields */
+
+void tlb_set_ent (TLBENT *tlbp, int32 tag, int32 pte)
+{
+uint32 pa = ((uint32) pte) & TLB_PFN;
+
+tlbp->tag = tag;
+tlbp->pte = pte;
+if ((pte != -1) && ADDR_IS_MEM (pa + VA_PAGSIZE - 1)) { /* valid, mem page? */
+    tlbp->hp = M + (pa >> 2);
+    tlbp->racc = pte & TLB_RACC;
+    tlbp->wacc = (pte & TLB_M)? pte & TLB_WACC: 0;
+    }
+else {
+    tlbp->hp = NULL;
+    tlbp->racc = tlbp->wacc = 0;
+    }
+return;
+}
+
 extern void set_map_reg (void)
 {
 d_p0br = P0BR & ~03;
@@ -584,9 +705,9 @@ void zap_tb (int stb)
 size_t i;
 
 for (i = 0; i < VA_TBSIZE; i++) {
-    ptlb[i].tag = ptlb[i].pte = -1;
+    tlb_set_ent (&ptlb[i], -1, -1);
     if (stb)
-        stlb[i].tag = stlb[i].pte = -1;
+        tlb_set_ent (&stlb[i], -1, -1);
     }
 return;
 }
@@ -598,8 +719,8 @@ void zap_tb_ent (uint32 va)
 int32 tbi = VA_GETTBI (VA_GETVPN (va));
 
 if (va & VA_S0)
-    stlb[tbi].tag = stlb[tbi].pte = -1;
-else ptlb[tbi].tag = ptlb[tbi].pte = -1;
+    tlb_set_ent (&stlb[tbi], -1, -1);
+else tlb_set_ent (&ptlb[tbi], -1, -1);
 return;
 }
 
@@ -638,17 +759,14 @@ t_stat tlb_dep (t_value val, t_addr addr, UNIT *uptr, int32 sw)
 {
 int32 tlbn = uptr - tlb_unit;
 uint32 idx = (uint32) addr >> 1;
+TLBENT *tlbp;
 
 if (idx >= VA_TBSIZE)
     return SCPE_NXM;
-if (addr & 1) {
-    if (tlbn) stlb[idx].pte = (int32) val;
-    else ptlb[idx].pte = (int32) val;
-    }
-else {
-    if (tlbn) stlb[idx].tag = (int32) val;
-    else ptlb[idx].tag = (int32) val;
-    }
+tlbp = tlbn? &stlb[idx]: &ptlb[idx];
+if (addr & 1)
+    tlb_set_ent (tlbp, tlbp->tag, (int32) val);
+else tlb_set_ent (tlbp, (int32) val, tlbp->pte);
 return SCPE_OK;
 }
 
@@ -658,7 +776,9 @@ t_stat tlb_reset (DEVICE *dptr)
 {
 size_t i;
 
-for (i = 0; i < VA_TBSIZE; i++)
-    stlb[i].tag = ptlb[i].tag = stlb[i].pte = ptlb[i].pte = -1;
+for (i = 0; i < VA_TBSIZE; i++) {
+    tlb_set_ent (&stlb[i], -1, -1);
+    tlb_set_ent (&ptlb[i], -1, -1);
+    }
 return SCPE_OK;
 }
@@ -465,6 +465,7 @@ typedef struct {
 
 int32 Read (uint32 va, int32 lnt, int32 acc);
 void Write (uint32 va, int32 val, int32 lnt, int32 acc);
+uint8 *MapStr (uint32 va, int32 lnt, int32 acc, int32 *mlnt);
 
 /* Function prototypes for physical memory interface (inlined) */
 
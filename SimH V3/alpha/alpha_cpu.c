@@ -23,6 +23,7 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-2026  RMS     Added TLB resync at start of simulation
    03-Mar-2020  RMS     Fixed DMAPEN register declaration (Mark Pizzolato)
    05-Oct-2017  RMS     Fixed reversed definitions of FTOIS, FTOIT (Maurice Marks)
    27-May-2017  RMS     Fixed MIN/MAXx4 iteration counts (Mark Pizzolato)
@@ -239,6 +240,7 @@ extern t_stat pal_proc_trap (uint32 type);
 extern t_stat pal_proc_intr (uint32 type);
 extern t_stat pal_proc_inst (uint32 fnc);
 extern uint32 tlb_set_cm (int32 cm);
+extern void tlb_sync (void);
 
 /* CPU data structures
 
@@ -371,6 +373,7 @@ int abortval;
 t_bool tracing;
 
 PC = PC | pc_align;                                     /* put PC together */
+tlb_sync ();                                            /* resync TLB lookup */
 abortval = setjmp (save_env);                           /* set abort hdlr */
 if (abortval != 0) {                                    /* exception? */
     if (abortval < 0) {                                 /* SCP stop? */
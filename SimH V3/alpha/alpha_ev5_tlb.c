@@ -46,28 +46,56 @@
         tlb_ia                  TLB invalidate all
         tlb_is                  TLB invalidate single
         tlb_set_cm              TLB set current mode
+        tlb_sync                TLB resynchronize lookup structures
+
+   The TLBs are kept in entry (NLU) order.  Lookups go through a small
+   direct-mapped cache of recent translations (the mini-TLB), and then
+   through a hash table per TLB.  An entry is hashed on its VPN with the
+   bits covered by its granularity hint removed, so a lookup probes at most
+   one chain for each granularity hint in use.  Each mini-TLB entry records
+   the TLB entry it came from, so that loading or invalidating an entry
+   only has to invalidate the mini-TLB entries that depend on it.
 */
 
 #include "alpha_defs.h"
 #include "alpha_ev5_defs.h"
 
-#define ITLB_SORT       qsort (itlb, ITLB_SIZE, sizeof (TLBENT), &tlb_comp);
-#define DTLB_SORT       qsort (dtlb, DTLB_SIZE, sizeof (TLBENT), &tlb_comp);
 #define TLB_ESIZE       (sizeof (TLBENT)/sizeof (uint32))
 #define MM_RW(x)        (((x) & PTE_FOW)? EXC_W: EXC_R)
+#define MINI_SIZE       16                              /* mini-TLB size */
+#define MINI_HASH(v)    ((v) & (MINI_SIZE - 1))
+#define TLB_N_GH        4                               /* # gran hints */
+#define TLB_GH_MASK(g)  ((1u << (3 * (g))) - 1)
+#define TLB_HBITS       7                               /* hash table size */
+#define TLB_HSIZE       (1u << TLB_HBITS)
+#define TLB_HASH(v,g)   ((((v) >> (3 * (g))) ^ ((v) >> (3 * (g) + TLB_HBITS))) & (TLB_HSIZE - 1))
+#define TLB_HNIL        0xFF                            /* end of chain */
+
+typedef struct {
+    TLBENT      *tlb;                                   /* TLB */
+    uint32      size;                                   /* TLB size */
+    TLBENT      *mini;                                  /* mini-TLB */
+    uint32      ghcnt[TLB_N_GH];                        /* # hashed per gh */
+    uint8       head[TLB_HSIZE];                        /* chain heads */
+    uint8       next[DTLB_SIZE];                        /* chain links */
+    uint8       bkt[DTLB_SIZE];                         /* bucket, NIL if none */
+    uint8       gh[DTLB_SIZE];                          /* gran hint */
+    } TLBHASH;
 
 uint32 itlb_cm = 0;                                     /* current modes */
 uint32 itlb_spage = 0;                                  /* superpage enables */
 uint32 itlb_asn = 0;
 uint32 itlb_nlu = 0;
-TLBENT i_mini_tlb;
+TLBENT i_mini_tlb[MINI_SIZE];
 TLBENT itlb[ITLB_SIZE];
 uint32 dtlb_cm = 0;
 uint32 dtlb_spage = 0;
 uint32 dtlb_asn = 0;
 uint32 dtlb_nlu = 0;
-TLBENT d_mini_tlb;
+TLBENT d_mini_tlb[MINI_SIZE];
 TLBENT dtlb[DTLB_SIZE];
+static TLBHASH itlb_hash = { itlb, ITLB_SIZE, i_mini_tlb };
+static TLBHASH dtlb_hash = { dtlb, DTLB_SIZE, d_mini_tlb };
 
 uint32 cm_eacc = ACC_E (MODE_K);                        /* precomputed */
 uint32 cm_racc = ACC_R (MODE_K);                        /* access checks */
@@ -83,6 +111,12 @@ t_stat itlb_reset (void);
 t_stat dtlb_reset (void);
 int tlb_comp (const void *e1, const void *e2);
 t_stat tlb_reset (DEVICE *dptr);
+void tlb_sync (void);
+static TLBENT *tlb_hfind (TLBHASH *hp, uint32 vpn, uint32 asn);
+static void tlb_hins (TLBHASH *hp, uint32 i);
+static void tlb_hdel (TLBHASH *hp, uint32 i);
+static void tlb_hbuild (TLBHASH *hp);
+static void tlb_mini_clr (TLBHASH *hp, int32 i);
 
 /* TLB data structures
 
@@ -98,13 +132,13 @@ REG tlb_reg[] = {
     { HRDATA (ISPAGE, itlb_spage, 2), REG_HRO },
     { HRDATA (IASN, itlb_asn, ITB_ASN_WIDTH) },
     { HRDATA (INLU, itlb_nlu, ITLB_WIDTH) },
-    { BRDATA (IMINI, &i_mini_tlb, 16, 32, TLB_ESIZE) },
+    { BRDATA (IMINI, i_mini_tlb, 16, 32, MINI_SIZE * TLB_ESIZE) },
     { BRDATA (ITLB, &itlb, 16, 32, ITLB_SIZE * TLB_ESIZE) },
     { HRDATA (DCM, dtlb_cm, 2) },
     { HRDATA (DSPAGE, dtlb_spage, 2), REG_HRO },
     { HRDATA (DASN, dtlb_asn, DTB_ASN_WIDTH) },
     { HRDATA (DNLU, dtlb_nlu, DTLB_WIDTH) },
-    { BRDATA (DMINI, &d_mini_tlb, 16, 32, TLB_ESIZE) },
+    { BRDATA (DMINI, d_mini_tlb, 16, 32, MINI_SIZE * TLB_ESIZE) },
     { BRDATA (DTLB, &dtlb, 16, 32, DTLB_SIZE * TLB_ESIZE) },
     { NULL }
     };
@@ -195,18 +229,21 @@ void tlb_is (t_uint64 va, uint32 flags)
 {
 uint32 va_sext = VA_GETSEXT (va);
 uint32 vpn = VA_GETVPN (va);
+uint32 i;
 TLBENT *itlbp, *dtlbp;
 
 if ((va_sext != 0) && (va_sext != VA_M_SEXT)) return;
 if ((flags & TLB_CI) && (itlbp = itlb_lookup (vpn))) {
-    tlb_inval (itlbp);
-    tlb_inval (&i_mini_tlb);
-    ITLB_SORT;
+    i = itlbp->idx;                                     /* TLB entry */
+    tlb_hdel (&itlb_hash, i);
+    tlb_inval (&itlb[i]);
+    tlb_mini_clr (&itlb_hash, i);
     }
 if ((flags & TLB_CD) && (dtlbp = dtlb_lookup (vpn))) {
-    tlb_inval (dtlbp);
-    tlb_inval (&d_mini_tlb);
-    DTLB_SORT;
+    i = dtlbp->idx;
+    tlb_hdel (&dtlb_hash, i);
+    tlb_inval (&dtlb[i]);
+    tlb_mini_clr (&dtlb_hash, i);
     }
 return;
 }
@@ -226,15 +263,13 @@ if (flags & TLB_CI) {
     for (i = 0; i < ITLB_SIZE; i++) {
         if (!(itlb[i].pte & PTE_ASM)) tlb_inval (&itlb[i]);
         }
-    tlb_inval (&i_mini_tlb);
-    ITLB_SORT;
+    tlb_hbuild (&itlb_hash);
     }
 if (flags & TLB_CD) {
     for (i = 0; i < DTLB_SIZE; i++) {
         if (!(dtlb[i].pte & PTE_ASM)) tlb_inval (&dtlb[i]);
         }
-    tlb_inval (&d_mini_tlb);
-    DTLB_SORT;
+    tlb_hbuild (&dtlb_hash);
     }
 return;
 }
@@ -243,58 +278,38 @@ return;
 
 TLBENT *itlb_lookup (uint32 vpn)
 {
-int32 p, hi, lo;
+TLBENT *mp = &i_mini_tlb[MINI_HASH (vpn)];
+TLBENT *tlbp;
 
-if (vpn == i_mini_tlb.tag) return &i_mini_tlb;
-lo = 0;                                                 /* initial bounds */
-hi = ITLB_SIZE - 1;
-do {
-    p = (lo + hi) >> 1;                                 /* probe */
-    if ((itlb_asn == itlb[p].asn) && 
-        (((vpn ^ itlb[p].tag) &
-         ~((uint32) itlb[p].gh_mask)) == 0)) {          /* match to TLB? */
-        i_mini_tlb.tag = vpn;
-        i_mini_tlb.pte = itlb[p].pte;
-        i_mini_tlb.pfn = itlb[p].pfn;
-        itlb_nlu = itlb[p].idx + 1;
-        if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
-        return &i_mini_tlb;
-        }
-    if ((itlb_asn < itlb[p].asn) ||
-        ((itlb_asn == itlb[p].asn) && (vpn < itlb[p].tag)))
-        hi = p - 1;                                     /* go down? p is upper */
-    else lo = p + 1;                                    /* go up? p is lower */
-    }
-while (lo <= hi);
-return NULL;
+if (vpn == mp->tag) return mp;                          /* mini-TLB hit? */
+if (!(tlbp = tlb_hfind (&itlb_hash, vpn, itlb_asn)))    /* TLB miss? */
+    return NULL;
+mp->tag = vpn;                                          /* load mini-TLB */
+mp->pte = tlbp->pte;
+mp->pfn = tlbp->pfn;
+mp->asn = tlbp->asn;
+mp->idx = tlbp->idx;
+itlb_nlu = tlbp->idx + 1;
+if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
+return mp;
 }
 
 TLBENT *dtlb_lookup (uint32 vpn)
 {
-int32 p, hi, lo;
+TLBENT *mp = &d_mini_tlb[MINI_HASH (vpn)];
+TLBENT *tlbp;
 
-if (vpn == d_mini_tlb.tag) return &d_mini_tlb;
-lo = 0;                                                 /* initial bounds */
-hi = DTLB_SIZE - 1;
-do {
-    p = (lo + hi) >> 1;                                 /* probe */
-    if ((dtlb_asn == dtlb[p].asn) && 
-        (((vpn ^ dtlb[p].tag) &
-         ~((uint32) dtlb[p].gh_mask)) == 0)) {          /* match to TLB? */
-        d_mini_tlb.tag = vpn;
-        d_mini_tlb.pte = dtlb[p].pte;
-        d_mini_tlb.pfn = dtlb[p].pfn;
-        dtlb_nlu = dtlb[p].idx + 1;
-        if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
-        return &d_mini_tlb;
-        }
-    if ((dtlb_asn < dtlb[p].asn) ||
-        ((dtlb_asn == dtlb[p].asn) && (vpn < dtlb[p].tag)))
-        hi = p - 1;                                     /* go down? p is upper */
-    else lo = p + 1;                                    /* go up? p is lower */
-    }
-while (lo <= hi);
-return NULL;
+if (vpn == mp->tag) return mp;                          /* mini-TLB hit? */
+if (!(tlbp = tlb_hfind (&dtlb_hash, vpn, dtlb_asn)))    /* TLB miss? */
+    return NULL;
+mp->tag = vpn;                                          /* load mini-TLB */
+mp->pte = tlbp->pte;
+mp->pfn = tlbp->pfn;
+mp->asn = tlbp->asn;
+mp->idx = tlbp->idx;
+dtlb_nlu = tlbp->idx + 1;
+if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
+return mp;
 }
 
 /* Load TLB entry at NLU pointer, advance NLU pointer */
@@ -303,21 +318,21 @@ TLBENT *itlb_load (uint32 vpn, t_uint64 l3pte)
 {
 uint32 i, gh;
 
-for (i = 0; i < ITLB_SIZE; i++) {
-    if (itlb[i].idx == itlb_nlu) {
-        TLBENT *tlbp = itlb + i;
-        itlb_nlu = itlb_nlu + 1;
-        if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
-        tlbp->tag = vpn;
-        tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
-        tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
-        tlbp->asn = itlb_asn;
-        gh = PTE_GETGH (tlbp->pte);
-        tlbp->gh_mask = (1u << (3 * gh)) - 1;
-        tlb_inval (&i_mini_tlb);
-        ITLB_SORT;
-        return tlbp;
-        }
+i = itlb_nlu;                                           /* TLB in NLU order */
+if ((i < ITLB_SIZE) && (itlb[i].idx == i)) {
+    TLBENT *tlbp = itlb + i;
+    tlb_hdel (&itlb_hash, i);                           /* unhash old */
+    tlb_mini_clr (&itlb_hash, i);
+    itlb_nlu = itlb_nlu + 1;
+    if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
+    tlbp->tag = vpn;
+    tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
+    tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
+    tlbp->asn = itlb_asn;
+    gh = PTE_GETGH (tlbp->pte);
+    tlbp->gh_mask = (1u << (3 * gh)) - 1;
+    tlb_hins (&itlb_hash, i);                           /* hash new */
+    return tlbp;
     }
 fprintf (stderr, "%%ITLB entry not found, itlb_nlu = %d\n", itlb_nlu);
 ABORT (-SCPE_IERR);
@@ -328,21 +343,21 @@ TLBENT *dtlb_load (uint32 vpn, t_uint64 l3pte)
 {
 uint32 i, gh;
 
-for (i = 0; i < DTLB_SIZE; i++) {
-    if (dtlb[i].idx == dtlb_nlu) {
-        TLBENT *tlbp = dtlb + i;
-        dtlb_nlu = dtlb_nlu + 1;
-        if (dtlb_nlu >= ITLB_SIZE) dtlb_nlu = 0;
-        tlbp->tag = vpn;
-        tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
-        tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
-        tlbp->asn = dtlb_asn;
-        gh = PTE_GETGH (tlbp->pte);
-        tlbp->gh_mask = (1u << (3 * gh)) - 1;
-        tlb_inval (&d_mini_tlb);
-        DTLB_SORT;
-        return tlbp;
-        }
+i = dtlb_nlu;                                           /* TLB in NLU order */
+if ((i < DTLB_SIZE) && (dtlb[i].idx == i)) {
+    TLBENT *tlbp = dtlb + i;
+    tlb_hdel (&dtlb_hash, i);                           /* unhash old */
+    tlb_mini_clr (&dtlb_hash, i);
+    dtlb_nlu = dtlb_nlu + 1;
+    if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
+    tlbp->tag = vpn;
+    tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
+    tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
+    tlbp->asn = dtlb_asn;
+    gh = PTE_GETGH (tlbp->pte);
+    tlbp->gh_mask = (1u << (3 * gh)) - 1;
+    tlb_hins (&dtlb_hash, i);                           /* hash new */
+    return tlbp;
     }
 fprintf (stderr, "%%DTLB entry not found, dtlb_nlu = %d\n", dtlb_nlu);
 ABORT (-SCPE_IERR);
@@ -353,16 +368,15 @@ return NULL;
 
 t_uint64 itlb_read (void)
 {
-uint8 i;
+uint32 i;
 
-for (i = 0; i < ITLB_SIZE; i++) {
-    if (itlb[i].idx == itlb_nlu) {
-        TLBENT *tlbp = itlb + i;
-        itlb_nlu = itlb_nlu + 1;
-        if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
-        return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
-            ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
-        }
+i = itlb_nlu;                                           /* TLB in NLU order */
+if ((i < ITLB_SIZE) && (itlb[i].idx == i)) {
+    TLBENT *tlbp = itlb + i;
+    itlb_nlu = itlb_nlu + 1;
+    if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
+    return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
+        ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
     }
 fprintf (stderr, "%%ITLB entry not found, itlb_nlu = %d\n", itlb_nlu);
 ABORT (-SCPE_IERR);
@@ -371,16 +385,15 @@ return 0;
 
 t_uint64 dtlb_read (void)
 {
-uint8 i;
+uint32 i;
 
-for (i = 0; i < DTLB_SIZE; i++) {
-    if (dtlb[i].idx == dtlb_nlu) {
-        TLBENT *tlbp = dtlb + i;
-        dtlb_nlu = dtlb_nlu + 1;
-        if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
-        return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
-            ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
-        }
+i = dtlb_nlu;                                           /* TLB in NLU order */
+if ((i < DTLB_SIZE) && (dtlb[i].idx == i)) {
+    TLBENT *tlbp = dtlb + i;
+    dtlb_nlu = dtlb_nlu + 1;
+    if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
+    return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
+        ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
     }
 fprintf (stderr, "%%DTLB entry not found, dtlb_nlu = %d\n", dtlb_nlu);
 ABORT (-SCPE_IERR);
@@ -397,8 +410,8 @@ itlb_asn = asn;
 for (i = 0; i < ITLB_SIZE; i++) {
     if (itlb[i].pte & PTE_ASM) itlb[i].asn = asn;
     }
-tlb_inval (&i_mini_tlb);
-ITLB_SORT;
+for (i = 0; i < MINI_SIZE; i++)                         /* flush mini-TLB */
+    tlb_inval (&i_mini_tlb[i]);
 return;
 } 
 
@@ -410,8 +423,8 @@ dtlb_asn = asn;
 for (i = 0; i < DTLB_SIZE; i++) {
     if (dtlb[i].pte & PTE_ASM) dtlb[i].asn = asn;
     }
-tlb_inval (&d_mini_tlb);
-DTLB_SORT;
+for (i = 0; i < MINI_SIZE; i++)                         /* flush mini-TLB */
+    tlb_inval (&d_mini_tlb[i]);
 return;
 }
 
@@ -477,13 +490,113 @@ int tlb_comp (const void *e1, const void *e2)
 TLBENT *t1 = (TLBENT *) e1;
 TLBENT *t2 = (TLBENT *) e2;
 
-if (t1->asn > t2->asn) return +1;
-if (t1->asn < t2->asn) return -1;
-if (t1->tag > t2->tag) return +1;
-if (t1->tag < t2->tag) return -1;
+if (t1->idx > t2->idx) return +1;
+if (t1->idx < t2->idx) return -1;
 return 0;
 }
 
+/* Hashed lookup - probe the chain for each granularity hint in use */
+
+static TLBENT *tlb_hfind (TLBHASH *hp, uint32 vpn, uint32 asn)
+{
+uint32 g, i, m;
+TLBENT *tlbp;
+
+for (g = 0; g < TLB_N_GH; g++) {
+    if (hp->ghcnt[g] == 0) continue;
+    m = TLB_GH_MASK (g);
+    for (i = hp->head[TLB_HASH (vpn & ~m, g)]; i != TLB_HNIL; i = hp->next[i]) {
+        tlbp = hp->tlb + i;
+        if ((tlbp->asn == asn) && (tlbp->gh_mask == m) &&
+            (((vpn ^ tlbp->tag) & ~m) == 0))
+            return tlbp;
+        }
+    }
+return NULL;
+}
+
+/* Insert entry in hash table */
+
+static void tlb_hins (TLBHASH *hp, uint32 i)
+{
+TLBENT *tlbp = hp->tlb + i;
+uint32 g, b;
+
+if (tlbp->tag == INV_TAG) {                             /* invalid? */
+    hp->bkt[i] = TLB_HNIL;
+    return;
+    }
+for (g = 0; (g < (TLB_N_GH - 1)) && (tlbp->gh_mask != TLB_GH_MASK (g)); g++) ;
+b = TLB_HASH (tlbp->tag & ~TLB_GH_MASK (g), g);
+hp->gh[i] = g;
+hp->bkt[i] = b;
+hp->next[i] = hp->head[b];
+hp->head[b] = i;
+hp->ghcnt[g]++;
+return;
+}
+
+/* Delete entry from hash table */
+
+static void tlb_hdel (TLBHASH *hp, uint32 i)
+{
+uint8 *lp;
+
+if (hp->bkt[i] == TLB_HNIL)                             /* not hashed? */
+    return;
+for (lp = &hp->head[hp->bkt[i]]; *lp != TLB_HNIL; lp = &hp->next[*lp]) {
+    if (*lp == i) {
+        *lp = hp->next[i];
+        break;
+        }
+    }
+hp->ghcnt[hp->gh[i]]--;
+hp->bkt[i] = TLB_HNIL;
+return;
+}
+
+/* Rebuild hash table, flush mini-TLB */
+
+static void tlb_hbuild (TLBHASH *hp)
+{
+uint32 i;
+
+for (i = 0; i < TLB_N_GH; i++)
+    hp->ghcnt[i] = 0;
+for (i = 0; i < TLB_HSIZE; i++)
+    hp->head[i] = TLB_HNIL;
+for (i = 0; i < hp->size; i++)
+    tlb_hins (hp, i);
+for (i = 0; i < MINI_SIZE; i++)
+    tlb_inval (&hp->mini[i]);
+return;
+}
+
+/* Invalidate mini-TLB entries derived from a TLB entry */
+
+static void tlb_mini_clr (TLBHASH *hp, int32 i)
+{
+uint32 j;
+
+for (j = 0; j < MINI_SIZE; j++) {
+    if ((hp->mini[j].tag != INV_TAG) && (hp->mini[j].idx == i))
+        tlb_inval (&hp->mini[j]);
+    }
+return;
+}
+
+/* Resynchronize lookup structures with the TLBs, which may have been
+   changed from the console (DEPOSIT, RESTORE) */
+
+void tlb_sync (void)
+{
+qsort (itlb, ITLB_SIZE, sizeof (TLBENT), &tlb_comp);    /* put in NLU order */
+qsort (dtlb, DTLB_SIZE, sizeof (TLBENT), &tlb_comp);
+tlb_hbuild (&itlb_hash);
+tlb_hbuild (&dtlb_hash);
+return;
+}
+
 /* ITLB reset */
 
 t_stat itlb_reset (void)
@@ -499,7 +612,7 @@ for (i = 0; i < ITLB_SIZE; i++) {
     itlb[i].gh_mask = 0;
     itlb[i].idx = i;
     }
-tlb_inval (&i_mini_tlb);
+tlb_hbuild (&itlb_hash);
 return SCPE_OK;
 }
 /* DTLB reset */
@@ -517,7 +630,7 @@ for (i = 0; i < DTLB_SIZE; i++) {
     dtlb[i].gh_mask = 0;
     dtlb[i].idx = i;
     }
-tlb_inval (&d_mini_tlb);
+tlb_hbuild (&dtlb_hash);
 return SCPE_OK;
 }
 
@@ -23,6 +23,20 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Made PC sampling idle-able, fixed symbol load errors
+                        Checked SAVE -I base file identity on RESTORE
+                        Recorded SAVE -I base file by absolute path
+                        Added draining of history streams
+                        Added PC sampling, SET/SHOW SAMPLE, sim_vm_sample_pc
+                        Added service profiling, SET/SHOW PROFILE
+                        Added delivery of asynchronous wakeups on every event
+                        Added dirty page tracking, SET/SHOW DIRTY
+                        Added SAVE -I, compressed and bulk memory save (V3.6)
+                        Added ATTACH -M (map file to memory)
+                        Added BENCHMARK command
+                        Added SET/SHOW ASYNCH, drain asynchronous I/O on stop
+                        Added batched dispatch of events due on the same tick
+                        Replaced delta list event queue with binary heap
    07-Feb-23    RMS     Silenced Mac compiler warnings (Ken Rector)
    01-Oct-22    RMS     Replaced readline with editline due to licensing issues (Paul Koning)
    15-Aug-22    RMS     Fixed inconsistent SIM_HAVE_DLOPEN naming (Walter Mueller)
@@ -244,6 +258,7 @@
 #include <signal.h>
 #include <ctype.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #if defined(HAVE_EDITLINE)                              /* Editline command line editing */
 #include <editline/readline.h>
@@ -265,10 +280,25 @@
 
 #define DO_NEST_LVL     10                              /* DO cmd nesting level */
 #define SRBSIZ          1024                            /* save/restore buffer */
+#define SR_ZERO         0                               /* [V3.6] all zero block */
+#define SR_LIT          1                               /* [V3.6] literal block */
+#define SR_ZLIB         2                               /* [V3.6] compressed block */
+#define SR_SAME         3                               /* [V3.6] same as base */
+#define SR_MAXNEST      64                              /* max incremental chain */
 #define SIM_BRK_INILNT  4096                            /* bpt tbl length */
 #define SIM_BRK_ALLTYP  0xFFFFFFFF
+#define SIM_QINILNT     64                              /* event queue length */
+#define BENCH_DINST     10000000                        /* bench dflt instructions */
+#define BENCH_DSEC      10                              /* bench dflt seconds */
+#define BENCH_POLL      10000                           /* bench deadline poll */
+#define BENCH_NSPS      1000000000                      /* nsec per second */
+#define PROF_NQH        16                              /* queue depth buckets */
+#define SAMP_DINTV      10000                           /* dflt sample interval */
+#define SAMP_INILNT     1024                            /* initial hash size */
+#define SAMP_DSHOW      20                              /* dflt entries shown */
 #define UPDATE_SIM_TIME(x) sim_time = sim_time + (x - sim_interval); \
     sim_rtime = sim_rtime + ((uint32) (x - sim_interval)); \
+    sim_qnow = sim_qnow + (x - sim_interval); \
     x = sim_interval
 
 #define SZ_D(dp) (size_map[((dp)->dwidth + CHAR_BIT - 1) / CHAR_BIT])
@@ -307,6 +337,7 @@ void (*sim_vm_fprint_addr) (FILE *st, DEVICE *dptr, t_addr addr) = NULL;
 t_addr (*sim_vm_parse_addr) (DEVICE *dptr, char *cptr, char **tptr) = NULL;
 t_bool (*sim_vm_fprint_stopped) (FILE *st, t_stat reason) = NULL;
 t_bool (*sim_vm_is_subroutine_call) (t_addr **ret_addrs) = NULL;
+t_addr (*sim_vm_sample_pc) (uint32 *mode) = NULL;
 
 /* Prototypes */
 
@@ -391,6 +422,21 @@ t_stat ex_addr (FILE *ofile, int32 flag, t_addr addr, DEVICE *dptr,
 t_stat dep_addr (int32 flag, char *cptr, t_addr addr, DEVICE *dptr,
     UNIT *uptr, int32 dfltinc);
 t_stat step_svc (UNIT *ptr);
+t_stat bench_svc (UNIT *ptr);
+void bench_start (uint32 lim);
+void bench_stop (void);
+void bench_report (FILE *st);
+void prof_start (void);
+void prof_stop (void);
+void prof_svc (UNIT *uptr, t_uint64 ns);
+void prof_act (UNIT *uptr, int32 event_time);
+t_stat samp_svc (UNIT *uptr);
+int32 samp_next (void);
+void sim_snap_setbase (char *fname);
+static void sim_snap_fullpath (const char *fname, char *path);
+static void sim_snap_newid (char *id);
+void sim_qflush (void);
+int sim_qcomp (const void *e1, const void *e2);
 void sub_args_local (char *instr, char *tmpbuf, int32 maxstr, char *do_arg[]);
 int32 get_radix_local (const char *cptr, int32 switches, int32 default_radix);
 
@@ -427,7 +473,96 @@ int32 sim_quiet = 0;
 int32 sim_step = 0;
 static double sim_time;
 static uint32 sim_rtime;
-static int32 noqueue_time;
+static int32 sim_qintv;                                 /* interval at last update */
+static t_int64 sim_qnow = 0;                            /* event queue clock */
+static t_uint64 sim_qseq = 0;                           /* insertion sequence */
+static int32 sim_qcnt = 0;                              /* entries in use */
+static int32 sim_qlnt = 0;                              /* entries allocated */
+
+typedef struct {
+    t_int64             time;                           /* absolute due time */
+    t_uint64            seq;                            /* insertion order */
+    UNIT                *uptr;                          /* unit */
+    } SIM_QENT;
+
+static SIM_QENT *sim_qheap = NULL;                      /* event queue heap */
+static SIM_QENT *sim_qbat = NULL;                       /* events being dispatched */
+static UNIT **sim_qulist = NULL;                        /* device batch list */
+static int32 sim_qblnt = 0;                             /* batch entries allocated */
+static int32 sim_qbcnt = 0;                             /* batch entries in use */
+static int32 sim_qbpend = 0;                            /* batch entries pending */
+static t_uint64 sim_qndisp = 0;                         /* events dispatched */
+
+typedef struct {
+    UNIT                *uptr;                          /* memory unit */
+    t_addr              high;                           /* size when hashed */
+    uint32              npg;                            /* number of blocks */
+    t_bool              valid;                          /* hashes match base */
+    t_uint64            *hash;                          /* block hashes */
+    } SNAPTAB;
+
+static SNAPTAB *sim_snap_tab = NULL;                    /* snapshot block hashes */
+static int32 sim_snap_cnt = 0;
+static char sim_snap_base[CBUFSIZE] = "";               /* last save/restore file */
+static char sim_snap_baseid[CBUFSIZE] = "";             /* its identifier */
+static char sim_snap_lastid[CBUFSIZE] = "";             /* id of last file read/written */
+static int32 sim_rest_nest = 0;                         /* restore nesting level */
+uint32 *sim_dirty_map = NULL;                           /* bitmap, NULL if off */
+uint32 sim_dirty_shift = 0;                             /* log2 page size */
+static UNIT *sim_dirty_unit = NULL;                     /* tracked unit */
+static uint32 sim_dirty_npg = 0;                        /* # pages */
+static t_bool sim_dirty_enb = FALSE;                    /* tracking enabled */
+static t_bool sim_bench_on = FALSE;                     /* benchmark running */
+static t_bool sim_bench_idle;                           /* saved idle enable */
+static double sim_bench_inst;                           /* instructions */
+static t_uint64 sim_bench_nevt;                         /* events dispatched */
+static t_uint64 sim_bench_ncall;                        /* event queue calls */
+static t_uint64 sim_bench_qsum;                         /* sum of queue depths */
+static int32 sim_bench_qmax;                            /* max queue depth */
+static t_uint64 sim_bench_evns;                         /* nsec in event service */
+static t_uint64 sim_bench_wall;                         /* nsec total */
+static t_uint64 sim_bench_end;                          /* nsec deadline */
+
+struct sim_prof {
+    t_uint64            ndisp;                          /* dispatches */
+    t_uint64            nsec;                           /* nsec in service */
+    t_uint64            nsmax;                          /* longest service */
+    t_uint64            nact;                           /* activations */
+    double              ivsum;                          /* sum of intervals */
+    int32               ivmin;                          /* shortest interval */
+    int32               ivmax;                          /* longest interval */
+    };
+
+static t_bool sim_prof_on = FALSE;                      /* profiling enabled */
+static UNIT **sim_prof_ulist = NULL;                    /* profiled units */
+static int32 sim_prof_ucnt = 0;
+static int32 sim_prof_ulnt = 0;
+static t_uint64 sim_prof_qhist[PROF_NQH];               /* queue depth histogram */
+static t_uint64 sim_prof_wall = 0;                      /* nsec profiled */
+static t_uint64 sim_prof_start = 0;                     /* start of interval */
+static double sim_prof_inst = 0.0;                      /* instructions profiled */
+static double sim_prof_istart = 0.0;
+
+typedef struct {
+    t_addr              pc;                             /* sampled PC */
+    uint32              mode;                           /* processor mode */
+    t_uint64            count;                          /* samples, 0 if free */
+    } SAMPENT;
+
+typedef struct {
+    t_addr              addr;                           /* symbol address */
+    char                *name;                          /* symbol name */
+    } SAMPSYM;
+
+static t_bool sim_samp_on = FALSE;                      /* sampling enabled */
+static int32 sim_samp_intv = SAMP_DINTV;                /* sample interval */
+static uint32 sim_samp_seed = 1;                        /* interval jitter */
+static SAMPENT *sim_samp_tab = NULL;                    /* PC hash table */
+static uint32 sim_samp_lnt = 0;                         /* table size */
+static uint32 sim_samp_cnt = 0;                         /* entries in use */
+static t_uint64 sim_samp_total = 0;                     /* samples taken */
+static SAMPSYM *sim_samp_sym = NULL;                    /* symbol map */
+static int32 sim_samp_nsym = 0;
 volatile int32 stop_cpu = 0;
 t_value *sim_eval = NULL;
 FILE *sim_log = NULL;                                   /* log file */
@@ -437,6 +572,8 @@ char *sim_prog_name;                                    /* pointer to the execut
 uint32 sim_ref_type = REF_NONE;                         /* reference type */
 
 static UNIT sim_step_unit = { UDATA (&step_svc, 0, 0)  };
+static UNIT sim_bench_unit = { UDATA (&bench_svc, 0, 0)  };
+static UNIT sim_samp_unit = { UDATA (&samp_svc, UNIT_IDLE, 0)  };
 #if defined USE_INT64
 static const char *sim_si64 = "64b data";
 #else
@@ -452,11 +589,15 @@ const char *eth_capabilities(void);
 #else
 #define eth_capabilities()     "no Ethernet"
 #endif
+#if defined (HAVE_ZLIB)
+#include <zlib.h>
+#endif
 
 
 /* Tables and strings */
 
-const char save_vercur[] = "V3.5";
+const char save_vercur[] = "V3.6";
+const char save_ver35[] = "V3.5";
 const char save_ver32[] = "V3.2";
 const char save_ver30[] = "V3.0";
 const char *scp_error_messages[] = {
@@ -558,12 +699,16 @@ static CTAB cmd_table[] = {
       "c{ont}                   continue simulation\n" },
     { "BOOT", &run_cmd, RU_BOOT,
       "b{oot} <unit>            bootstrap unit\n" },
+    { "BENCHMARK", &run_cmd, RU_BENCH,
+      "be{nchmark} {n}          run n instructions at full speed, report rate\n"
+      "be{nchmark} -t {n}       run n seconds at full speed, report rate\n" },
     { "BREAK", &brk_cmd, SSH_ST,
       "br{eak} <list>           set breakpoints\n" },
     { "NOBREAK", &brk_cmd, SSH_CL,
       "nobr{eak} <list>         clear breakpoints\n" },
     { "ATTACH", &attach_cmd, 0,
-      "at{tach} <unit> <file>   attach file to simulated unit\n" },
+      "at{tach} <unit> <file>   attach file to simulated unit\n"
+      "at{tach} -m <unit> <file> attach file, mapped to memory\n" },
     { "DETACH", &detach_cmd, 0,
       "det{ach} <unit>          detach file from simulated unit\n" },
     { "ASSIGN", &assign_cmd, 0,
@@ -571,7 +716,8 @@ static CTAB cmd_table[] = {
     { "DEASSIGN", &deassign_cmd, 0,
       "dea{ssign} <device>      deassign logical name for device\n" },
     { "SAVE", &save_cmd, 0,
-      "sa{ve} <file>            save simulator to file\n" },
+      "sa{ve} <file>            save simulator to file\n"
+      "sa{ve} -i <file>         save changes since last save or restore\n" },
     { "RESTORE", &restore_cmd, 0,
       "rest{ore}|ge{t} <file>   restore simulator from file\n" },
     { "GET", &restore_cmd, 0, NULL },
@@ -589,6 +735,13 @@ static CTAB cmd_table[] = {
       "set nobreak <list>       clear breakpoints\n"
       "set throttle x{M|K|%%}    set simulation rate\n"
       "set nothrottle           set simulation rate to maximum\n"
+      "set asynch               enable asynchronous I/O\n"
+      "set noasynch             disable asynchronous I/O\n"
+      "set profile              clear and start event service profile\n"
+      "set noprofile            stop event service profile\n"
+      "set sample {n}           clear and start sampling PC every n instructions\n"
+      "set sample map=<file>    load symbol map for PC samples\n"
+      "set nosample             stop PC sampling\n"
       "set <dev> OCT|DEC|HEX    set device display radix\n"
       "set <dev> ENABLED        enable device\n"
       "set <dev> DISABLED       disable device\n"
@@ -612,6 +765,9 @@ static CTAB cmd_table[] = {
       "sh{ow} q{ueue}           show event queue\n"
       "sh{ow} ti{me}            show simulated time\n"
       "sh{ow} th{rottle}        show simulation rate\n"
+      "sh{ow} as{ynch}          show asynchronous I/O state\n"
+      "sh{ow} {-c} pro{file}    show event service profile {as CSV}\n"
+      "sh{ow} {-c} sa{mple} {n} show n most frequent PC samples {all as CSV}\n"
       "sh{ow} ve{rsion}         show simulator version\n"
       "sh{ow} <dev> RADIX       show device display radix\n"
       "sh{ow} <dev> DEBUG       show device debug flags\n"
@@ -649,6 +805,14 @@ static CTAB set_glob_tab[] = {
     { "NODEBUG", &sim_set_deboff, 0 },                  /* deprecated */
     { "THROTTLE", &sim_set_throt, 1 },
     { "NOTHROTTLE", &sim_set_throt, 0 },
+    { "ASYNCH", &sim_set_asynch, 1 },
+    { "NOASYNCH", &sim_set_asynch, 0 },
+    { "DIRTY", &sim_set_dirty, 1 },
+    { "NODIRTY", &sim_set_dirty, 0 },
+    { "PROFILE", &sim_set_profile, 1 },
+    { "NOPROFILE", &sim_set_profile, 0 },
+    { "SAMPLE", &sim_set_sample, 1 },
+    { "NOSAMPLE", &sim_set_sample, 0 },
     { NULL, NULL, 0 }
     };
 
@@ -688,6 +852,10 @@ static SHTAB show_glob_tab[] = {
     { "TELNET", &sim_show_telnet, 0 },                  /* deprecated */
     { "DEBUG", &sim_show_debug, 0 },                    /* deprecated */
     { "THROTTLE", &sim_show_throt, 0 },
+    { "ASYNCH", &sim_show_asynch, 0 },
+    { "DIRTY", &sim_show_dirty, 0 },
+    { "PROFILE", &sim_show_profile, 0 },
+    { "SAMPLE", &sim_show_sample, 0 },
     { "CLOCKS", &sim_show_timers, 0 },
     { NULL, NULL, 0 }
     };
@@ -753,8 +921,7 @@ sim_finit();                                            /* init fio package */
 stop_cpu = 0;
 sim_interval = 0;
 sim_time = sim_rtime = 0;
-noqueue_time = 0;
-sim_clock_queue = NULL;
+sim_qflush ();
 sim_is_running = 0;
 sim_log = NULL;
 if (sim_emax <= 0)
@@ -831,6 +998,7 @@ while (stat != SCPE_EXIT) {                             /* in case exit */
     }                                                   /* end while */
 
 detach_all (0, TRUE);                                   /* close device files */
+sim_hs_closeall ();                                     /* close history */
 tmxr_post_logs (TRUE);                                  /* close all mux log files */
 sim_set_deboff (0, NULL);                               /* close debug */
 sim_set_logoff (0, NULL);                               /* close log */
@@ -1680,22 +1848,29 @@ t_stat show_queue (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char
 {
 DEVICE *dptr;
 UNIT *uptr;
-int32 accum;
+SIM_QENT *qlist;
+int32 i;
 char *vptr;
 
 if (cptr && (*cptr != 0))
     return SCPE_2MARG;
-if (sim_clock_queue == NULL) {
+if (sim_qcnt == 0) {
     fprintf (st, "%s event queue empty, time = %.0f\n",
         sim_name, sim_time);
     return SCPE_OK;
     }
+if ((qlist = (SIM_QENT *) malloc (sim_qcnt * sizeof (SIM_QENT))) == NULL)
+    return SCPE_MEM;
+memcpy (qlist, sim_qheap, sim_qcnt * sizeof (SIM_QENT));
+qsort (qlist, sim_qcnt, sizeof (SIM_QENT), sim_qcomp);  /* heap to clock order */
 fprintf (st, "%s event queue status, time = %.0f\n",
      sim_name, sim_time);
-accum = 0;
-for (uptr = sim_clock_queue; uptr != NULL; uptr = uptr->next) {
+for (i = 0; i < sim_qcnt; i++) {
+    uptr = qlist[i].uptr;
     if (uptr == &sim_step_unit)
         fprintf (st, "  Step timer");
+    else if (uptr == &sim_aio_unit)
+        fprintf (st, "  Asynch I/O poll");
     else if (sim_vm_unit_name && (vptr = sim_vm_unit_name (uptr)))
         fprintf (st, "  %s", vptr);
     else if ((dptr = find_dev_from_unit (uptr)) != NULL) {
@@ -1704,9 +1879,9 @@ for (uptr = sim_clock_queue; uptr != NULL; uptr = uptr->next) {
             fprintf (st, " unit %d", (int32) (uptr - dptr->units));
         }
     else fprintf (st, "  Unknown");
-    fprintf (st, " at %d\n", accum + uptr->time);
-    accum = accum + uptr->time;
+    fprintf (st, " at %d\n", (int32) (qlist[i].time - sim_qnow));
     }
+free (qlist);
 return SCPE_OK;
 }
 
@@ -2089,6 +2264,8 @@ if (loadfile == NULL)
 GET_SWITCHES (cptr);                                    /* get switches */
 reason = sim_load (loadfile, cptr, gbuf, flag);         /* load or dump */
 fclose (loadfile);
+if (flag == 0)                                          /* memory changed */
+    sim_dirty_all ();
 return reason;
 }
 
@@ -2225,6 +2402,16 @@ else {                                                  /* normal */
             }
         }                                               /* end if null */
     }                                                   /* end else */
+if ((sim_switches & SWMASK ('M')) &&                    /* map to memory? */
+    !(uptr->flags & UNIT_BUFABLE) &&                    /* not buffered, */
+    !(uptr->dynflags & UNIT_PIPE)) {                    /* not a pipe? */
+    if (sim_fmap (uptr) != SCPE_OK) {                   /* map failed? */
+        if (!sim_quiet)
+            sim_printf ("%s: unable to map file, using file I/O\n", sim_dname (dptr));
+        }
+    else if ((uptr->mapbase != NULL) && !sim_quiet)
+        sim_printf ("%s: file mapped to memory\n", sim_dname (dptr));
+    }
 if (uptr->flags & UNIT_BUFABLE) {                       /* buffer? */
     uint32 cap = ((uint32) uptr->capac) / dptr->aincr;  /* effective size */
     if (uptr->flags & UNIT_MUSTBUF)                     /* dyn alloc? */
@@ -2360,6 +2547,7 @@ if ((uptr->flags & UNIT_BUF) && (uptr->filebuf)) {      /* buffered? */
 uptr->flags = uptr->flags & ~(UNIT_ATT |                /* clear ATT */
     ((uptr->flags & UNIT_ROABLE) ? UNIT_RO : 0));       /* clear RO if dynamic */
 uptr->dynflags = uptr->dynflags & ~UNIT_PIPE;           /* clear the pipe flag */
+sim_funmap (uptr);                                      /* unmap file */
 free (uptr->filename);
 uptr->filename = NULL;
 if (fclose (uptr->fileref) == EOF)
@@ -2462,43 +2650,542 @@ return uname;
 /* Save command
 
    sa[ve] filename              save state to specified file
+   sa[ve] -i filename           save state, with memory blocks that have
+                                not changed since the last SAVE or RESTORE
+                                taken from that file
 */
 
 t_stat save_cmd (int32 flag, char *cptr)
 {
 FILE *sfile;
 t_stat r;
+char path[CBUFSIZE];
 GET_SWITCHES (cptr);                                    /* get switches */
 if (*cptr == 0)                                         /* must be more */
     return SCPE_2FARG;
 sim_trim_endspc (cptr);
+if (sim_switches & SWMASK ('I')) {                      /* incremental? */
+    if (sim_snap_base[0] == 0) {                        /* need a base */
+        sim_printf ("No previous SAVE or RESTORE file\n");
+        return SCPE_ARG;
+        }
+    sim_snap_fullpath (cptr, path);
+    if (strcmp (path, sim_snap_base) == 0)              /* can't overwrite it */
+        return SCPE_ARG;
+    }
 if ((sfile = sim_fopen (cptr, "wb")) == NULL)
     return SCPE_OPENERR;
 r = sim_save (sfile);
 fclose (sfile);
+sim_snap_setbase ((r == SCPE_OK)? cptr: NULL);         /* new base */
+return r;
+}
+
+/* Dirty page tracking
+
+   A simulator names the unit that holds main memory, and the page size in
+   that unit's addresses, by calling sim_dirty_setup from its CPU reset
+   routine, and marks every write to memory with SIM_DIRTY (addr).  While
+   tracking is enabled (SET DIRTY), there is a bit per page, set when the
+   page is written; while it is disabled, sim_dirty_map is NULL and
+   SIM_DIRTY does nothing.  The CPU's deposit routine marks the pages it
+   changes; LOAD, BOOT and RESTORE mark all of memory.
+
+   sim_dirty_test answers TRUE unless it can show that a range has not been
+   written since the last sim_dirty_clear.  The reference point is the last
+   SAVE or RESTORE file, so SAVE -I can record clean blocks without reading
+   them.  Enabling tracking or resizing memory marks every page dirty.
+*/
+
+#define DIRTY_NW(n)     (((n) + 31) >> 5)               /* map size, words */
+
+static uint32 sim_dirty_pages (UNIT *uptr, uint32 shift)
+{
+return (uint32) ((uptr->capac + ((t_addr) 1 << shift) - 1) >> shift);
+}
+
+static t_stat sim_dirty_alloc (void)
+{
+uint32 npg;
+
+free (sim_dirty_map);
+sim_dirty_map = NULL;
+sim_dirty_npg = 0;
+if (!sim_dirty_enb || (sim_dirty_unit == NULL))         /* off? */
+    return SCPE_OK;
+npg = sim_dirty_pages (sim_dirty_unit, sim_dirty_shift);
+if (npg == 0)
+    return SCPE_OK;
+sim_dirty_map = (uint32 *) malloc (DIRTY_NW (npg) * sizeof (uint32));
+if (sim_dirty_map == NULL)
+    return SCPE_MEM;
+sim_dirty_npg = npg;
+sim_dirty_all ();                                       /* all dirty */
+return SCPE_OK;
+}
+
+/* Name the tracked unit; keep the map if nothing has changed */
+
+t_stat sim_dirty_setup (UNIT *uptr, uint32 shift)
+{
+if ((uptr == sim_dirty_unit) && (shift == sim_dirty_shift) &&
+    (sim_dirty_enb == (sim_dirty_map != NULL)) &&
+    (sim_dirty_npg == (sim_dirty_enb? sim_dirty_pages (uptr, shift): 0)))
+    return SCPE_OK;
+sim_dirty_unit = uptr;
+sim_dirty_shift = shift;
+return sim_dirty_alloc ();
+}
+
+/* Mark a range of addresses dirty */
+
+void sim_dirty_mark (UNIT *uptr, t_addr addr, t_addr lnt)
+{
+uint32 pg, lpg;
+
+if ((sim_dirty_map == NULL) || (uptr != sim_dirty_unit) || (lnt == 0))
+    return;
+pg = (uint32) (addr >> sim_dirty_shift);
+lpg = (uint32) ((addr + lnt - 1) >> sim_dirty_shift);
+if (lpg >= sim_dirty_npg)
+    lpg = sim_dirty_npg - 1;
+for ( ; pg <= lpg; pg++)
+    sim_dirty_map[pg >> 5] |= (1u << (pg & 0x1F));
+return;
+}
+
+void sim_dirty_all (void)
+{
+if (sim_dirty_map != NULL)
+    memset (sim_dirty_map, 0xFF, DIRTY_NW (sim_dirty_npg) * sizeof (uint32));
+return;
+}
+
+/* Test whether any page in a range may have been written */
+
+t_bool sim_dirty_test (UNIT *uptr, t_addr addr, t_addr lnt)
+{
+uint32 pg, lpg;
+
+if ((sim_dirty_map == NULL) || (uptr != sim_dirty_unit))
+    return TRUE;
+if (lnt == 0)
+    return FALSE;
+pg = (uint32) (addr >> sim_dirty_shift);
+lpg = (uint32) ((addr + lnt - 1) >> sim_dirty_shift);
+if (lpg >= sim_dirty_npg)                               /* beyond map? */
+    return TRUE;
+for ( ; pg <= lpg; pg++) {
+    if (sim_dirty_map[pg >> 5] & (1u << (pg & 0x1F)))
+        return TRUE;
+    }
+return FALSE;
+}
+
+/* Start a new interval */
+
+void sim_dirty_clear (void)
+{
+if (sim_dirty_map != NULL)
+    memset (sim_dirty_map, 0, DIRTY_NW (sim_dirty_npg) * sizeof (uint32));
+return;
+}
+
+/* Set/show dirty page tracking */
+
+t_stat sim_set_dirty (int32 flag, char *cptr)
+{
+if ((cptr != NULL) && (*cptr != 0))
+    return SCPE_2MARG;
+if (flag && (sim_dirty_unit == NULL))                   /* not supported? */
+    return SCPE_NOFNC;
+sim_dirty_enb = (flag != 0);
+return sim_dirty_alloc ();
+}
+
+t_stat sim_show_dirty (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr)
+{
+uint32 pg, ndirty;
+
+if (cptr && (*cptr != 0))
+    return SCPE_2MARG;
+if (sim_dirty_unit == NULL)
+    fprintf (st, "Dirty page tracking not available\n");
+else if (sim_dirty_map == NULL)
+    fprintf (st, "Dirty page tracking disabled\n");
+else {
+    for (pg = ndirty = 0; pg < sim_dirty_npg; pg++) {
+        if (sim_dirty_map[pg >> 5] & (1u << (pg & 0x1F)))
+            ndirty = ndirty + 1;
+        }
+    fprintf (st, "Dirty page tracking enabled, %u of %u pages dirty\n",
+        ndirty, sim_dirty_npg);
+    }
+return SCPE_OK;
+}
+
+/* Snapshot block tracking
+
+   For each memory-like unit, SCP keeps a hash of every block as it was
+   last saved or restored, together with the name of that file.  SAVE -I
+   writes a block that still has the same hash as an SR_SAME record, and
+   RESTORE of such a file first restores the file it was based on.
+
+   Every save file carries an identifier, new for each SAVE, and an
+   incremental file also records the identifier of its base.  RESTORE
+   checks that the base it reads has that identifier, so that a base that
+   has since been overwritten by another SAVE is rejected rather than
+   silently combined with the increment.
+*/
+
+static t_uint64 sim_snap_hash (const uint8 *p, size_t n)
+{
+t_uint64 h = 0x9E3779B97F4A7C15, w;
+size_t i;
+
+for (i = 0; (i + sizeof (w)) <= n; i = i + sizeof (w)) {
+    memcpy (&w, p + i, sizeof (w));
+    h = (h ^ w) * 0xFF51AFD7ED558CCD;
+    h = h ^ (h >> 32);
+    }
+for ( ; i < n; i++)
+    h = (h ^ p[i]) * 0x100000001B3;
+return h ^ n;
+}
+
+static SNAPTAB *sim_snap_find (UNIT *uptr, t_addr high, uint32 npg)
+{
+SNAPTAB *sp;
+int32 i;
+
+for (i = 0, sp = NULL; i < sim_snap_cnt; i++) {         /* find unit */
+    if (sim_snap_tab[i].uptr == uptr) {
+        sp = &sim_snap_tab[i];
+        break;
+        }
+    }
+if (sp == NULL) {                                       /* new entry? */
+    sp = (SNAPTAB *) realloc (sim_snap_tab, (sim_snap_cnt + 1) * sizeof (SNAPTAB));
+    if (sp == NULL)
+        return NULL;
+    sim_snap_tab = sp;
+    sp = &sim_snap_tab[sim_snap_cnt++];
+    sp->uptr = uptr;
+    sp->high = 0;
+    sp->npg = 0;
+    sp->valid = FALSE;
+    sp->hash = NULL;
+    }
+if ((sp->high != high) || (sp->npg != npg)) {           /* size changed? */
+    free (sp->hash);
+    sp->hash = (t_uint64 *) calloc (npg, sizeof (t_uint64));
+    sp->high = (sp->hash != NULL)? high: 0;
+    sp->npg = (sp->hash != NULL)? npg: 0;
+    sp->valid = FALSE;
+    if (sp->hash == NULL)
+        return NULL;
+    }
+return sp;
+}
+
+static void sim_snap_inval (UNIT *uptr)
+{
+int32 i;
+
+for (i = 0; i < sim_snap_cnt; i++) {
+    if (sim_snap_tab[i].uptr == uptr)
+        sim_snap_tab[i].valid = FALSE;
+    }
+return;
+}
+
+void sim_snap_setbase (char *fname)
+{
+int32 i;
+
+if (fname == NULL) {                                    /* failed? */
+    sim_snap_base[0] = 0;                               /* no base */
+    sim_snap_baseid[0] = 0;
+    for (i = 0; i < sim_snap_cnt; i++)
+        sim_snap_tab[i].valid = FALSE;
+    }
+else {
+    sim_snap_fullpath (fname, sim_snap_base);
+    strcpy (sim_snap_baseid, sim_snap_lastid);
+    sim_dirty_clear ();                                 /* new reference */
+    }
+return;
+}
+
+/* Make a new save file identifier */
+
+static void sim_snap_newid (char *id)
+{
+static uint32 seq = 0;
+uint32 v[4];
+t_uint64 h;
+
+v[0] = (uint32) time (NULL);
+v[1] = sim_os_msec ();
+v[2] = (uint32) sim_time;
+v[3] = ++seq;
+h = sim_snap_hash ((const uint8 *) v, sizeof (v));
+sprintf (id, "%08X%08X", (uint32) (h >> 32), (uint32) h);
+return;
+}
+
+/* Get the absolute path of an existing save file, so that an incremental
+   save names its base correctly wherever it is later restored from; if the
+   host can't supply one, the name is used as typed */
+
+static void sim_snap_fullpath (const char *fname, char *path)
+{
+#if defined (_WIN32)
+if (_fullpath (path, fname, CBUFSIZE) != NULL)
+    return;
+#elif !defined (VMS)
+char *p;
+
+if ((p = realpath (fname, NULL)) != NULL) {
+    if (strlen (p) < CBUFSIZE) {
+        strcpy (path, p);
+        free (p);
+        return;
+        }
+    free (p);
+    }
+#endif
+strncpy (path, fname, CBUFSIZE - 1);
+path[CBUFSIZE - 1] = 0;
+return;
+}
+
+/* Save memory-like unit [V3.6]
+
+   Memory is written in blocks of SRBSIZ items.  Each block is a type and
+   an item count, followed by the data for literal (SR_LIT) blocks, or a
+   length and the data for compressed (SR_ZLIB) blocks.  Items are always
+   little endian in the file.
+
+   If the unit's filebuf is set, it is the memory array, in the same form
+   as a buffered unit (items of SZ_D bytes, one per aincr addresses), and
+   blocks are copied directly from it; otherwise they are read through the
+   device's examine routine.  For an incremental save, blocks that dirty
+   page tracking shows have not been written are not read at all.
+*/
+
+static t_stat sim_save_mem (FILE *sfile, DEVICE *dptr, UNIT *uptr, t_addr high,
+    t_bool incr)
+{
+size_t sz = SZ_D (dptr);
+uint32 nel = (uint32) ((high + dptr->aincr - 1) / dptr->aincr);
+uint32 npg = (nel + SRBSIZ - 1) / SRBSIZ;
+uint32 pg, i;
+int32 l, typ, clen = 0;
+t_addr k;
+t_value val;
+t_uint64 h;
+t_bool zero;
+uint8 *mbuf, *data, *zbuf = NULL;
+SNAPTAB *sp;
+t_stat r = SCPE_OK;
+#if defined (HAVE_ZLIB)
+uLongf zlnt;
+uint8 *sbuf = NULL;
+#endif
+
+#define WRITE_I(xx) sim_fwrite (&(xx), sizeof (xx), 1, sfile)
+
+sp = sim_snap_find (uptr, high, npg);                   /* get block hashes */
+if ((mbuf = (uint8 *) calloc (SRBSIZ, sz)) == NULL)
+    return SCPE_MEM;
+#if defined (HAVE_ZLIB)
+zbuf = (uint8 *) malloc (compressBound (SRBSIZ * sz));
+if (!sim_end && (sz > 1))                               /* swap buffer */
+    sbuf = (uint8 *) malloc (SRBSIZ * sz);
+#endif
+for (pg = 0; pg < npg; pg++) {                          /* loop thru blocks */
+    l = ((nel - pg * SRBSIZ) < SRBSIZ)? (int32) (nel - pg * SRBSIZ): SRBSIZ;
+    k = (t_addr) pg * SRBSIZ * dptr->aincr;             /* block address */
+    if (incr && (sp != NULL) && sp->valid &&            /* not written? */
+        !sim_dirty_test (uptr, k, (t_addr) l * dptr->aincr)) {
+        typ = SR_SAME;
+        WRITE_I (typ);
+        WRITE_I (l);
+        continue;
+        }
+    if (uptr->filebuf != NULL)                          /* memory array? */
+        data = ((uint8 *) uptr->filebuf) + ((size_t) pg * SRBSIZ * sz);
+    else {
+        for (i = 0; i < (uint32) l; i++, k = k + dptr->aincr) {
+            r = dptr->examine (&val, k, uptr, SIM_SW_REST);
+            if (r != SCPE_OK)
+                break;
+            SZ_STORE (sz, val, mbuf, i);
+            }
+        if (r != SCPE_OK)
+            break;
+        data = mbuf;
+        }
+    for (i = 0, zero = TRUE; zero && (i < (l * sz)); i++) /* all zero? */
+        zero = (data[i] == 0);
+    h = sim_snap_hash (data, l * sz);
+    if (incr && (sp != NULL) && sp->valid && (sp->hash[pg] == h))
+        typ = SR_SAME;                                  /* unchanged */
+    else typ = zero? SR_ZERO: SR_LIT;
+    if (sp != NULL)
+        sp->hash[pg] = h;
+#if defined (HAVE_ZLIB)
+    if ((typ == SR_LIT) && (zbuf != NULL) &&
+        ((sbuf != NULL) || sim_end || (sz == 1))) {     /* try compressing */
+        if (sbuf != NULL)                               /* big endian? */
+            sim_buf_copy_swapped (sbuf, data, sz, l);
+        zlnt = (uLongf) compressBound (SRBSIZ * sz);
+        if ((compress2 (zbuf, &zlnt, (sbuf != NULL)? sbuf: data,
+                (uLong) (l * sz), Z_BEST_SPEED) == Z_OK) &&
+            (zlnt < (uLongf) (l * sz))) {               /* smaller? */
+            typ = SR_ZLIB;
+            clen = (int32) zlnt;
+            }
+        }
+#endif
+    WRITE_I (typ);                                      /* block type */
+    WRITE_I (l);                                        /* item count */
+    if (typ == SR_LIT)
+        sim_fwrite (data, sz, l, sfile);
+    else if (typ == SR_ZLIB) {
+        WRITE_I (clen);
+        fwrite (zbuf, 1, clen, sfile);
+        }
+    }                                                   /* end for pg */
+if (sp != NULL)
+    sp->valid = (r == SCPE_OK);
+free (mbuf);
+free (zbuf);
+#if defined (HAVE_ZLIB)
+free (sbuf);
+#endif
+return r;
+}
+
+/* Restore memory-like unit [V3.6] */
+
+static t_stat sim_rest_mem (FILE *rfile, DEVICE *dptr, UNIT *uptr, t_addr high)
+{
+size_t sz = SZ_D (dptr);
+uint32 nel = (uint32) ((high + dptr->aincr - 1) / dptr->aincr);
+uint32 npg = (nel + SRBSIZ - 1) / SRBSIZ;
+uint32 pg;
+int32 j, l, typ, clen;
+t_addr k;
+t_value val;
+uint8 *mbuf, *zbuf = NULL;
+SNAPTAB *sp;
+t_stat r = SCPE_OK;
+#if defined (HAVE_ZLIB)
+uLongf zlnt;
+#endif
+
+#define READ_IM(xx) if (sim_fread (&xx, sizeof (xx), 1, rfile) == 0) { \
+    r = SCPE_IOERR; \
+    break; \
+    }
+
+sp = sim_snap_find (uptr, high, npg);                   /* get block hashes */
+if ((mbuf = (uint8 *) calloc (SRBSIZ, sz)) == NULL)
+    return SCPE_MEM;
+for (pg = 0, k = 0; pg < npg; pg++, k = k + (SRBSIZ * dptr->aincr)) {
+    READ_IM (typ);                                      /* block type */
+    READ_IM (l);                                        /* item count */
+    if ((l <= 0) || (l > SRBSIZ)) {                     /* invalid? */
+        r = SCPE_IOERR;
+        break;
+        }
+    if (typ == SR_SAME) {                               /* from base? */
+        if ((sp == NULL) || !sp->valid) {               /* must have it */
+            r = SCPE_INCOMP;
+            break;
+            }
+        continue;
+        }
+    if (typ == SR_ZERO)                                 /* all zero? */
+        memset (mbuf, 0, l * sz);
+    else if (typ == SR_LIT) {                           /* literal? */
+        if (sim_fread (mbuf, sz, l, rfile) != (size_t) l) {
+            r = SCPE_IOERR;
+            break;
+            }
+        }
+    else if (typ == SR_ZLIB) {                          /* compressed? */
+        READ_IM (clen);
+#if defined (HAVE_ZLIB)
+        if ((zbuf == NULL) &&
+            ((zbuf = (uint8 *) malloc (compressBound (SRBSIZ * sz))) == NULL)) {
+            r = SCPE_MEM;
+            break;
+            }
+        zlnt = (uLongf) (l * sz);
+        if ((clen <= 0) || (((uLong) clen) > compressBound (SRBSIZ * sz)) ||
+            (fread (zbuf, 1, clen, rfile) != (size_t) clen) ||
+            (uncompress (mbuf, &zlnt, zbuf, (uLong) clen) != Z_OK) ||
+            (zlnt != (uLongf) (l * sz))) {
+            r = SCPE_IOERR;
+            break;
+            }
+        if (!sim_end && (sz > 1))                       /* big endian? */
+            sim_buf_swap_data (mbuf, sz, l);
+#else
+        sim_printf ("Compressed save file, not supported in this build\n");
+        r = SCPE_INCOMP;
+        break;
+#endif
+        }
+    else {                                              /* unknown */
+        r = SCPE_IOERR;
+        break;
+        }
+    if (sp != NULL)
+        sp->hash[pg] = sim_snap_hash (mbuf, l * sz);
+    if (uptr->filebuf != NULL)                          /* memory array? */
+        memcpy (((uint8 *) uptr->filebuf) + ((size_t) pg * SRBSIZ * sz), mbuf, l * sz);
+    else {
+        for (j = 0; j < l; j++) {
+            SZ_LOAD (sz, val, mbuf, j);
+            r = dptr->deposit (val, k + (j * dptr->aincr), uptr, SIM_SW_REST);
+            if (r != SCPE_OK)
+                break;
+            }
+        if (r != SCPE_OK)
+            break;
+        }
+    }
+if (sp != NULL)
+    sp->valid = (r == SCPE_OK);
+free (mbuf);
+free (zbuf);
 return r;
 }
 
 t_stat sim_save (FILE *sfile)
 {
-void *mbuf;
-int32 l, t;
+int32 t;
 uint32 i, j;
-t_addr k, high;
+t_addr high;
 t_value val;
 t_stat r;
-t_bool zeroflg;
-size_t sz;
+t_bool incr = ((sim_switches & SWMASK ('I')) != 0);
 DEVICE *dptr;
 UNIT *uptr;
 REG *rptr;
 
-#define WRITE_I(xx) sim_fwrite (&(xx), sizeof (xx), 1, sfile)
-
-fprintf (sfile, "%s\n%s\n%s\n%s\n%s\n%.0f\n",
+sim_snap_newid (sim_snap_lastid);                       /* identify file */
+fprintf (sfile, "%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s\n%.0f\n",
     save_vercur,                                        /* [V2.5] save format */
     sim_name,                                           /* sim name */
     sim_si64, sim_sa64, eth_capabilities (),            /* [V3.5] options */
+    (incr? sim_snap_base: ""),                          /* [V3.6] base file */
+    (incr? sim_snap_baseid: ""),                        /* [V3.6] base file id */
+    sim_snap_lastid,                                    /* [V3.6] file id */
     sim_time);                                          /* [V3.2] sim time */
 WRITE_I (sim_rtime);                                    /* [V2.6] sim rel time */
 
@@ -2527,31 +3214,9 @@ for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {     /* loop thru devices */
              (dptr->examine != NULL) &&
              ((high = uptr->capac) != 0)) {             /* memory-like unit? */
             WRITE_I (high);                             /* [V2.5] write size */
-            sz = SZ_D (dptr);
-            if ((mbuf = calloc (SRBSIZ, sz)) == NULL) {
-                fclose (sfile);
-                return SCPE_MEM;
-                }
-            for (k = 0; k < high; ) {                   /* loop thru mem */
-                zeroflg = TRUE;
-                for (l = 0; (l < SRBSIZ) && (k < high); l++,
-                     k = k + (dptr->aincr)) {           /* check for 0 block */
-                    r = dptr->examine (&val, k, uptr, SIM_SW_REST);
-                    if (r != SCPE_OK)
-                        return r;
-                    if (val) zeroflg = FALSE;
-                    SZ_STORE (sz, val, mbuf, l);
-                    }                                   /* end for l */
-                if (zeroflg) {                          /* all zero's? */
-                    l = -l;                             /* invert block count */
-                    WRITE_I (l);                        /* write only count */
-                    }
-                else {
-                    WRITE_I (l);                        /* block count */
-                    sim_fwrite (mbuf, sz, l, sfile);
-                    }
-                }                                       /* end for k */
-            free (mbuf);                                /* dealloc buffer */
+            r = sim_save_mem (sfile, dptr, uptr, high, incr);
+            if (r != SCPE_OK)
+                return r;
             }                                           /* end if mem */
         else {                                          /* no memory */
             high = 0;                                   /* write 0 */
@@ -2592,14 +3257,16 @@ if (*cptr == 0)                                         /* must be more */
 sim_trim_endspc (cptr);
 if ((rfile = sim_fopen (cptr, "rb")) == NULL)
     return SCPE_OPENERR;
+sim_dirty_all ();                                       /* memory changes */
 r = sim_rest (rfile);
 fclose (rfile);
+sim_snap_setbase ((r == SCPE_OK)? cptr: NULL);         /* new base */
 return r;
 }
 
 t_stat sim_rest (FILE *rfile)
 {
-char buf[CBUFSIZE];
+char buf[CBUFSIZE], bid[CBUFSIZE], fid[CBUFSIZE];
 void *mbuf;
 int32 j, blkcnt, limit, unitno, time, flg;
 uint32 us, depth;
@@ -2607,7 +3274,8 @@ t_addr k, high, old_capac;
 t_value val, max;
 t_stat r;
 size_t sz;
-t_bool v35, v32;
+t_bool v36, v35, v32;
+FILE *bfile;
 DEVICE *dptr;
 UNIT *uptr;
 REG *rptr;
@@ -2619,8 +3287,10 @@ REG *rptr;
 
 sim_ref_type = REF_NONE;                                /* use no references */
 READ_S (buf);                                           /* [V2.5+] read version */
-v35 = v32 = FALSE;
-if (strcmp (buf, save_vercur) == 0)                     /* version 3.5? */
+v36 = v35 = v32 = FALSE;
+if (strcmp (buf, save_vercur) == 0)                     /* version 3.6? */
+    v36 = v35 = v32 = TRUE;
+else if (strcmp (buf, save_ver35) == 0)                 /* version 3.5? */
     v35 = v32 = TRUE;
 else if (strcmp (buf, save_ver32) == 0)                 /* version 3.2? */
     v32 = TRUE;
@@ -2646,6 +3316,33 @@ if (v35) {                                              /* [V3.5+] options */
         }
     READ_S (buf);                                       /* Ethernet */
     }
+fid[0] = 0;                                             /* no file id */
+if (v36) {                                              /* [V3.6+] base file */
+    READ_S (buf);
+    READ_S (bid);                                       /* base file id */
+    READ_S (fid);                                       /* file id */
+    if (buf[0] != 0) {                                  /* incremental? */
+        if (sim_rest_nest >= SR_MAXNEST) {              /* loop? */
+            sim_printf ("Too many nested base save files: %s\n", buf);
+            return SCPE_INCOMP;
+            }
+        if ((bfile = sim_fopen (buf, "rb")) == NULL) {
+            sim_printf ("Can't open base save file: %s\n", buf);
+            return SCPE_OPENERR;
+            }
+        sim_rest_nest = sim_rest_nest + 1;
+        r = sim_rest (bfile);                           /* restore base first */
+        sim_rest_nest = sim_rest_nest - 1;
+        fclose (bfile);
+        if (r != SCPE_OK)
+            return r;
+        if (strcmp (bid, sim_snap_lastid) != 0) {       /* not the same base? */
+            sim_printf ("Base save file has changed since this save: %s\n", buf);
+            return SCPE_INCOMP;
+            }
+        }
+    }
+strcpy (sim_snap_lastid, fid);                          /* this file's id */
 if (v32) {                                              /* [V3.2+] time as string */
     READ_S (buf);
     sscanf (buf, "%lf", &sim_time);
@@ -2739,6 +3436,13 @@ for ( ;; ) {                                            /* device loop */
                 fprint_capac (stdout, dptr, uptr);
                 sim_printf ("\n");
                 }
+            if (v36) {                                  /* [V3.6+] blocks? */
+                r = sim_rest_mem (rfile, dptr, uptr, high);
+                if (r != SCPE_OK)
+                    return r;
+                continue;
+                }
+            sim_snap_inval (uptr);                      /* no block hashes */
             sz = SZ_D (dptr);                           /* allocate buffer */
             if ((mbuf = calloc (SRBSIZ, sz)) == NULL)
                 return SCPE_MEM;
@@ -2799,12 +3503,15 @@ return SCPE_OK;
    co[nt]               start simulation
    s[tep] [step limit]  start simulation for 'limit' instructions
    b[oot] device        bootstrap from device and start simulation
+   be[nchmark] [limit]  continue simulation for 'limit' instructions (or
+                        seconds, with -t), with idling and throttling off,
+                        and report the execution rate
 */
 
 t_stat run_cmd (int32 flag, char *cptr)
 {
 char *tptr, gbuf[CBUFSIZE];
-uint32 i, j;
+uint32 i, j, blim = 0;
 int32 unitno;
 t_value pcv;
 t_stat r;
@@ -2849,6 +3556,18 @@ else if (flag == RU_STEP) {                             /* step */
     else sim_step = 1;
     }
 
+else if (flag == RU_BENCH) {                            /* benchmark */
+    if (*cptr != 0) {                                   /* argument? */
+        cptr = get_glyph (cptr, gbuf, 0);               /* get next glyph */
+        if (*cptr != 0)                                 /* should be end */
+            return SCPE_2MARG;
+        blim = (uint32) get_uint (gbuf, 10, INT_MAX, &r);
+        if ((r != SCPE_OK) || (blim == 0))              /* error? */
+            return SCPE_ARG;
+        }
+    else blim = (sim_switches & SWMASK ('T'))? BENCH_DSEC: BENCH_DINST;
+    }
+
 else if (flag == RU_BOOT) {                             /* boot */
     if (*cptr == 0)                                     /* must be more */
         return SCPE_2FARG;
@@ -2870,6 +3589,7 @@ else if (flag == RU_BOOT) {                             /* boot */
     unitno = (int32) (uptr - dptr->units);              /* recover unit# */
     if ((r = run_boot_prep ()) != SCPE_OK)              /* reset sim */
         return r;
+    sim_dirty_all ();                                   /* boot writes memory */
     if ((r = dptr->boot (unitno, dptr)) != SCPE_OK)     /* boot device */
         return r;
     }
@@ -2877,6 +3597,10 @@ else if (flag == RU_BOOT) {                             /* boot */
 else if (flag != RU_CONT)                               /* must be cont */
     return SCPE_IERR;
 
+for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {     /* link units to devices */
+    for (j = 0; j < dptr->numunits; j++)
+        dptr->units[j].dptr = dptr;
+    }
 for (i = 1; (dptr = sim_devices[i]) != NULL; i++) {     /* reposition all */
     for (j = 0; j < dptr->numunits; j++) {              /* seq devices */
         uptr = dptr->units + j;
@@ -2899,23 +3623,31 @@ if ((r = sim_check_console (30)) != SCPE_OK) {          /* check console, error?
     }
 if (sim_step)                                           /* set step timer */
     sim_activate (&sim_step_unit, sim_step);
-sim_throt_sched ();                                     /* set throttle */
+if (sim_samp_on)                                        /* PC sampling? */
+    sim_activate (&sim_samp_unit, samp_next ());
+if (flag == RU_BENCH)                                   /* benchmark? */
+    bench_start (blim);                                 /* no throttle */
+else sim_throt_sched ();                                /* set throttle */
 sim_is_running = 1;                                     /* flag running */
 sim_brk_clract ();                                      /* defang actions */
 sim_rtcn_init_all ();                                   /* re-init clocks */
+if (sim_prof_on)                                        /* profiling? */
+    prof_start ();
 r = sim_instr();
+if (sim_prof_on)
+    prof_stop ();
+if (flag == RU_BENCH)                                   /* benchmark? */
+    bench_stop ();
 
 sim_is_running = 0;                                     /* flag idle */
 sim_ttcmd ();                                           /* restore console */
 signal (SIGINT, SIG_DFL);                               /* cancel WRU */
 sim_cancel (&sim_step_unit);                            /* cancel step timer */
+sim_cancel (&sim_samp_unit);                            /* cancel PC sampling */
 sim_throt_cancel ();                                    /* cancel throttle */
-if (sim_clock_queue != NULL) {                          /* update sim time */
-    UPDATE_SIM_TIME (sim_clock_queue->time);
-    }
-else {
-    UPDATE_SIM_TIME (noqueue_time);
-    }
+sim_aio_flush ();                                       /* finish async I/O */
+sim_hs_flush ();                                        /* drain history */
+UPDATE_SIM_TIME (sim_qintv);                            /* update sim time */
 if (sim_log)                                            /* flush console log */
     fflush (sim_log);
 if (sim_deb)                                            /* flush debug log */
@@ -2934,6 +3666,13 @@ tmxr_post_logs (FALSE);                                 /* flush all mux log fil
 #if defined (VMS)
 sim_printf ("\n");
 #endif
+if (flag == RU_BENCH) {                                 /* benchmark? */
+    bench_report (stdout);                              /* print results */
+    if (sim_log)                                        /* log if enabled */
+        bench_report (sim_log);
+    if (r == SCPE_STEP)                                 /* ran to limit? */
+        return SCPE_OK;
+    }
 if (r == SCPE_OK)                                       /* if no stop reason is given */
     return SCPE_OK;                                     /*   then return quietly */
 fprint_stopped (stdout, r);                             /* print msg */
@@ -2948,8 +3687,7 @@ t_stat run_boot_prep (void)
 {
 sim_interval = 0;                                       /* reset queue */
 sim_time = sim_rtime = 0;
-noqueue_time = 0;
-sim_clock_queue = NULL;
+sim_qflush ();
 return reset_all (0);
 }
 
@@ -3020,26 +3758,633 @@ t_stat step_svc (UNIT *uptr)
 return SCPE_STEP;
 }
 
-/* Cancel scheduled step service */
+/* Benchmark support
 
-t_stat sim_cancel_step (void)
-{
-return sim_cancel (&sim_step_unit);
-}
+   bench_start disables idling, takes a snapshot of the time and event
+   counters, and schedules the end of the run: the step timer for an
+   instruction limit, or a deadline poll for a time limit.  While a
+   benchmark is running, sim_process_event accumulates the queue depth
+   and the host time spent in event service.
+*/
 
-/* Signal handler for ^C signal - set stop simulation flag */
+void bench_start (uint32 lim)
+{
+sim_bench_idle = sim_idle_enab;                         /* no idling */
+sim_idle_enab = FALSE;
+sim_bench_inst = sim_gtime ();
+sim_bench_nevt = sim_qndisp;
+sim_bench_ncall = sim_bench_qsum = sim_bench_evns = 0;
+sim_bench_qmax = 0;
+sim_bench_wall = sim_os_nsec ();
+if (sim_switches & SWMASK ('T')) {                      /* time limit? */
+    sim_bench_end = sim_bench_wall + (((t_uint64) lim) * BENCH_NSPS);
+    sim_activate (&sim_bench_unit, BENCH_POLL);
+    }
+else sim_activate (&sim_step_unit, (int32) lim);        /* instruction limit */
+sim_bench_on = TRUE;
+return;
+}
 
-void int_handler (int sig)
+void bench_stop (void)
 {
-stop_cpu = 1;
+sim_bench_on = FALSE;
+sim_bench_wall = sim_os_nsec () - sim_bench_wall;
+sim_bench_inst = sim_gtime () - sim_bench_inst;
+sim_bench_nevt = sim_qndisp - sim_bench_nevt;
+sim_cancel (&sim_bench_unit);
+sim_idle_enab = sim_bench_idle;                         /* restore idling */
 return;
 }
 
-/* Get radix from switches or keyword */
+void bench_report (FILE *st)
+{
+double wall = ((double) sim_bench_wall) / BENCH_NSPS;
+double evs = ((double) sim_bench_evns) / BENCH_NSPS;
+
+if (wall <= 0.0)                                        /* clock too coarse? */
+    wall = 1.0 / BENCH_NSPS;
+if (evs > wall)
+    evs = wall;
+fprintf (st, "\nBenchmark: %.0f instructions in %.3f seconds\n",
+    sim_bench_inst, wall);
+fprintf (st, "  Instructions/second:  %.0f\n", sim_bench_inst / wall);
+fprintf (st, "  Events dispatched:    %.0f (%.0f/second)\n",
+    (double) sim_bench_nevt, ((double) sim_bench_nevt) / wall);
+fprintf (st, "  Event queue depth:    average %.1f, maximum %d\n",
+    (sim_bench_ncall? ((double) sim_bench_qsum) / sim_bench_ncall: 0.0),
+    sim_bench_qmax);
+fprintf (st, "  Time in sim_instr:    %.3f seconds (%.1f%%)\n",
+    wall - evs, ((wall - evs) * 100.0) / wall);
+fprintf (st, "  Time in events:       %.3f seconds (%.1f%%)\n",
+    evs, (evs * 100.0) / wall);
+return;
+}
 
-int32 get_radix_local (const char *cptr, int32 switches, int32 default_radix)
+/* Benchmark deadline poll */
+
+t_stat bench_svc (UNIT *uptr)
 {
-if (cptr != NULL)                                       /* if this is a SET radix keyword request */
+if (sim_os_nsec () >= sim_bench_end)                    /* time up? */
+    return SCPE_STEP;
+sim_activate (uptr, BENCH_POLL);
+return SCPE_OK;
+}
+
+/* Event service profile
+
+   While profiling is enabled (SET PROFILE), sim_process_event times every
+   service routine with the host clock and charges the time to the unit;
+   a device batch service routine's time is shared equally among the
+   units in the batch.  sim_activate records the interval each unit is
+   scheduled for, and each call to sim_process_event counts the queue
+   depth in a log2 histogram.  Records are created as units are first
+   seen, including SCP's own units, which are shown as "(internal)".
+   Only time spent in RUN, GO, etc. counts toward the profile.
+*/
+
+static struct sim_prof *prof_get (UNIT *uptr)
+{
+struct sim_prof *pp;
+UNIT **nlist;
+
+if (uptr->prof != NULL)
+    return uptr->prof;
+if (sim_prof_ucnt >= sim_prof_ulnt) {                   /* list full? */
+    nlist = (UNIT **) realloc (sim_prof_ulist,
+        (sim_prof_ulnt + SIM_QINILNT) * sizeof (UNIT *));
+    if (nlist == NULL)
+        return NULL;
+    sim_prof_ulist = nlist;
+    sim_prof_ulnt = sim_prof_ulnt + SIM_QINILNT;
+    }
+pp = (struct sim_prof *) calloc (1, sizeof (struct sim_prof));
+if (pp == NULL)
+    return NULL;
+pp->ivmin = -1;                                         /* no interval yet */
+uptr->prof = pp;
+sim_prof_ulist[sim_prof_ucnt++] = uptr;
+return pp;
+}
+
+static void prof_clear (void)
+{
+int32 i;
+
+for (i = 0; i < sim_prof_ucnt; i++) {
+    free (sim_prof_ulist[i]->prof);
+    sim_prof_ulist[i]->prof = NULL;
+    }
+sim_prof_ucnt = 0;
+memset (sim_prof_qhist, 0, sizeof (sim_prof_qhist));
+sim_prof_wall = 0;
+sim_prof_inst = 0.0;
+return;
+}
+
+void prof_start (void)
+{
+sim_prof_start = sim_os_nsec ();
+sim_prof_istart = sim_gtime ();
+return;
+}
+
+void prof_stop (void)
+{
+sim_prof_wall = sim_prof_wall + (sim_os_nsec () - sim_prof_start);
+sim_prof_inst = sim_prof_inst + (sim_gtime () - sim_prof_istart);
+return;
+}
+
+void prof_svc (UNIT *uptr, t_uint64 ns)
+{
+struct sim_prof *pp = prof_get (uptr);
+
+if (pp == NULL)
+    return;
+pp->ndisp = pp->ndisp + 1;
+pp->nsec = pp->nsec + ns;
+if (ns > pp->nsmax)
+    pp->nsmax = ns;
+return;
+}
+
+void prof_act (UNIT *uptr, int32 event_time)
+{
+struct sim_prof *pp = prof_get (uptr);
+
+if (pp == NULL)
+    return;
+pp->nact = pp->nact + 1;
+pp->ivsum = pp->ivsum + (double) event_time;
+if ((pp->ivmin < 0) || (event_time < pp->ivmin))
+    pp->ivmin = event_time;
+if (event_time > pp->ivmax)
+    pp->ivmax = event_time;
+return;
+}
+
+/* Unit name for the profile, "(internal)" if not in a device */
+
+static char *prof_uname (UNIT *uptr, char *buf)
+{
+DEVICE *dptr = uptr->dptr;
+
+if (dptr == NULL)
+    strcpy (buf, "(internal)");
+else if (dptr->numunits > 1)
+    sprintf (buf, "%.16s%d", sim_dname (dptr), (int) (uptr - dptr->units));
+else sprintf (buf, "%.16s", sim_dname (dptr));
+return buf;
+}
+
+/* Sort units by time in service, longest first */
+
+static int prof_comp (const void *e1, const void *e2)
+{
+const struct sim_prof *p1 = (*((UNIT * const *) e1))->prof;
+const struct sim_prof *p2 = (*((UNIT * const *) e2))->prof;
+
+if (p1->nsec != p2->nsec)
+    return (p1->nsec > p2->nsec)? -1: 1;
+if (p1->ndisp != p2->ndisp)
+    return (p1->ndisp > p2->ndisp)? -1: 1;
+return 0;
+}
+
+/* Set/show event service profile */
+
+t_stat sim_set_profile (int32 flag, char *cptr)
+{
+if ((cptr != NULL) && (*cptr != 0))
+    return SCPE_2MARG;
+if (flag)                                               /* SET PROFILE? */
+    prof_clear ();                                      /* start over */
+sim_prof_on = (flag != 0);
+return SCPE_OK;
+}
+
+t_stat sim_show_profile (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr)
+{
+int32 i, j;
+UNIT *uptr;
+DEVICE *dptr;
+struct sim_prof *pp;
+t_uint64 tdisp, tnsec, dnsec, ddisp;
+double wall, pct;
+char nbuf[32];
+
+if (cptr && (*cptr != 0))
+    return SCPE_2MARG;
+qsort (sim_prof_ulist, sim_prof_ucnt, sizeof (UNIT *), prof_comp);
+for (i = 0, tdisp = tnsec = 0; i < sim_prof_ucnt; i++) {
+    tdisp = tdisp + sim_prof_ulist[i]->prof->ndisp;
+    tnsec = tnsec + sim_prof_ulist[i]->prof->nsec;
+    }
+if (sim_switches & SWMASK ('C')) {                      /* CSV? */
+    fprintf (st, "record,name,count,svc_ns,max_ns,activations,"
+        "ivl_avg,ivl_min,ivl_max\n");
+    for (i = 0; i < sim_prof_ucnt; i++) {
+        uptr = sim_prof_ulist[i];
+        pp = uptr->prof;
+        fprintf (st, "unit,%s,%.0f,%.0f,%.0f,%.0f,%.1f,%d,%d\n",
+            prof_uname (uptr, nbuf), (double) pp->ndisp, (double) pp->nsec,
+            (double) pp->nsmax, (double) pp->nact,
+            (pp->nact? pp->ivsum / pp->nact: 0.0),
+            (pp->ivmin < 0)? 0: pp->ivmin, pp->ivmax);
+        }
+    for (i = 0; i < PROF_NQH; i++) {
+        if (sim_prof_qhist[i] != 0)
+            fprintf (st, "queue,%d,%.0f,,,,,,\n",
+                (i == 0)? 0: (1 << (i - 1)), (double) sim_prof_qhist[i]);
+        }
+    return SCPE_OK;
+    }
+wall = ((double) sim_prof_wall) / BENCH_NSPS;
+fprintf (st, "Event service profile %s\n", sim_prof_on? "enabled": "disabled");
+if (sim_prof_ucnt == 0)
+    return SCPE_OK;
+fprintf (st, "  %.0f instructions, %.0f events in %.3f seconds of run time\n",
+    sim_prof_inst, (double) tdisp, wall);
+fprintf (st, "  %.3f seconds in event service (%.1f%%)\n",
+    ((double) tnsec) / BENCH_NSPS,
+    (wall > 0.0)? (((double) tnsec) * 100.0) / sim_prof_wall: 0.0);
+fprintf (st, "\nDevice          Events      Svc ms   %%Svc\n");
+for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    for (j = 0, ddisp = dnsec = 0; j < (int32) dptr->numunits; j++) {
+        if ((pp = dptr->units[j].prof) != NULL) {
+            ddisp = ddisp + pp->ndisp;
+            dnsec = dnsec + pp->nsec;
+            }
+        }
+    if (ddisp == 0)
+        continue;
+    pct = tnsec? (((double) dnsec) * 100.0) / tnsec: 0.0;
+    fprintf (st, "%-12.12s %9.0f %11.3f %6.1f\n", sim_dname (dptr),
+        (double) ddisp, ((double) dnsec) / 1000000.0, pct);
+    }
+fprintf (st, "\nUnit            Events    Avg us    Max us   %%Svc"
+    "     Acts   Avg ivl   Min ivl   Max ivl\n");
+for (i = 0; i < sim_prof_ucnt; i++) {
+    uptr = sim_prof_ulist[i];
+    pp = uptr->prof;
+    pct = tnsec? (((double) pp->nsec) * 100.0) / tnsec: 0.0;
+    fprintf (st, "%-12.12s %9.0f %9.2f %9.2f %6.1f %8.0f %9.0f %9d %9d\n",
+        prof_uname (uptr, nbuf), (double) pp->ndisp,
+        pp->ndisp? (((double) pp->nsec) / pp->ndisp) / 1000.0: 0.0,
+        ((double) pp->nsmax) / 1000.0, pct, (double) pp->nact,
+        (pp->nact? pp->ivsum / pp->nact: 0.0),
+        (pp->ivmin < 0)? 0: pp->ivmin, pp->ivmax);
+    }
+fprintf (st, "\nQueue depth     Calls\n");
+for (i = 0; i < PROF_NQH; i++) {
+    if (sim_prof_qhist[i] == 0)
+        continue;
+    if (i <= 1)
+        sprintf (nbuf, "%d", i);
+    else if (i == (PROF_NQH - 1))
+        sprintf (nbuf, "%d+", 1 << (i - 1));
+    else sprintf (nbuf, "%d-%d", 1 << (i - 1), (1 << i) - 1);
+    fprintf (st, "%-12s %9.0f\n", nbuf, (double) sim_prof_qhist[i]);
+    }
+return SCPE_OK;
+}
+
+/* PC sampling
+
+   While sampling is enabled (SET SAMPLE), an SCP unit runs every n
+   instructions, jittered by up to n/8 so that it does not lock step with
+   periodic device events, and counts the current PC and processor mode
+   in an open-addressed hash table.  Most CPUs keep the PC in a local
+   variable during sim_instr, so the PC register is not current; a CPU
+   that supports sampling supplies sim_vm_sample_pc, which returns the
+   live PC and stores the processor mode.
+
+   A symbol map file has one "address symbol" pair per line, with the
+   address in the CPU's address radix; blank lines and lines starting
+   with ';' or '#' are ignored.  Samples are shown as the nearest symbol
+   at or below the PC, plus an offset.
+*/
+
+int32 samp_next (void)
+{
+int32 j = sim_samp_intv >> 3;
+
+sim_samp_seed = (sim_samp_seed * 1103515245) + 12345;   /* LCG */
+if (j == 0)
+    return sim_samp_intv;
+return sim_samp_intv - (j >> 1) + (int32) ((sim_samp_seed >> 16) % ((uint32) j));
+}
+
+static uint32 samp_hash (t_addr pc, uint32 mode)
+{
+t_uint64 h = (((t_uint64) pc) << 3) ^ mode;
+
+h = h * 0x9E3779B97F4A7C15;
+return (uint32) (h >> 32);
+}
+
+static t_bool samp_grow (void)
+{
+SAMPENT *ntab, *oep;
+uint32 i, j, nlnt = sim_samp_lnt? sim_samp_lnt << 1: SAMP_INILNT;
+
+ntab = (SAMPENT *) calloc (nlnt, sizeof (SAMPENT));
+if (ntab == NULL)
+    return FALSE;
+for (i = 0; i < sim_samp_lnt; i++) {                    /* rehash old entries */
+    oep = &sim_samp_tab[i];
+    if (oep->count == 0)
+        continue;
+    for (j = samp_hash (oep->pc, oep->mode) & (nlnt - 1);
+        ntab[j].count != 0; j = (j + 1) & (nlnt - 1)) ;
+    ntab[j] = *oep;
+    }
+free (sim_samp_tab);
+sim_samp_tab = ntab;
+sim_samp_lnt = nlnt;
+return TRUE;
+}
+
+static void samp_record (t_addr pc, uint32 mode)
+{
+SAMPENT *ep;
+uint32 j;
+
+if ((sim_samp_cnt >= (sim_samp_lnt >> 1)) && !samp_grow ()) /* half full? */
+    return;
+for (j = samp_hash (pc, mode) & (sim_samp_lnt - 1); ; j = (j + 1) & (sim_samp_lnt - 1)) {
+    ep = &sim_samp_tab[j];
+    if (ep->count == 0) {                               /* new entry? */
+        ep->pc = pc;
+        ep->mode = mode;
+        sim_samp_cnt = sim_samp_cnt + 1;
+        break;
+        }
+    if ((ep->pc == pc) && (ep->mode == mode))
+        break;
+    }
+ep->count = ep->count + 1;
+sim_samp_total = sim_samp_total + 1;
+return;
+}
+
+t_stat samp_svc (UNIT *uptr)
+{
+uint32 mode = 0;
+t_addr pc;
+
+if (sim_vm_sample_pc == NULL)                           /* not supported? */
+    return SCPE_OK;
+pc = sim_vm_sample_pc (&mode);
+samp_record (pc, mode);
+sim_activate (uptr, samp_next ());
+return SCPE_OK;
+}
+
+static void samp_clear (void)
+{
+free (sim_samp_tab);
+sim_samp_tab = NULL;
+sim_samp_lnt = sim_samp_cnt = 0;
+sim_samp_total = 0;
+return;
+}
+
+/* Symbol map */
+
+static int samp_symcomp (const void *e1, const void *e2)
+{
+const SAMPSYM *s1 = (const SAMPSYM *) e1;
+const SAMPSYM *s2 = (const SAMPSYM *) e2;
+
+if (s1->addr != s2->addr)
+    return (s1->addr < s2->addr)? -1: 1;
+return 0;
+}
+
+static void samp_freesym (void)
+{
+int32 i;
+
+for (i = 0; i < sim_samp_nsym; i++)
+    free (sim_samp_sym[i].name);
+free (sim_samp_sym);
+sim_samp_sym = NULL;
+sim_samp_nsym = 0;
+return;
+}
+
+static t_stat samp_loadsym (char *fname)
+{
+FILE *mfile;
+SAMPSYM *nsym;
+int32 lnt = 0;
+char lbuf[CBUFSIZE], abuf[CBUFSIZE], nbuf[CBUFSIZE];
+char *cptr, *tptr;
+t_addr addr;
+t_stat r = SCPE_OK;
+
+if ((mfile = sim_fopen (fname, "r")) == NULL)
+    return SCPE_OPENERR;
+samp_freesym ();
+while (fgets (lbuf, CBUFSIZE, mfile) != NULL) {
+    cptr = lbuf;
+    while (sim_isspace (*cptr))
+        cptr++;
+    if ((*cptr == 0) || (*cptr == ';') || (*cptr == '#'))
+        continue;
+    cptr = get_glyph_nc (cptr, abuf, 0);                /* address */
+    get_glyph_nc (cptr, nbuf, 0);                       /* symbol */
+    addr = (t_addr) strtotv (abuf, &tptr, sim_dflt_dev->aradix);
+    if ((tptr == abuf) || (*tptr != 0) || (nbuf[0] == 0))
+        continue;                                       /* not a symbol line */
+    if (sim_samp_nsym >= lnt) {
+        lnt = lnt? lnt << 1: SAMP_INILNT;
+        nsym = (SAMPSYM *) realloc (sim_samp_sym, lnt * sizeof (SAMPSYM));
+        if (nsym == NULL) {
+            r = SCPE_MEM;
+            break;
+            }
+        sim_samp_sym = nsym;
+        }
+    if ((sim_samp_sym[sim_samp_nsym].name = (char *) malloc (strlen (nbuf) + 1)) == NULL) {
+        r = SCPE_MEM;
+        break;
+        }
+    strcpy (sim_samp_sym[sim_samp_nsym].name, nbuf);
+    sim_samp_sym[sim_samp_nsym++].addr = addr;
+    }
+fclose (mfile);
+if (r != SCPE_OK) {                                     /* out of memory? */
+    samp_freesym ();                                    /* no partial table */
+    return r;
+    }
+qsort (sim_samp_sym, sim_samp_nsym, sizeof (SAMPSYM), samp_symcomp);
+return SCPE_OK;
+}
+
+/* Find the nearest symbol at or below an address */
+
+static SAMPSYM *samp_findsym (t_addr addr)
+{
+int32 lo = 0, hi = sim_samp_nsym - 1, mid;
+SAMPSYM *sp = NULL;
+
+while (lo <= hi) {
+    mid = (lo + hi) >> 1;
+    if (sim_samp_sym[mid].addr <= addr) {
+        sp = &sim_samp_sym[mid];
+        lo = mid + 1;
+        }
+    else hi = mid - 1;
+    }
+return sp;
+}
+
+/* Sort samples by count, largest first, then by address */
+
+static int samp_comp (const void *e1, const void *e2)
+{
+const SAMPENT *p1 = (const SAMPENT *) e1;
+const SAMPENT *p2 = (const SAMPENT *) e2;
+
+if (p1->count != p2->count)
+    return (p1->count > p2->count)? -1: 1;
+if (p1->pc != p2->pc)
+    return (p1->pc < p2->pc)? -1: 1;
+if (p1->mode != p2->mode)
+    return (p1->mode < p2->mode)? -1: 1;
+return 0;
+}
+
+/* Set/show PC sampling */
+
+t_stat sim_set_sample (int32 flag, char *cptr)
+{
+char gbuf[CBUFSIZE], *tptr;
+int32 val;
+t_stat r;
+
+if (flag == 0) {                                        /* SET NOSAMPLE */
+    if ((cptr != NULL) && (*cptr != 0))
+        return SCPE_2MARG;
+    sim_samp_on = FALSE;
+    return SCPE_OK;
+    }
+if ((cptr != NULL) && (*cptr != 0)) {
+    tptr = get_glyph (cptr, gbuf, '=');                 /* keyword or count */
+    if (strcmp (gbuf, "MAP") == 0) {                    /* symbol map? */
+        tptr = get_glyph_nc (tptr, gbuf, 0);
+        if (*tptr != 0)
+            return SCPE_2MARG;
+        if (gbuf[0] == 0)
+            return SCPE_2FARG;
+        return samp_loadsym (gbuf);
+        }
+    if (*tptr != 0)
+        return SCPE_2MARG;
+    val = (int32) get_uint (gbuf, 10, INT_MAX, &r);
+    if ((r != SCPE_OK) || (val <= 0))
+        return SCPE_ARG;
+    sim_samp_intv = val;
+    }
+if (sim_vm_sample_pc == NULL)                           /* not supported? */
+    return SCPE_NOFNC;
+samp_clear ();                                          /* start over */
+sim_samp_on = TRUE;
+return SCPE_OK;
+}
+
+t_stat sim_show_sample (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr)
+{
+SAMPENT *list;
+SAMPSYM *sp;
+uint32 i, n, nshow = SAMP_DSHOW;
+char gbuf[CBUFSIZE];
+DEVICE *dptr = sim_dflt_dev;
+t_bool csv = ((sim_switches & SWMASK ('C')) != 0);
+t_stat r;
+
+if (cptr && (*cptr != 0)) {
+    cptr = get_glyph (cptr, gbuf, 0);
+    if (*cptr != 0)
+        return SCPE_2MARG;
+    nshow = (uint32) get_uint (gbuf, 10, INT_MAX, &r);
+    if (r != SCPE_OK)
+        return SCPE_ARG;
+    }
+if (!csv) {
+    fprintf (st, "PC sampling %s, interval %d instructions",
+        sim_samp_on? "enabled": "disabled", sim_samp_intv);
+    if (sim_samp_nsym)
+        fprintf (st, ", %d symbols", sim_samp_nsym);
+    fprintf (st, "\n");
+    if (sim_samp_total == 0)
+        return SCPE_OK;
+    fprintf (st, "  %.0f samples at %u locations\n\n",
+        (double) sim_samp_total, sim_samp_cnt);
+    }
+if ((list = (SAMPENT *) malloc ((sim_samp_cnt + 1) * sizeof (SAMPENT))) == NULL)
+    return SCPE_MEM;
+for (i = n = 0; i < sim_samp_lnt; i++) {                /* gather entries */
+    if (sim_samp_tab[i].count != 0)
+        list[n++] = sim_samp_tab[i];
+    }
+qsort (list, n, sizeof (SAMPENT), samp_comp);
+if (csv) {                                              /* CSV, everything */
+    fprintf (st, "count,mode,pc,symbol,offset\n");
+    nshow = n;
+    }
+else fprintf (st, "    Samples      %%  Mode  PC\n");
+for (i = 0; (i < n) && (i < nshow); i++) {
+    if (csv)
+        fprintf (st, "%.0f,%u,", (double) list[i].count, list[i].mode);
+    else fprintf (st, "%11.0f %6.2f %5u  ", (double) list[i].count,
+        (((double) list[i].count) * 100.0) / sim_samp_total, list[i].mode);
+    fprint_val (st, (t_value) list[i].pc, dptr->aradix, dptr->awidth, PV_RZRO);
+    sp = samp_findsym (list[i].pc);
+    if (csv) {
+        if (sp)
+            fprintf (st, ",%s,", sp->name);
+        else fprintf (st, ",,");
+        if (sp)
+            fprint_val (st, (t_value) (list[i].pc - sp->addr), dptr->aradix,
+                dptr->awidth, PV_LEFT);
+        }
+    else if (sp) {
+        fprintf (st, "  %s", sp->name);
+        if (list[i].pc != sp->addr) {
+            fprintf (st, "+");
+            fprint_val (st, (t_value) (list[i].pc - sp->addr), dptr->aradix,
+                dptr->awidth, PV_LEFT);
+            }
+        }
+    fprintf (st, "\n");
+    }
+free (list);
+return SCPE_OK;
+}
+
+/* Cancel scheduled step service */
+
+t_stat sim_cancel_step (void)
+{
+return sim_cancel (&sim_step_unit);
+}
+
+/* Signal handler for ^C signal - set stop simulation flag */
+
+void int_handler (int sig)
+{
+stop_cpu = 1;
+return;
+}
+
+/* Get radix from switches or keyword */
+
+int32 get_radix_local (const char *cptr, int32 switches, int32 default_radix)
+{
+if (cptr != NULL)                                       /* if this is a SET radix keyword request */
     return 0;                                           /*   then report that it is invalid */
 else if (switches & SWMASK ('O'))                       /* otherwise if the O switch is present */
     return 8;                                           /*   then use base 8 */
@@ -4653,10 +5998,178 @@ sim_printf ("%s: %s\n", msg, strerror (saved_errno));
    and to see if further events need to be processed, or sim_interval
    reset to count the next one.
 
-   The event queue is maintained in clock order; entry timeouts are
-   RELATIVE to the time in the previous entry.
+   The event queue is a binary min-heap of entries ordered by ABSOLUTE
+   due time on the event queue clock, sim_qnow.  Entries due at the same
+   time are ordered by insertion sequence, so that they are processed
+   first in, first out.  Each queued unit records its heap position in
+   UNIT.qidx (plus one), which makes sim_is_active and sim_cancel O(1)
+   lookups; insertion and removal are O(log n).  sim_clock_queue always
+   points to the unit at the top of the heap (the next event), or is NULL
+   if the queue is empty.
+
+   sim_interval counts down to the next event; sim_qintv holds the value
+   it had when the clocks were last brought up to date.  The difference
+   is the time elapsed since then (see UPDATE_SIM_TIME).
+
+   When an event is processed, the queue clock is set to the event's due
+   time, so any overrun of sim_interval past zero is not charged against
+   the remaining events.  This is the same behavior as the prior delta
+   list implementation.
+
+   sim_process_event dispatches events in batches.  All entries due at
+   the same time are removed from the heap together, sim_interval is
+   computed once for the batch, and the units are then dispatched in
+   insertion order.  While a batch is being dispatched, its units are
+   marked pending (qidx == SIM_QPEND) and still count as active; a
+   pending unit that is canceled (or canceled and reactivated) is skipped.
+   If a service routine returns an error, the undispatched units are put
+   back on the heap with their original times and order.
+
+   A device may supply a batch service routine (DEVICE.svcbatch).  When
+   the first of its units in a batch comes up, all of that device's
+   pending units in the batch are passed to the routine in one call, in
+   place of the individual unit action routines.  A multiplexer can use
+   this to service all of its lines with a single poll.
+*/
+
+#define SIM_QPEND       (-1)                            /* qidx: in dispatch batch */
+
+/* sim_qcomp - compare two queue entries for clock order */
 
-   sim_process_event - process event
+int sim_qcomp (const void *e1, const void *e2)
+{
+const SIM_QENT *q1 = (const SIM_QENT *) e1;
+const SIM_QENT *q2 = (const SIM_QENT *) e2;
+
+if (q1->time != q2->time)
+    return (q1->time < q2->time)? -1: 1;
+if (q1->seq != q2->seq)
+    return (q1->seq < q2->seq)? -1: 1;
+return 0;
+}
+
+#define SIM_QLT(a,b)    (((a)->time < (b)->time) || \
+                         (((a)->time == (b)->time) && ((a)->seq < (b)->seq)))
+
+/* sim_qup - move heap entry toward the root until ordered */
+
+static void sim_qup (int32 i)
+{
+SIM_QENT ent = sim_qheap[i];
+int32 p;
+
+while (i > 0) {
+    p = (i - 1) >> 1;                                   /* parent */
+    if (!SIM_QLT (&ent, &sim_qheap[p]))
+        break;
+    sim_qheap[i] = sim_qheap[p];                        /* move parent down */
+    sim_qheap[i].uptr->qidx = i + 1;
+    i = p;
+    }
+sim_qheap[i] = ent;
+ent.uptr->qidx = i + 1;
+return;
+}
+
+/* sim_qdown - move heap entry toward the leaves until ordered */
+
+static void sim_qdown (int32 i)
+{
+SIM_QENT ent = sim_qheap[i];
+int32 c;
+
+for ( ;; ) {
+    c = (i << 1) + 1;                                   /* left child */
+    if (c >= sim_qcnt)
+        break;
+    if (((c + 1) < sim_qcnt) &&                         /* pick earlier child */
+        SIM_QLT (&sim_qheap[c + 1], &sim_qheap[c]))
+        c = c + 1;
+    if (!SIM_QLT (&sim_qheap[c], &ent))
+        break;
+    sim_qheap[i] = sim_qheap[c];                        /* move child up */
+    sim_qheap[i].uptr->qidx = i + 1;
+    i = c;
+    }
+sim_qheap[i] = ent;
+ent.uptr->qidx = i + 1;
+return;
+}
+
+/* sim_qremove - remove a queued unit from the heap */
+
+static void sim_qremove (UNIT *uptr)
+{
+int32 i = uptr->qidx - 1;
+
+uptr->qidx = 0;                                         /* mark inactive */
+sim_qcnt = sim_qcnt - 1;
+if (i == sim_qcnt)                                      /* last entry? */
+    return;
+sim_qheap[i] = sim_qheap[sim_qcnt];                     /* fill hole with last */
+sim_qheap[i].uptr->qidx = i + 1;
+if ((i > 0) && SIM_QLT (&sim_qheap[i], &sim_qheap[(i - 1) >> 1]))
+    sim_qup (i);
+else sim_qdown (i);
+return;
+}
+
+/* sim_qgrow - make room for another heap entry */
+
+static t_stat sim_qgrow (void)
+{
+SIM_QENT *nheap;
+int32 nlnt;
+
+if (sim_qcnt < sim_qlnt)                                /* room? */
+    return SCPE_OK;
+nlnt = (sim_qlnt == 0)? SIM_QINILNT: sim_qlnt * 2;
+nheap = (SIM_QENT *) realloc (sim_qheap, nlnt * sizeof (SIM_QENT));
+if (nheap == NULL)
+    return SCPE_MEM;
+sim_qheap = nheap;
+sim_qlnt = nlnt;
+return SCPE_OK;
+}
+
+/* sim_qload - reload sim_interval from the next event
+
+   The clocks must be up to date (sim_qintv == sim_interval) on entry.
+*/
+
+static void sim_qload (void)
+{
+if (sim_qcnt == 0) {                                    /* queue empty? */
+    sim_clock_queue = NULL;
+    sim_interval = sim_qintv = NOQUEUE_WAIT;            /* flag queue empty */
+    }
+else {
+    sim_clock_queue = sim_qheap[0].uptr;
+    sim_interval = sim_qintv = (int32) (sim_qheap[0].time - sim_qnow);
+    }
+return;
+}
+
+/* sim_qflush - discard all queued events */
+
+void sim_qflush (void)
+{
+int32 i;
+
+for (i = 0; i < sim_qcnt; i++)                          /* mark all inactive */
+    sim_qheap[i].uptr->qidx = 0;
+for (i = 0; i < sim_qbcnt; i++) {                       /* and any pending */
+    if (sim_qbat[i].uptr->qidx == SIM_QPEND)
+        sim_qbat[i].uptr->qidx = 0;
+    }
+sim_qcnt = 0;
+sim_qbpend = 0;
+sim_qintv = 0;
+sim_clock_queue = NULL;
+return;
+}
+
+/* sim_process_event - process event
 
    Inputs:
         none
@@ -4668,31 +6181,117 @@ sim_printf ("%s: %s\n", msg, strerror (saved_errno));
 t_stat sim_process_event (void)
 {
 UNIT *uptr;
+DEVICE *dptr;
+SIM_QENT *nbat;
+UNIT **nlist;
+int32 i, j, nlst;
+t_uint64 bstart = 0, pstart;
 t_stat reason;
 
 if (stop_cpu)                                           /* stop CPU? */
     return SCPE_STOP;
-if (sim_clock_queue == NULL) {                          /* queue empty? */
-    UPDATE_SIM_TIME (noqueue_time);                     /* update sim time */
-    sim_interval = noqueue_time = NOQUEUE_WAIT;         /* flag queue empty */
+sim_aio_poll ();                                        /* deliver wakeups */
+if (sim_bench_on) {                                     /* benchmark? */
+    bstart = sim_os_nsec ();
+    sim_bench_ncall = sim_bench_ncall + 1;
+    sim_bench_qsum = sim_bench_qsum + sim_qcnt;
+    if (sim_qcnt > sim_bench_qmax)
+        sim_bench_qmax = sim_qcnt;
+    }
+if (sim_prof_on) {                                      /* profiling? */
+    for (i = 0; (i < (PROF_NQH - 1)) && ((sim_qcnt >> i) != 0); i++) ;
+    sim_prof_qhist[i] = sim_prof_qhist[i] + 1;          /* log2 depth bucket */
+    }
+UPDATE_SIM_TIME (sim_qintv);                            /* update sim time */
+if (sim_qcnt == 0) {                                    /* queue empty? */
+    sim_interval = sim_qintv = NOQUEUE_WAIT;            /* flag queue empty */
     return SCPE_OK;
     }
-UPDATE_SIM_TIME (sim_clock_queue->time);                /* update sim time */
 do {
-    uptr = sim_clock_queue;                             /* get first */
-    sim_clock_queue = uptr->next;                       /* remove first */
-    uptr->next = NULL;                                  /* hygiene */
-    uptr->time = 0;
-    if (sim_clock_queue != NULL)
-        sim_interval = sim_clock_queue->time;
-    else sim_interval = noqueue_time = NOQUEUE_WAIT;
-    if (uptr->action != NULL)
-        reason = uptr->action (uptr);
-    else reason = SCPE_OK;
+    if (sim_qblnt < sim_qlnt) {                         /* batch too small? */
+        nbat = (SIM_QENT *) realloc (sim_qbat, sim_qlnt * sizeof (SIM_QENT));
+        if (nbat == NULL)
+            return SCPE_MEM;
+        sim_qbat = nbat;
+        nlist = (UNIT **) realloc (sim_qulist, sim_qlnt * sizeof (UNIT *));
+        if (nlist == NULL)
+            return SCPE_MEM;
+        sim_qulist = nlist;
+        sim_qblnt = sim_qlnt;
+        }
+    sim_qnow = sim_qheap[0].time;                       /* clock to due time */
+    sim_qbcnt = 0;
+    do {                                                /* remove all due now */
+        uptr = sim_qheap[0].uptr;
+        sim_qbat[sim_qbcnt++] = sim_qheap[0];
+        sim_qremove (uptr);
+        uptr->qidx = SIM_QPEND;                         /* mark pending */
+        } while ((sim_qcnt != 0) && (sim_qheap[0].time == sim_qnow));
+    sim_qbpend = sim_qbcnt;
+    sim_qload ();                                       /* time to next batch */
+    reason = SCPE_OK;
+    for (i = 0; (i < sim_qbcnt) && (sim_qbpend != 0); i++) {
+        uptr = sim_qbat[i].uptr;
+        if (uptr->qidx != SIM_QPEND)                    /* canceled? */
+            continue;
+        dptr = uptr->dptr;
+        if ((dptr != NULL) && (dptr->svcbatch != NULL)) {
+            for (j = i, nlst = 0; j < sim_qbcnt; j++) { /* gather device's units */
+                if ((sim_qbat[j].uptr->dptr == dptr) &&
+                    (sim_qbat[j].uptr->qidx == SIM_QPEND)) {
+                    sim_qbat[j].uptr->qidx = 0;
+                    sim_qbpend = sim_qbpend - 1;
+                    sim_qulist[nlst++] = sim_qbat[j].uptr;
+                    }
+                }
+            sim_qndisp = sim_qndisp + nlst;
+            if (sim_prof_on) {                          /* profiling? */
+                pstart = sim_os_nsec ();
+                reason = dptr->svcbatch (dptr, sim_qulist, nlst);
+                pstart = (sim_os_nsec () - pstart) / nlst;  /* share of batch */
+                for (j = 0; j < nlst; j++)
+                    prof_svc (sim_qulist[j], pstart);
+                }
+            else reason = dptr->svcbatch (dptr, sim_qulist, nlst);
+            }
+        else {
+            uptr->qidx = 0;
+            sim_qbpend = sim_qbpend - 1;
+            sim_qndisp = sim_qndisp + 1;
+            if (uptr->action == NULL)                   /* no action? */
+                continue;
+            if (sim_prof_on) {                          /* profiling? */
+                pstart = sim_os_nsec ();
+                reason = uptr->action (uptr);
+                prof_svc (uptr, sim_os_nsec () - pstart);
+                }
+            else reason = uptr->action (uptr);
+            }
+        if (reason != SCPE_OK)
+            break;
+        }
+    if (sim_qbpend != 0) {                              /* undispatched units? */
+        UPDATE_SIM_TIME (sim_qintv);
+        for ( ; i < sim_qbcnt; i++) {                   /* requeue in order */
+            uptr = sim_qbat[i].uptr;
+            if (uptr->qidx != SIM_QPEND)
+                continue;
+            if (sim_qgrow () != SCPE_OK)
+                return SCPE_MEM;
+            sim_qheap[sim_qcnt] = sim_qbat[i];
+            sim_qcnt = sim_qcnt + 1;
+            sim_qup (sim_qcnt - 1);
+            }
+        sim_qbpend = 0;
+        sim_qload ();
+        }
+    sim_qbcnt = 0;
     } while ((reason == SCPE_OK) && (sim_interval <= 0));
 
 /* Empty queue forces sim_interval != 0 */
 
+if (sim_bench_on)                                       /* benchmark? */
+    sim_bench_evns = sim_bench_evns + (sim_os_nsec () - bstart);
 return reason;
 }
 
@@ -4707,40 +6306,21 @@ return reason;
 
 t_stat sim_activate (UNIT *uptr, int32 event_time)
 {
-UNIT *cptr, *prvptr;
-int32 accum;
-
 if (event_time < 0)
     return SCPE_IERR;
-if (sim_is_active (uptr))                               /* already active? */
+if (uptr->qidx != 0)                                    /* already active? */
     return SCPE_OK;
-if (sim_clock_queue == NULL) {
-    UPDATE_SIM_TIME (noqueue_time);
-    }
-else  {                                                 /* update sim time */
-    UPDATE_SIM_TIME (sim_clock_queue->time);
-    }
-
-prvptr = NULL;
-accum = 0;
-for (cptr = sim_clock_queue; cptr != NULL; cptr = cptr->next) {
-    if (event_time < (accum + cptr->time))
-        break;
-    accum = accum + cptr->time;
-    prvptr = cptr;
-    }
-if (prvptr == NULL) {                                   /* insert at head */
-    cptr = uptr->next = sim_clock_queue;
-    sim_clock_queue = uptr;
-    }
-else {
-    cptr = uptr->next = prvptr->next;                   /* insert at prvptr */
-    prvptr->next = uptr;
-    }
-uptr->time = event_time - accum;
-if (cptr != NULL)
-    cptr->time = cptr->time - uptr->time;
-sim_interval = sim_clock_queue->time;
+if (sim_qgrow () != SCPE_OK)                            /* heap full? */
+    return SCPE_MEM;
+UPDATE_SIM_TIME (sim_qintv);                            /* update sim time */
+sim_qheap[sim_qcnt].time = sim_qnow + event_time;
+sim_qheap[sim_qcnt].seq = sim_qseq++;
+sim_qheap[sim_qcnt].uptr = uptr;
+sim_qcnt = sim_qcnt + 1;
+sim_qup (sim_qcnt - 1);                                 /* insert in order */
+sim_qload ();
+if (sim_prof_on)                                        /* profiling? */
+    prof_act (uptr, event_time);
 return SCPE_OK;
 }
 
@@ -4770,29 +6350,16 @@ return sim_activate (uptr, event_time);
 
 t_stat sim_cancel (UNIT *uptr)
 {
-UNIT *cptr, *nptr;
-
-if (sim_clock_queue == NULL)
+if (uptr->qidx == 0)                                    /* not queued? */
+    return SCPE_OK;
+if (uptr->qidx == SIM_QPEND) {                          /* in dispatch batch? */
+    uptr->qidx = 0;                                     /* will be skipped */
+    sim_qbpend = sim_qbpend - 1;
     return SCPE_OK;
-UPDATE_SIM_TIME (sim_clock_queue->time);                /* update sim time */
-nptr = NULL;
-if (sim_clock_queue == uptr)
-    nptr = sim_clock_queue = uptr->next;
-else {
-    for (cptr = sim_clock_queue; cptr != NULL; cptr = cptr->next) {
-        if (cptr->next == uptr) {
-            nptr = cptr->next = uptr->next;
-            break;                                      /* end queue scan */
-            }
-        }
     }
-if (nptr != NULL)
-    nptr->time = nptr->time + uptr->time;
-uptr->next = NULL;                                      /* hygiene */
-uptr->time = 0;
-if (sim_clock_queue != NULL)
-    sim_interval = sim_clock_queue->time;
-else sim_interval = noqueue_time = NOQUEUE_WAIT;
+UPDATE_SIM_TIME (sim_qintv);                            /* update sim time */
+sim_qremove (uptr);
+sim_qload ();
 return SCPE_OK;
 }
 
@@ -4802,24 +6369,23 @@ return SCPE_OK;
         uptr    =       pointer to unit
    Outputs:
         result =        absolute activation time + 1, 0 if inactive
+
+   The time remaining for the first entry is sim_interval; other entries
+   are timed relative to the first.
 */
 
 int32 sim_is_active (UNIT *uptr)
 {
-UNIT *cptr;
 int32 accum;
 
-accum = 0;
-for (cptr = sim_clock_queue; cptr != NULL; cptr = cptr->next) {
-    if (cptr == sim_clock_queue) {
-        if (sim_interval > 0)
-            accum = accum + sim_interval;
-        }
-    else accum = accum + cptr->time;
-    if (cptr == uptr)
-        return accum + 1;
-    }
-return 0;
+if (uptr->qidx == 0)                                    /* not queued? */
+    return 0;
+if (uptr->qidx == SIM_QPEND)                            /* due now? */
+    return 1;
+accum = (int32) (sim_qheap[uptr->qidx - 1].time - sim_qheap[0].time);
+if (sim_interval > 0)
+    accum = accum + sim_interval;
+return accum + 1;
 }
 
 /* sim_gtime - return global time
@@ -4832,23 +6398,13 @@ return 0;
 
 double sim_gtime (void)
 {
-if (sim_clock_queue == NULL) {
-    UPDATE_SIM_TIME (noqueue_time);
-    }
-else  {
-    UPDATE_SIM_TIME (sim_clock_queue->time);
-    }
+UPDATE_SIM_TIME (sim_qintv);
 return sim_time;
 }
 
 uint32 sim_grtime (void)
 {
-if (sim_clock_queue == NULL) {
-    UPDATE_SIM_TIME (noqueue_time);
-    }
-else  {
-    UPDATE_SIM_TIME (sim_clock_queue->time);
-    }
+UPDATE_SIM_TIME (sim_qintv);
 return sim_rtime;
 }
 
@@ -4861,13 +6417,7 @@ return sim_rtime;
 
 int32 sim_qcount (void)
 {
-int32 cnt;
-UNIT *uptr;
-
-cnt = 0;
-for (uptr = sim_clock_queue; uptr != NULL; uptr = uptr->next)
-    cnt++;
-return cnt;
+return sim_qcnt + sim_qbpend;
 }
 
 /* Breakpoint package.  This module replaces the VM-implemented one
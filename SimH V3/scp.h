@@ -23,6 +23,10 @@
    be used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added dirty page tracking
+                        Added RU_BENCH
+                        Added sim_set_profile, sim_show_profile
+                        Added sim_set_sample, sim_show_sample, sim_vm_sample_pc
    04-Jun-20    JDB     Declaration of "sim_vm_init" is now conditional on USE_VM_INIT
    08-Dec-19    JDB     Added "sim_vm_unit_name" extension hook
    09-Oct-19    JDB     Added "detach_all" global declaration
@@ -60,6 +64,7 @@
 #define RU_STEP         2                               /* step */
 #define RU_CONT         3                               /* continue */
 #define RU_BOOT         4                               /* boot */
+#define RU_BENCH        5                               /* benchmark */
 
 /* exdep_cmd parameters */
 
@@ -187,6 +192,24 @@ t_stat sim_brk_clr (t_addr loc, int32 sw);
 void sim_brk_clract (void);
 char *sim_brk_getact (char *buf, int32 size);
 char *read_line (char *ptr, int32 size, FILE *stream);
+t_stat sim_dirty_setup (UNIT *uptr, uint32 shift);
+void sim_dirty_mark (UNIT *uptr, t_addr addr, t_addr lnt);
+void sim_dirty_all (void);
+t_bool sim_dirty_test (UNIT *uptr, t_addr addr, t_addr lnt);
+void sim_dirty_clear (void);
+t_stat sim_set_dirty (int32 flag, char *cptr);
+t_stat sim_show_dirty (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr);
+t_stat sim_set_profile (int32 flag, char *cptr);
+t_stat sim_show_profile (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr);
+t_stat sim_set_sample (int32 flag, char *cptr);
+t_stat sim_show_sample (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr);
+
+/* Dirty page tracking: mark the page holding address a of the tracked unit */
+
+#define SIM_DIRTY(a)    ((sim_dirty_map != NULL)? \
+                            (void) (sim_dirty_map[((uint32) (a)) >> (sim_dirty_shift + 5)] |= \
+                            (1u << ((((uint32) (a)) >> sim_dirty_shift) & 0x1F))): \
+                            (void) 0)
 
 /* Global data */
 
@@ -207,6 +230,8 @@ extern uint32 sim_brk_summ;
 extern char *sim_brk_act;                               /* breakpoint actions pointer */
 extern char *sim_prog_name;                             /* executable program name */
 extern uint32 sim_ref_type;                             /* reference type */
+extern uint32 *sim_dirty_map;                           /* dirty page bitmap */
+extern uint32 sim_dirty_shift;                          /* log2 dirty page size */
 
 /* Extension interface */
 
@@ -263,5 +288,6 @@ extern t_bool (*sim_vm_fprint_stopped) (FILE *st, t_stat reason);
 #define sim_activate_time(u)    sim_is_active (u)
 void sim_perror (char *msg);
 extern t_bool (*sim_vm_is_subroutine_call) (t_addr **ret_addrs);
+extern t_addr (*sim_vm_sample_pc) (uint32 *mode);
 
 #endif
@@ -25,6 +25,7 @@
 
    cpu          central processor
 
+   18-Oct-26    RMS     Added idle support
    04-May-23    RMS     Implement WAIT
    12-Jul-22    RMS     Fix incorrect decrement on breakpoint (Ken Rector)
 
@@ -362,6 +363,8 @@ MTAB cpu_mod[] = {
       NULL, &cpu_show_addr },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "HISTORY", "HISTORY",
       &cpu_set_hist, &cpu_show_hist },
+    { MTAB_XTD|MTAB_VDV, 0, "IDLE", "IDLE", &sim_set_idle, &sim_show_idle },
+    { MTAB_XTD|MTAB_VDV, 0, NULL, "NOIDLE", &sim_clr_idle, NULL },
     { 0 }
     };
 
@@ -507,6 +510,7 @@ while (reason == 0) {                                   /* loop until stop */
                 PC = old_PC;
             }                                           /* end if abnormal status */
         }                                               /* end else normal */
+    else sim_idle (TMR_RTC, FALSE);                     /* wait state, idle */
     }                                                   /* end while */
 
 /* Simulation halted */
@@ -1503,7 +1507,6 @@ switch (op) {
             return tr;
         if (!io_poss_int ())                            /* intr possible? */
             return STOP_WAITNOINT;                      /* machine is hung */
-// put idle here
         wait_state = 1;                                 /* wait for intr */
         break;
 
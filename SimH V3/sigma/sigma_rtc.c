@@ -25,6 +25,7 @@
 
    rtc           clocks
 
+   18-Oct-26    RMS     Added UNIT_IDLE flag
    13-Mar-17    RMS     Fixed bugs in set, show_tps (COVERITY)
 
    The real-time clock includes an internal scheduler for events which need to
@@ -85,7 +86,7 @@ t_stat rtc_show_events (FILE *of, UNIT *uptr, int32 val, CONST void *desc);
    rtc_reg      RTC register list
 */
 
-UNIT rtc_unit = { UDATA (&rtc_svc, 0, 0), RTC_TICKS_DFLT };
+UNIT rtc_unit = { UDATA (&rtc_svc, UNIT_IDLE, 0), RTC_TICKS_DFLT };
 
 UNIT rtc_cntr_unit[RTC_NUM_CNTRS] = {
     { UDATA (&rtc_cntr_svc, 0, 0) },
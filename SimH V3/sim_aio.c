@@ -0,0 +1,534 @@
+/* sim_aio.c: simulator asynchronous I/O library
+
+   Copyright (c) 2026, Robert M Supnik
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Robert M Supnik shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Robert M Supnik.
+
+   18-Oct-26    RMS     Initial version
+                        Added completion routines
+                        Required thread-local storage for workers
+                        Added wakeups from other threads
+                        Fixed cancel of a wakeup racing with its producer
+
+   This library includes:
+
+   sim_aio_start        start a request
+   sim_aio_cancel       wait for a request and discard its completion
+   sim_aio_flush        wait for all requests and deliver their completions
+   sim_aio_wake         activate a unit from another thread
+   sim_aio_listen       register/deregister a source of wakeups
+   sim_aio_poll         deliver posted completions and wakeups
+   sim_aio_sleep        idle sleep, ended early by a wakeup
+   sim_set_asynch       enable/disable asynchronous I/O
+   sim_show_asynch      show asynchronous I/O state
+
+   A device that wants to overlap file I/O with instruction execution
+   describes a transfer in a SIM_AIO request and calls sim_aio_start from
+   its unit service routine.  If asynchronous I/O is enabled, the request
+   is handed to a pool of worker threads, sim_aio_start returns TRUE, and
+   the service routine returns without rescheduling the unit.  When the
+   transfer completes, the unit is activated with the request in state
+   AIO_DONE, and the service routine picks up the results.  If
+   asynchronous I/O is disabled or unavailable, the transfer is done
+   immediately, sim_aio_start returns FALSE, and the service routine
+   picks up the results at once.  Either way, the device code is the same,
+   and with asynchronous I/O disabled, timing is exactly as before.
+
+   Workers hand completions back to the simulator thread through a
+   lock-free list.  While requests are outstanding, a library unit polls
+   that list every SIM_AIO_LAT instructions and moves completed requests
+   onto the event queue.  All requests are drained whenever the simulator
+   stops, so SCP commands never run concurrently with a transfer.
+
+   An AIO_CALL routine runs in a worker and must not change state that
+   the simulator thread can see.  It can work on the request's private
+   copy of a unit; the request's completion routine, if any, runs in the
+   simulator thread, before the unit is activated or, for a request done
+   immediately, before sim_aio_start returns, and copies the results
+   back.
+
+   A request must not be restarted until it has been returned to state
+   AIO_IDLE by its owner.  A device must sim_aio_cancel its requests when
+   it is reset.
+
+   A library thread that produces input for a device, such as an Ethernet
+   reader, describes the device's unit in an AIO_WAKE request and calls
+   sim_aio_wake, from any thread, when input arrives.  The request is
+   posted on the same completion list; a wake that is already pending is
+   not posted again.  The simulator thread checks the list on every
+   event and at the end of every idle sleep, so the unit is activated
+   without a polling unit.  While wake sources are registered with
+   sim_aio_listen, idle sleeps wait on the completion list rather than
+   sleeping outright, so an arriving frame ends the sleep at once.
+*/
+
+#include "sim_defs.h"
+
+t_stat sim_aio_svc (UNIT *uptr);
+
+UNIT sim_aio_unit = { UDATA (&sim_aio_svc, 0, 0) };
+
+static t_bool sim_asynch_enabled = FALSE;               /* async enabled */
+static int32 sim_aio_nbusy = 0;                         /* # outstanding */
+static int32 sim_aio_nlisten = 0;                       /* # wake sources */
+
+/* Execute a request, in either the simulator thread or a worker */
+
+static void sim_aio_exec (SIM_AIO *req)
+{
+FILE *fptr = req->uptr->fileref;
+
+req->xfer = 0;
+req->err = 0;
+req->stat = SCPE_OK;
+switch (req->op) {
+
+    case AIO_READ:
+        req->err = sim_fseeko (fptr, req->pos, SEEK_SET);
+        if (req->err == 0) {
+            req->xfer = sim_fread (req->buf, req->size, req->count, fptr);
+            req->err = ferror (fptr);
+            }
+        break;
+
+    case AIO_WRITE:
+        req->err = sim_fseeko (fptr, req->pos, SEEK_SET);
+        if (req->err == 0) {
+            req->xfer = sim_fwrite (req->buf, req->size, req->count, fptr);
+            req->err = ferror (fptr);
+            }
+        break;
+
+    case AIO_CALL:
+        req->routine (req);
+        break;
+
+    case AIO_WAKE:                                      /* nothing to do */
+        break;
+        }
+return;
+}
+
+#if defined (SIM_ASYNCH_IO)
+
+#include <pthread.h>
+#include <time.h>
+
+/* Lock-free completion list.  Workers push with compare and swap; the
+   simulator thread removes the whole list with a single exchange. */
+
+#if defined (__GNUC__)
+#define AIO_CAS(p,o,n)  __sync_bool_compare_and_swap (p, o, n)
+#define AIO_CAS32(p,o,n) __sync_bool_compare_and_swap (p, o, n)
+#define AIO_XCHG(p,n)   __sync_lock_test_and_set (p, n)
+#elif defined (_WIN32)
+#define AIO_CAS(p,o,n)  (InterlockedCompareExchangePointer ((PVOID volatile *) (p), (n), (o)) == (o))
+#define AIO_CAS32(p,o,n) (InterlockedCompareExchange ((LONG volatile *) (p), (n), (o)) == (o))
+#define AIO_XCHG(p,n)   InterlockedExchangePointer ((PVOID volatile *) (p), (n))
+#endif
+
+static SIM_AIO * volatile sim_aio_dlist = NULL;         /* done list */
+static SIM_AIO *sim_aio_qhead = NULL;                   /* work queue */
+static SIM_AIO *sim_aio_qtail = NULL;
+static int32 sim_aio_nthr = 0;                          /* # threads */
+static pthread_mutex_t sim_aio_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_aio_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t sim_aio_post = PTHREAD_COND_INITIALIZER;
+
+/* Post a completion (worker) */
+
+static void sim_aio_push (SIM_AIO *req)
+{
+SIM_AIO *top;
+
+req->state = AIO_POST;
+#if defined (AIO_CAS)
+do {
+    top = sim_aio_dlist;
+    req->next = top;
+    } while (!AIO_CAS (&sim_aio_dlist, top, req));
+pthread_mutex_lock (&sim_aio_lock);
+#else
+pthread_mutex_lock (&sim_aio_lock);
+req->next = sim_aio_dlist;
+sim_aio_dlist = req;
+#endif
+pthread_cond_broadcast (&sim_aio_post);                 /* wake waiters */
+pthread_mutex_unlock (&sim_aio_lock);
+return;
+}
+
+/* Take all completions (simulator thread) */
+
+static SIM_AIO *sim_aio_take (void)
+{
+SIM_AIO *lst;
+
+#if defined (AIO_CAS)
+if (sim_aio_dlist == NULL)                              /* quick check */
+    return NULL;
+lst = (SIM_AIO *) AIO_XCHG (&sim_aio_dlist, NULL);
+#else
+pthread_mutex_lock (&sim_aio_lock);
+lst = sim_aio_dlist;
+sim_aio_dlist = NULL;
+pthread_mutex_unlock (&sim_aio_lock);
+#endif
+return lst;
+}
+
+/* Worker thread */
+
+static void *sim_aio_worker (void *arg)
+{
+SIM_AIO *req;
+
+for ( ;; ) {
+    pthread_mutex_lock (&sim_aio_lock);
+    while (sim_aio_qhead == NULL)
+        pthread_cond_wait (&sim_aio_work, &sim_aio_lock);
+    req = sim_aio_qhead;                                /* dequeue */
+    sim_aio_qhead = req->next;
+    if (sim_aio_qhead == NULL)
+        sim_aio_qtail = NULL;
+    pthread_mutex_unlock (&sim_aio_lock);
+    sim_aio_exec (req);                                 /* do it */
+    sim_aio_push (req);                                 /* post completion */
+    }
+return NULL;
+}
+
+/* Wait for at least one completion to be posted */
+
+static void sim_aio_wait (void)
+{
+pthread_mutex_lock (&sim_aio_lock);
+while (sim_aio_dlist == NULL)
+    pthread_cond_wait (&sim_aio_post, &sim_aio_lock);
+pthread_mutex_unlock (&sim_aio_lock);
+return;
+}
+
+/* Wait up to usec microseconds for a completion to be posted */
+
+static void sim_aio_twait (uint32 usec)
+{
+#if !defined (_WIN32)
+struct timespec ts;
+
+clock_gettime (CLOCK_REALTIME, &ts);
+ts.tv_sec = ts.tv_sec + (usec / 1000000);
+ts.tv_nsec = ts.tv_nsec + ((usec % 1000000) * 1000);
+if (ts.tv_nsec >= 1000000000) {
+    ts.tv_sec = ts.tv_sec + 1;
+    ts.tv_nsec = ts.tv_nsec - 1000000000;
+    }
+pthread_mutex_lock (&sim_aio_lock);
+while (sim_aio_dlist == NULL) {
+    if (pthread_cond_timedwait (&sim_aio_post, &sim_aio_lock, &ts) != 0)
+        break;                                          /* timed out */
+    }
+pthread_mutex_unlock (&sim_aio_lock);
+#else
+sim_os_us_sleep (usec);
+#endif
+return;
+}
+
+/* Post a wakeup (any thread); a wakeup already pending is not posted again */
+
+void sim_aio_wake (SIM_AIO *req)
+{
+#if defined (AIO_CAS32)
+if (!AIO_CAS32 (&req->state, AIO_IDLE, AIO_BUSY))       /* already pending? */
+    return;
+#else
+pthread_mutex_lock (&sim_aio_lock);
+if (req->state != AIO_IDLE) {                           /* already pending? */
+    pthread_mutex_unlock (&sim_aio_lock);
+    return;
+    }
+req->state = AIO_BUSY;
+pthread_mutex_unlock (&sim_aio_lock);
+#endif
+sim_aio_push (req);
+return;
+}
+
+/* Return a delivered wakeup to AIO_IDLE (simulator thread) */
+
+static void sim_aio_rearm (SIM_AIO *req)
+{
+#if defined (AIO_CAS32)
+AIO_CAS32 (&req->state, AIO_POST, AIO_IDLE);            /* with barrier */
+#else
+pthread_mutex_lock (&sim_aio_lock);
+req->state = AIO_IDLE;
+pthread_mutex_unlock (&sim_aio_lock);
+#endif
+return;
+}
+
+/* Queue a request to the workers, starting them if needed */
+
+static t_bool sim_aio_queue (SIM_AIO *req)
+{
+pthread_t thr;
+pthread_attr_t attr;
+
+if (sim_aio_nthr == 0) {                                /* first time? */
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    while ((sim_aio_nthr < SIM_AIO_NTHR) &&
+        (pthread_create (&thr, &attr, &sim_aio_worker, NULL) == 0))
+        sim_aio_nthr = sim_aio_nthr + 1;
+    pthread_attr_destroy (&attr);
+    if (sim_aio_nthr == 0)                              /* no threads? */
+        return FALSE;
+    }
+req->state = AIO_BUSY;
+req->next = NULL;
+pthread_mutex_lock (&sim_aio_lock);
+if (sim_aio_qtail)
+    sim_aio_qtail->next = req;
+else sim_aio_qhead = req;
+sim_aio_qtail = req;
+pthread_cond_signal (&sim_aio_work);
+pthread_mutex_unlock (&sim_aio_lock);
+return TRUE;
+}
+
+#else
+
+static SIM_AIO *sim_aio_take (void)
+{
+return NULL;
+}
+
+static void sim_aio_wait (void)
+{
+return;
+}
+
+static void sim_aio_twait (uint32 usec)
+{
+sim_os_us_sleep (usec);
+return;
+}
+
+/* Without threads, wakeups can only come from the simulator thread */
+
+void sim_aio_wake (SIM_AIO *req)
+{
+sim_activate (req->uptr, req->delay);
+return;
+}
+
+static void sim_aio_rearm (SIM_AIO *req)
+{
+req->state = AIO_IDLE;
+return;
+}
+
+#endif
+
+/* Deliver posted completions and wakeups: activate the owning units in
+   the order in which they were posted */
+
+static void sim_aio_deliver (void)
+{
+SIM_AIO *req, *nxt, *lst;
+UNIT *uptr;
+int32 delay;
+
+for (req = sim_aio_take (), lst = NULL; req != NULL; req = nxt) {
+    nxt = req->next;                                    /* reverse list */
+    req->next = lst;
+    lst = req;
+    }
+for (req = lst; req != NULL; req = nxt) {
+    nxt = req->next;
+    req->next = NULL;
+    if (req->op == AIO_WAKE) {                          /* wakeup? */
+        uptr = req->uptr;
+        delay = req->delay;
+        sim_aio_rearm (req);                            /* may be reposted */
+        sim_activate (uptr, delay);
+        continue;
+        }
+    req->state = AIO_DONE;
+    sim_aio_nbusy = sim_aio_nbusy - 1;
+    if (req->done)                                      /* completion routine? */
+        req->done (req);
+    sim_activate (req->uptr, 0);
+    }
+return;
+}
+
+/* Deliver anything posted, called from the event loop */
+
+void sim_aio_poll (void)
+{
+sim_aio_deliver ();
+return;
+}
+
+/* Register or deregister a source of wakeups */
+
+void sim_aio_listen (t_bool flag)
+{
+if (flag)
+    sim_aio_nlisten = sim_aio_nlisten + 1;
+else if (sim_aio_nlisten > 0)
+    sim_aio_nlisten = sim_aio_nlisten - 1;
+return;
+}
+
+/* Idle sleep
+
+   Inputs:
+        usec    =       microseconds to sleep
+   Outputs:
+        usec    =       microseconds actually slept
+
+   With no wake sources, this is sim_os_us_sleep.  Otherwise, the sleep
+   ends as soon as anything is posted, and it is delivered at once.
+*/
+
+uint32 sim_aio_sleep (uint32 usec)
+{
+t_uint64 start;
+
+if (sim_aio_nlisten == 0)                               /* no wake sources? */
+    return sim_os_us_sleep (usec);
+start = sim_os_nsec ();
+sim_aio_twait (usec);
+sim_aio_deliver ();
+return (uint32) ((sim_os_nsec () - start) / 1000);
+}
+
+/* Completion poll service */
+
+t_stat sim_aio_svc (UNIT *uptr)
+{
+sim_aio_deliver ();
+if (sim_aio_nbusy > 0)                                  /* more pending? */
+    sim_activate (uptr, SIM_AIO_LAT);
+return SCPE_OK;
+}
+
+/* Start a request
+
+   Inputs:
+        req     =       request, in state AIO_IDLE
+   Outputs:
+        TRUE if queued, unit will be activated in state AIO_DONE
+        FALSE if done, results are in the request, state is AIO_IDLE
+*/
+
+t_bool sim_aio_start (SIM_AIO *req)
+{
+#if defined (SIM_ASYNCH_IO)
+if (sim_asynch_enabled && sim_aio_queue (req)) {        /* queue to workers */
+    sim_aio_nbusy = sim_aio_nbusy + 1;
+    if (!sim_is_active (&sim_aio_unit))
+        sim_activate (&sim_aio_unit, SIM_AIO_LAT);
+    return TRUE;
+    }
+#endif
+sim_aio_exec (req);                                     /* do it now */
+if (req->done)                                          /* completion routine? */
+    req->done (req);
+req->state = AIO_IDLE;
+return FALSE;
+}
+
+/* Wait for a request to finish and discard its completion
+
+   A wakeup's producer may still be running, and may post it again at any
+   time, so its state is never forced; a pending wakeup is delivered, and
+   any later one just activates the unit, which must ignore it if it no
+   longer expects input.
+*/
+
+void sim_aio_cancel (SIM_AIO *req)
+{
+if (req->op == AIO_WAKE) {                              /* wakeup? */
+    while (req->state != AIO_IDLE) {                    /* until delivered */
+        if (req->state == AIO_BUSY)                     /* being posted? */
+            sim_aio_wait ();
+        sim_aio_deliver ();
+        }
+    return;
+    }
+while (req->state == AIO_BUSY) {                        /* in progress? */
+    sim_aio_wait ();
+    sim_aio_deliver ();
+    }
+if (req->state == AIO_POST)                             /* posted? */
+    sim_aio_deliver ();
+if (req->state == AIO_DONE)                             /* delivered? */
+    sim_cancel (req->uptr);
+req->state = AIO_IDLE;
+return;
+}
+
+/* Wait for all requests and deliver their completions */
+
+void sim_aio_flush (void)
+{
+while (sim_aio_nbusy > 0) {
+    sim_aio_wait ();
+    sim_aio_deliver ();
+    }
+sim_cancel (&sim_aio_unit);
+return;
+}
+
+/* Set/show asynchronous I/O */
+
+t_stat sim_set_asynch (int32 flag, char *cptr)
+{
+if ((cptr != NULL) && (*cptr != 0))
+    return SCPE_2MARG;
+#if defined (SIM_ASYNCH_IO) && defined (SIM_TLS)
+if (flag == 0)                                          /* disabling? */
+    sim_aio_flush ();                                   /* drain first */
+sim_asynch_enabled = (flag != 0);
+return SCPE_OK;
+#else
+return (flag? SCPE_NOFNC: SCPE_OK);
+#endif
+}
+
+t_stat sim_show_asynch (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr)
+{
+if (cptr && (*cptr != 0))
+    return SCPE_2MARG;
+#if defined (SIM_ASYNCH_IO) && defined (SIM_TLS)
+fprintf (st, "Asynchronous I/O %s, %d worker threads, %d requests pending\n",
+    (sim_asynch_enabled? "enabled": "disabled"), SIM_AIO_NTHR, sim_aio_nbusy);
+#else
+fprintf (st, "Asynchronous I/O not available\n");
+#endif
+return SCPE_OK;
+}
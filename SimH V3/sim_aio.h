@@ -0,0 +1,95 @@
+/* sim_aio.h: simulator asynchronous I/O library headers
+
+   Copyright (c) 2026, Robert M Supnik
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Robert M Supnik shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Robert M Supnik.
+
+   18-Oct-26    RMS     Initial version
+                        Added completion routine, private unit copy
+                        Added SIM_TLS
+                        Added wakeups from other threads
+*/
+
+#ifndef _SIM_AIO_H_
+#define _SIM_AIO_H_     0
+
+#define SIM_AIO_NTHR    2                               /* # worker threads */
+#define SIM_AIO_LAT     100                             /* completion poll */
+
+/* Thread-local storage, for state shared by the simulator thread and the
+   workers.  Without it, workers are not used. */
+
+#if defined (SIM_ASYNCH_IO)
+#if defined (__GNUC__)
+#define SIM_TLS         __thread
+#elif defined (_MSC_VER)
+#define SIM_TLS         __declspec(thread)
+#endif
+#endif
+
+/* Request operations */
+
+#define AIO_READ        0                               /* sim_fread at pos */
+#define AIO_WRITE       1                               /* sim_fwrite at pos */
+#define AIO_CALL        2                               /* call routine */
+#define AIO_WAKE        3                               /* activate unit only */
+
+/* Request states */
+
+#define AIO_IDLE        0                               /* not in use */
+#define AIO_BUSY        1                               /* queued or in progress */
+#define AIO_POST        2                               /* complete, not delivered */
+#define AIO_DONE        3                               /* complete, unit activated */
+
+typedef struct sim_aio SIM_AIO;
+
+struct sim_aio {
+    UNIT                *uptr;                          /* unit */
+    int32               op;                             /* operation */
+    t_offset            pos;                            /* file position */
+    void                *buf;                           /* buffer */
+    size_t              size;                           /* element size */
+    size_t              count;                          /* element count */
+    void                (*routine)(SIM_AIO *req);       /* AIO_CALL routine */
+    void                (*done)(SIM_AIO *req);          /* completion routine */
+    UNIT                unit;                           /* private unit copy */
+    size_t              xfer;                           /* elements transferred */
+    int                 err;                            /* host error */
+    t_stat              stat;                           /* routine status */
+    int32               delay;                          /* AIO_WAKE delay */
+    volatile int32      state;                          /* request state */
+    SIM_AIO * volatile  next;                           /* queue link */
+    };
+
+t_bool sim_aio_start (SIM_AIO *req);
+void sim_aio_cancel (SIM_AIO *req);
+void sim_aio_flush (void);
+void sim_aio_wake (SIM_AIO *req);
+void sim_aio_listen (t_bool flag);
+void sim_aio_poll (void);
+uint32 sim_aio_sleep (uint32 usec);
+t_stat sim_set_asynch (int32 flag, char *cptr);
+t_stat sim_show_asynch (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr);
+
+extern UNIT sim_aio_unit;
+
+#endif
@@ -23,6 +23,12 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added sim_hist.h
+                        Added UNIT.prof for event service profiling
+                        Added UNIT.mapbase, UNIT.maplnt for mapped files
+                        Added sim_aio.h
+                        Added DEVICE.svcbatch, UNIT.dptr for batched event dispatch
+                        Added UNIT.qidx for the heap-ordered event queue
    06-Jun-22    RMS     Deprecated UNIT_TEXT, deleted UNIT_RAW
    10-Mar-22    JDB     Modified REG macros to fix "stringizing" problem
    12-Nov-21    JDB     Added UNIT_EXTEND dynamic flag
@@ -334,6 +340,8 @@ struct sim_device {
     void                *attach_help;                   /* (4.0 dummy) help attach routine*/
     void                *help_context;                  /* (4.0 dummy) help context */
     void                *description;                   /* (4.0 dummy) description */
+    t_stat              (*svcbatch)(struct sim_device *dp, struct sim_unit **ulist,
+                            int32 cnt);                 /* batch service routine */
     };
 
 /* Device flags */
@@ -378,7 +386,7 @@ struct sim_device {
 */
 
 struct sim_unit {
-    struct sim_unit     *next;                          /* next active */
+    struct sim_unit     *next;                          /* (unused) */
     t_stat              (*action)(struct sim_unit *up); /* action routine */
     char                *filename;                      /* open file name */
     FILE                *fileref;                       /* file reference */
@@ -397,6 +405,11 @@ struct sim_unit {
     int32               u6;                             /* device specific */
     void                *up7;                           /* (4.0 dummy) */
     void                *up8;                           /* (4.0 dummy) */
+    int32               qidx;                           /* event queue index + 1, 0 if idle */
+    struct sim_device   *dptr;                          /* owning device */
+    void                *mapbase;                       /* mapped file base */
+    t_uint64            maplnt;                         /* mapped file length */
+    struct sim_prof     *prof;                          /* service profile */
     };
 
 /* Unit flags */
@@ -686,6 +699,8 @@ typedef struct sim_debtab DEBTAB;
 #include "sim_console.h"
 #include "sim_timer.h"
 #include "sim_fio.h"
+#include "sim_aio.h"
+#include "sim_hist.h"
 #include "sim_sock.h"
 
 /* V4 register definitions.
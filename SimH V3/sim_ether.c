@@ -170,6 +170,18 @@
 
   Modification history:
 
+  18-Oct-26  RMS  Added eth_write_batch, eth_read_batch, eth_read_batch_done;
+                  reader thread receives UDP frames with recvmmsg and drains
+                  TAP frames in batches; writer thread dequeues all pending
+                  requests at once
+                  Received frames are matched against a bitmap of the filter
+                  addresses before the address list is searched
+                  Replaced the locked read queue with a lock-free single
+                  producer, single consumer ring of preallocated slots;
+                  added eth_read_peek and eth_read_done to consume
+                  received packets in place
+                  Reader thread wakes the receive unit with sim_aio_wake
+                  rather than calling sim_activate from its own thread
   30-Mar-12  MP   Added host NIC address determination on supported VMS platforms
   01-Mar-12  MP   Made host NIC address determination on *nix platforms more 
                   robust.
@@ -958,6 +970,16 @@ t_stat eth_write (ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
   {return SCPE_NOFNC;}
 int eth_read (ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
   {return SCPE_NOFNC;}
+ETH_PACK* eth_read_peek (ETH_DEV* dev)
+  {return NULL;}
+void eth_read_done (ETH_DEV* dev)
+  {}
+int eth_read_batch (ETH_DEV* dev, ETH_PACK** packets, int max)
+  {return 0;}
+void eth_read_batch_done (ETH_DEV* dev, int count)
+  {}
+t_stat eth_write_batch (ETH_DEV* dev, ETH_PACK** packets, int count, ETH_PCALLBACK routine)
+  {return SCPE_NOFNC;}
 t_stat eth_filter (ETH_DEV* dev, int addr_count, ETH_MAC* const addresses,
                    ETH_BOOL all_multicast, ETH_BOOL promiscuous)
   {return SCPE_NOFNC;}
@@ -1931,6 +1953,124 @@ _eth_callback((u_char *)opaque, &header, buf);
 #endif
 
 #if defined (USE_READER_THREAD)
+/* Read ring.  The reader thread is the only producer and the simulator
+   thread the only consumer, so no lock is needed: the producer fills the
+   slot at tail and then advances tail, and the consumer uses the slot at
+   head in place and then advances head.  A full ring drops the newest
+   frame, as a controller out of buffers would. */
+
+#if defined (__GNUC__) && defined (__ATOMIC_ACQUIRE)
+#define ETH_LOAD_ACQ(p)     __atomic_load_n (p, __ATOMIC_ACQUIRE)
+#define ETH_STORE_REL(p,v)  __atomic_store_n (p, v, __ATOMIC_RELEASE)
+#else
+#if defined (__GNUC__)
+#define ETH_MB()            __sync_synchronize ()
+#elif defined (_WIN32)
+#define ETH_MB()            MemoryBarrier ()
+#else                                   /* lock and unlock order memory */
+static pthread_mutex_t _eth_mb_lock = PTHREAD_MUTEX_INITIALIZER;
+#define ETH_MB()            (pthread_mutex_lock (&_eth_mb_lock), \
+                             pthread_mutex_unlock (&_eth_mb_lock))
+#endif
+#define ETH_LOAD_ACQ(p)     _eth_load_acq (p)
+#define ETH_STORE_REL(p,v)  do { ETH_MB (); *(p) = (v); } while (0)
+
+static uint32 _eth_load_acq (volatile uint32 *p)
+{
+  uint32 v = *p;
+
+  ETH_MB ();
+  return v;
+}
+#endif
+
+static t_stat _eth_ring_init (ETH_RING* ring, uint32 slots)
+{
+  ring->item = (struct eth_item *) calloc(slots, sizeof(struct eth_item));
+  if (!ring->item) {
+    sim_printf("EthQ: failed to allocate read ring[%d]\n", slots);
+    return SCPE_MEM;
+    }
+  ring->mask = slots - 1;
+  ring->head = ring->tail = 0;
+  ring->loss = ring->high = 0;
+  return SCPE_OK;
+}
+
+static void _eth_ring_destroy (ETH_RING* ring)
+{
+  uint32 i;
+
+  if (ring->item) {
+    for (i=0; i<=ring->mask; ++i)
+      free (ring->item[i].packet.oversize);
+    free (ring->item);
+    ring->item = NULL;
+    }
+  ring->mask = ring->head = ring->tail = 0;
+}
+
+/* Producer: copy a received frame into the next free slot */
+
+static void _eth_ring_put (ETH_RING* ring, const uint8 *data, size_t len, size_t crc_len, const uint8 *crc_data)
+{
+  uint32 tail = ring->tail;
+  uint32 count = tail - ETH_LOAD_ACQ (&ring->head);
+  size_t size = (len > crc_len) ? len : crc_len;
+  struct eth_item* item;
+  uint8 *msg;
+
+  if (count > ring->mask) {                 /* full? */
+    ring->loss++;
+    return;
+    }
+  item = &ring->item[tail & ring->mask];
+  item->type = ETH_ITM_NORMAL;
+  item->packet.len = len;
+  item->packet.used = 0;
+  item->packet.crc_len = crc_len;
+  item->packet.status = 0;
+  if (size <= sizeof (item->packet.msg)) {
+    if (item->packet.oversize) {            /* slot held a giant? */
+      free (item->packet.oversize);
+      item->packet.oversize = NULL;
+      }
+    msg = item->packet.msg;
+    }
+  else {
+    msg = (uint8 *)realloc (item->packet.oversize, size);
+    if (!msg) {
+      ring->loss++;
+      return;
+      }
+    item->packet.oversize = msg;
+    }
+  memcpy(msg, data, size);
+  if (crc_data && (crc_len > len))
+    memcpy(&msg[len], crc_data, ETH_CRC_SIZE);
+  ETH_STORE_REL (&ring->tail, tail + 1);    /* slot, then tail */
+  if (count + 1 > ring->high)
+    ring->high = count + 1;
+}
+
+/* Is more input waiting on fd?  Used to drain a burst of frames per wakeup */
+
+static int _eth_more_input (SOCKET fd)
+{
+fd_set setl;
+struct timeval timeout;
+
+FD_ZERO(&setl);
+FD_SET(fd, &setl);
+timeout.tv_sec = 0;
+timeout.tv_usec = 0;
+return (select(1+fd, &setl, NULL, NULL, &timeout) > 0);
+}
+
+#if defined (__linux__) && defined (MSG_WAITFORONE)
+#define ETH_HAVE_MMSG 1                     /* recvmmsg available */
+#endif
+
 static void *
 _eth_reader(void *arg)
 {
@@ -1939,6 +2079,12 @@ int status = 0;
 int sel_ret = 0;
 int do_select = 0;
 SOCKET select_fd = 0;
+#if defined (ETH_HAVE_MMSG)
+struct mmsghdr rx_msgs[ETH_BATCH_MAX];
+struct iovec rx_iov[ETH_BATCH_MAX];
+u_char *rx_buf = NULL;
+int i;
+#endif
 #if defined (_WIN32)
 HANDLE hWait = (dev->eth_api == ETH_API_PCAP) ? pcap_getevent ((pcap_t*)dev->handle) : NULL;
 #endif
@@ -1961,6 +2107,19 @@ switch (dev->eth_api) {
     break;
   }
 
+#if defined (ETH_HAVE_MMSG)
+if (dev->eth_api == ETH_API_UDP) {          /* UDP? batch receive buffers */
+  rx_buf = (u_char *)malloc (ETH_BATCH_MAX * ETH_MAX_JUMBO_FRAME);
+  memset (rx_msgs, 0, sizeof (rx_msgs));
+  for (i = 0; (rx_buf != NULL) && (i < ETH_BATCH_MAX); i++) {
+    rx_iov[i].iov_base = rx_buf + (i * ETH_MAX_JUMBO_FRAME);
+    rx_iov[i].iov_len = ETH_MAX_JUMBO_FRAME;
+    rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+    rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+#endif
+
 sim_debug(dev->dbit, dev->dptr, "Reader Thread Starting\n");
 
 /* Boost Priority for this I/O thread vs the CPU instruction execution 
@@ -2014,22 +2173,25 @@ while (dev->handle) {
       case ETH_API_TAP:
         if (1) {
           struct pcap_pkthdr header;
-          int len;
+          int len, count = 0;
           u_char buf[ETH_MAX_JUMBO_FRAME];
 
           memset(&header, 0, sizeof(header));
-          len = read(dev->fd_handle, buf, sizeof(buf));
-          if (len > 0) {
-            status = 1;
-            header.caplen = header.len = len;
-            _eth_callback((u_char *)dev, &header, buf);
-            }
-          else {
-            if (len < 0)
-              status = -1;
-            else
-              status = 0;
-            }
+          do {                              /* drain up to a batch */
+            len = read(dev->fd_handle, buf, sizeof(buf));
+            if (len > 0) {
+              status = 1;
+              header.caplen = header.len = len;
+              _eth_callback((u_char *)dev, &header, buf);
+              }
+            else {
+              if (len < 0)
+                status = -1;
+              else
+                status = 0;
+              }
+            } while ((status > 0) && (++count < ETH_BATCH_MAX) &&
+                     _eth_more_input (dev->fd_handle));
           }
         break;
 #endif /* HAVE_TAP_NETWORK */
@@ -2063,6 +2225,30 @@ while (dev->handle) {
         break;
 #endif /* HAVE_SLIRP_NETWORK */
       case ETH_API_UDP:
+#if defined (ETH_HAVE_MMSG)
+        if (rx_buf != NULL) {               /* batch receive */
+          struct pcap_pkthdr header;
+          int n;
+
+          memset(&header, 0, sizeof(header));
+          n = recvmmsg (select_fd, rx_msgs, ETH_BATCH_MAX, MSG_DONTWAIT, NULL);
+          if (n > 0) {
+            status = 1;
+            for (i = 0; i < n; i++) {
+              header.caplen = header.len = rx_msgs[i].msg_len;
+              if (header.len > 0)
+                _eth_callback((u_char *)dev, &header, (u_char *)rx_iov[i].iov_base);
+              }
+            }
+          else {
+            if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+              status = -1;
+            else
+              status = 0;
+            }
+          break;
+          }
+#endif
         if (1) {
           struct pcap_pkthdr header;
           int len;
@@ -2087,12 +2273,10 @@ while (dev->handle) {
     if ((status > 0) && (dev->asynch_io)) {
       int wakeup_needed;
 
-      pthread_mutex_lock (&dev->lock);
-      wakeup_needed = (dev->read_queue.count != 0);
-      pthread_mutex_unlock (&dev->lock);
+      wakeup_needed = (ETH_LOAD_ACQ (&dev->read_queue.head) != dev->read_queue.tail);
       if (wakeup_needed) {
         sim_debug(dev->dbit, dev->dptr, "Queueing automatic poll\n");
-        sim_activate_abs (dev->dptr->units, dev->asynch_io_latency);
+        sim_aio_wake (&dev->wake);
         }
       }
     if (status < 0) {
@@ -2114,6 +2298,9 @@ while (dev->handle) {
     }
   }
 
+#if defined (ETH_HAVE_MMSG)
+free (rx_buf);
+#endif
 sim_debug(dev->dbit, dev->dptr, "Reader Thread Exiting\n");
 return NULL;
 }
@@ -2135,27 +2322,33 @@ pthread_mutex_lock (&dev->writer_lock);
 while (dev->handle) {
   pthread_cond_wait (&dev->writer_cond, &dev->writer_lock);
   while (NULL != (request = dev->write_requests)) {
+    ETH_WRITE_REQUEST *last;
+
     if (dev->handle == NULL)      /* Shutting down? */
       break;
-    /* Pull buffer off request list */
-    dev->write_requests = request->next;
+    /* Pull all pending buffers off request list */
+    dev->write_requests = NULL;
     pthread_mutex_unlock (&dev->writer_lock);
 
-    if (dev->throttle_delay != ETH_THROT_DISABLED_DELAY) {
-      uint32 packet_delta_time = sim_os_msec() - dev->throttle_packet_time;
-      dev->throttle_events <<= 1;
-      dev->throttle_events += (packet_delta_time < dev->throttle_time) ? 1 : 0;
-      if ((dev->throttle_events & dev->throttle_mask) == dev->throttle_mask) {
-        sim_os_ms_sleep (dev->throttle_delay);
-        ++dev->throttle_count;
+    for (last = request; ; last = last->next) {
+      if (dev->throttle_delay != ETH_THROT_DISABLED_DELAY) {
+        uint32 packet_delta_time = sim_os_msec() - dev->throttle_packet_time;
+        dev->throttle_events <<= 1;
+        dev->throttle_events += (packet_delta_time < dev->throttle_time) ? 1 : 0;
+        if ((dev->throttle_events & dev->throttle_mask) == dev->throttle_mask) {
+          sim_os_ms_sleep (dev->throttle_delay);
+          ++dev->throttle_count;
+          }
+        dev->throttle_packet_time = sim_os_msec();
         }
-      dev->throttle_packet_time = sim_os_msec();
+      dev->write_status = _eth_write(dev, &last->packet, NULL);
+      if (last->next == NULL)
+        break;
       }
-    dev->write_status = _eth_write(dev, &request->packet, NULL);
 
     pthread_mutex_lock (&dev->writer_lock);
-    /* Put buffer on free buffer list */
-    request->next = dev->write_buffers;
+    /* Put buffers on free buffer list */
+    last->next = dev->write_buffers;
     dev->write_buffers = request;
     request = NULL;
     }
@@ -2182,11 +2375,14 @@ return sim_messagef (SCPE_NOFNC, "%s", msg);
 #else
 int wakeup_needed;
 
+if (!dev->asynch_io)                        /* first time? register wakeups */
+  sim_aio_listen (TRUE);
+dev->wake.uptr = dev->dptr->units;          /* receive unit */
+dev->wake.op = AIO_WAKE;
+dev->wake.delay = latency;
 dev->asynch_io = 1;
 dev->asynch_io_latency = latency;
-pthread_mutex_lock (&dev->lock);
-wakeup_needed = (dev->read_queue.count != 0);
-pthread_mutex_unlock (&dev->lock);
+wakeup_needed = (dev->read_queue.head != ETH_LOAD_ACQ (&dev->read_queue.tail));
 if (wakeup_needed) {
   sim_debug(dev->dbit, dev->dptr, "Queueing automatic poll\n");
   sim_activate_abs (dev->dptr->units, dev->asynch_io_latency);
@@ -2203,7 +2399,11 @@ return SCPE_NOFNC;
 /* make sure device exists */
 if (!dev) return SCPE_UNATT;
 
-dev->asynch_io = 0;
+if (dev->asynch_io) {
+  dev->asynch_io = 0;
+  sim_aio_cancel (&dev->wake);              /* discard pending wakeup */
+  sim_aio_listen (FALSE);
+  }
 return SCPE_OK;
 #endif
 }
@@ -2581,7 +2781,7 @@ dev->dbit = dbit;
 if (1) {
   pthread_attr_t attr;
 
-  ethq_init (&dev->read_queue, 200);         /* initialize FIFO queue */
+  _eth_ring_init (&dev->read_queue, ETH_RING_SLOTS); /* allocate read ring */
   pthread_mutex_init (&dev->lock, NULL);
   pthread_mutex_init (&dev->writer_lock, NULL);
   pthread_mutex_init (&dev->self_lock, NULL);
@@ -2659,6 +2859,9 @@ dev->have_host_nic_phy_addr = 0;
 
 #if defined (USE_READER_THREAD)
 pthread_join (dev->reader_thread, NULL);
+#if defined (SIM_ASYNCH_IO)
+eth_clr_async (dev);                        /* no more wakeups */
+#endif
 pthread_mutex_destroy (&dev->lock);
 pthread_cond_signal (&dev->writer_cond);
 pthread_join (dev->writer_thread, NULL);
@@ -2676,7 +2879,7 @@ if (1) {
     free(buffer);
     }
   }
-ethq_destroy (&dev->read_queue);         /* release FIFO queue */
+_eth_ring_destroy (&dev->read_queue);    /* release read ring */
 #endif
 
 _eth_close_port (dev->eth_api, pcap, pcap_fd);
@@ -3110,48 +3313,94 @@ return ((status == 0) ? SCPE_OK : SCPE_IOERR);
 t_stat eth_write(ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
 {
 #ifdef USE_READER_THREAD
-ETH_WRITE_REQUEST *request;
-int write_queue_size = 1;
+return eth_write_batch(dev, &packet, 1, routine);
+#else
+return _eth_write(dev, packet, routine);
+#endif
+}
+
+/* Write count packets, in order, with one handoff to the writer thread.
+   Either all of the packets are queued, or none are and SCPE_MEM is
+   returned. */
+
+t_stat eth_write_batch(ETH_DEV* dev, ETH_PACK** packets, int count, ETH_PCALLBACK routine)
+{
+#ifdef USE_READER_THREAD
+ETH_WRITE_REQUEST *request, *first = NULL, *last = NULL;
+int write_queue_size = 0;
+int i;
 
 /* make sure device exists */
 if ((!dev) || (dev->eth_api == ETH_API_NONE)) return SCPE_UNATT;
+if (count <= 0) return SCPE_OK;
 
-/* Get a buffer */
+/* Get buffers */
 pthread_mutex_lock (&dev->writer_lock);
-if (NULL != (request = dev->write_buffers))
+for (i = 0; i < count; i++) {
+  if (NULL == (request = dev->write_buffers))
+    break;
   dev->write_buffers = request->next;
+  request->next = first;
+  first = request;
+  }
 pthread_mutex_unlock (&dev->writer_lock);
-if (NULL == request)
+for ( ; i < count; i++) {
   request = (ETH_WRITE_REQUEST *)malloc(sizeof(*request));
+  if (NULL == request)
+    break;
+  request->next = first;
+  first = request;
+  }
+if (i < count) {
+  /* Out of memory: send none of the batch rather than silently drop */
+  /* its tail, and keep the buffers for later writes */
+  pthread_mutex_lock (&dev->writer_lock);
+  while (first) {
+    request = first->next;
+    first->next = dev->write_buffers;
+    dev->write_buffers = first;
+    first = request;
+    }
+  pthread_mutex_unlock (&dev->writer_lock);
+  if (routine)
+    (routine)(SCPE_MEM);
+  return SCPE_MEM;
+  }
 
 /* Copy buffer contents */
-request->packet.len = packet->len;
-request->packet.used = packet->used;
-request->packet.status = packet->status;
-request->packet.crc_len = packet->crc_len;
-memcpy(request->packet.msg, packet->msg, packet->len);
+for (i = 0, request = first; i < count; i++, request = request->next) {
+  request->packet.len = packets[i]->len;
+  request->packet.used = packets[i]->used;
+  request->packet.status = packets[i]->status;
+  request->packet.crc_len = packets[i]->crc_len;
+  memcpy(request->packet.msg, packets[i]->msg, packets[i]->len);
+  last = request;
+  }
 
-/* Insert buffer at the end of the write list (to make sure that */
+/* Insert buffers at the end of the write list (to make sure that */
 /* packets make it to the wire in the order they were presented here) */
 pthread_mutex_lock (&dev->writer_lock);
-request->next = NULL;
-if (dev->write_requests) {
-  ETH_WRITE_REQUEST *last_request = dev->write_requests;
+if (last) {
+  last->next = NULL;
+  write_queue_size = count;
+  if (dev->write_requests) {
+    ETH_WRITE_REQUEST *last_request = dev->write_requests;
 
-  ++write_queue_size;
-  while (last_request->next) {
-    last_request = last_request->next;
     ++write_queue_size;
+    while (last_request->next) {
+      last_request = last_request->next;
+      ++write_queue_size;
+      }
+    last_request->next = first;
     }
-  last_request->next = request;
+  else
+      dev->write_requests = first;
   }
-else
-    dev->write_requests = request;
 if (write_queue_size > dev->write_queue_peak)
   dev->write_queue_peak = write_queue_size;
 pthread_mutex_unlock (&dev->writer_lock);
 
-/* Awaken writer thread to perform actual write */
+/* Awaken writer thread to perform actual writes */
 pthread_cond_signal (&dev->writer_cond);
 
 /* Return with a status from some prior write */
@@ -3159,10 +3408,27 @@ if (routine)
   (routine)(dev->write_status);
 return dev->write_status;
 #else
-return _eth_write(dev, packet, routine);
+t_stat r, status = SCPE_OK;
+int i;
+
+for (i = 0; i < count; i++) {
+  r = _eth_write(dev, packets[i], routine);
+  if (r != SCPE_OK)
+    status = r;
+  }
+return status;
 #endif
 }
 
+/* Filter address bitmap.  Each filter address sets the bit selected by the
+   exclusive OR of its six bytes; a received frame whose destination bit is
+   clear cannot match any filter address and is discarded without searching
+   the address list. */
+
+#define ETH_MAC_FOLD(m)         ((m)[0] ^ (m)[1] ^ (m)[2] ^ (m)[3] ^ (m)[4] ^ (m)[5])
+#define ETH_FILTER_SET(map,m)   map[ETH_MAC_FOLD (m) >> 5] |= (1u << (ETH_MAC_FOLD (m) & 0x1F))
+#define ETH_FILTER_TEST(map,m)  (map[ETH_MAC_FOLD (m) >> 5] & (1u << (ETH_MAC_FOLD (m) & 0x1F)))
+
 static int
 _eth_hash_lookup(ETH_MULTIHASH hash, const u_char* data)
 {
@@ -3698,23 +3964,34 @@ switch (dev->eth_api) {
   case ETH_API_UDP:
   case ETH_API_NAT:
     bpf_used = 0;
-    to_me = 0;
     eth_packet_trace (dev, data, header->len, "received");
 
-    for (i = 0; i < dev->addr_count; i++) {
-      if (memcmp(data, dev->filter_address[i], 6) == 0) to_me = 1;
-      if (memcmp(&data[6], dev->filter_address[i], 6) == 0) from_me = 1;
-    }
-
-    /* all multicast mode? */
-    if (dev->all_multicast && (data[0] & 0x01)) to_me = 1;
+    /* promiscuous or all multicast mode? */
+    to_me = (dev->promiscuous || (dev->all_multicast && (data[0] & 0x01)));
 
-    /* promiscuous mode? */
-    if (dev->promiscuous) to_me = 1;
+    /* destination in bitmap? confirm against filter addresses */
+    if ((!to_me) && ETH_FILTER_TEST (dev->filter_map, data)) {
+      for (i = 0; i < dev->addr_count; i++)
+        if (memcmp(data, dev->filter_address[i], 6) == 0) {
+          to_me = 1;
+          break;
+          }
+      }
 
     /* AUTODIN II hash mode? */
     if ((dev->hash_filter) && (!to_me) && (data[0] & 0x01))
       to_me = _eth_hash_lookup(dev->hash, data);
+
+    /* sent from one of our addresses? (matters only if wanted) */
+    if (to_me && ETH_FILTER_TEST (dev->filter_map, &data[6])) {
+      for (i = 0; i < dev->addr_count; i++)
+        if (memcmp(&data[6], dev->filter_address[i], 6) == 0) {
+          from_me = 1;
+          break;
+          }
+      }
+    if (!to_me)
+      ++dev->packets_filtered;
     break;
   default:
     bpf_used = to_me = 0;                           /* Should NEVER happen */
@@ -3782,10 +4059,8 @@ if (bpf_used ? to_me : (to_me && !from_me)) {
 
     eth_packet_trace (dev, data, len, "rcvqd");
 
-    pthread_mutex_lock (&dev->lock);
-    ethq_insert_data(&dev->read_queue, ETH_ITM_NORMAL, data, 0, len, crc_len, crc_data, 0);
+    _eth_ring_put(&dev->read_queue, data, len, crc_len, crc_data);
     ++dev->packets_received;
-    pthread_mutex_unlock (&dev->lock);
     free(moved_data);
     }
 #else /* !USE_READER_THREAD */
@@ -3924,16 +4199,17 @@ if (status < 0) {
 #else /* USE_READER_THREAD */
 
   status = 0;
-  pthread_mutex_lock (&dev->lock);
-  if (dev->read_queue.count > 0) {
-    ETH_ITEM* item = &dev->read_queue.item[dev->read_queue.head];
-    packet->len = item->packet.len;
-    packet->crc_len = item->packet.crc_len;
-    memcpy(packet->msg, item->packet.msg, ((packet->len > packet->crc_len) ? packet->len : packet->crc_len));
-    status = 1;
-    ethq_remove(&dev->read_queue);
-  }
-  pthread_mutex_unlock (&dev->lock);  
+  if (1) {
+    ETH_PACK* item = eth_read_peek (dev);
+
+    if (item) {
+      packet->len = item->len;
+      packet->crc_len = item->crc_len;
+      memcpy(packet->msg, item->msg, ((packet->len > packet->crc_len) ? packet->len : packet->crc_len));
+      status = 1;
+      eth_read_done (dev);
+      }
+    }
   if ((status) && (routine))
     routine(0);
 #endif
@@ -3941,6 +4217,86 @@ if (status < 0) {
 return status;
 }
 
+/* Return the next received packet without copying it, or NULL if none.
+   The packet stays valid until eth_read_done. */
+
+ETH_PACK* eth_read_peek (ETH_DEV* dev)
+{
+#if defined (USE_READER_THREAD)
+ETH_RING* ring;
+uint32 head;
+
+if ((!dev) || (dev->eth_api == ETH_API_NONE))
+  return NULL;
+ring = &dev->read_queue;
+head = ring->head;
+if (head == ETH_LOAD_ACQ (&ring->tail))     /* empty? tail, then slot */
+  return NULL;
+return &ring->item[head & ring->mask].packet;
+#else
+if (eth_read (dev, &dev->read_peek, NULL))
+  return &dev->read_peek;
+return NULL;
+#endif
+}
+
+/* Return up to max received packets without copying them.  The packets
+   stay valid until eth_read_batch_done. */
+
+int eth_read_batch (ETH_DEV* dev, ETH_PACK** packets, int max)
+{
+#if defined (USE_READER_THREAD)
+ETH_RING* ring;
+uint32 head, count;
+int i;
+
+if ((!dev) || (dev->eth_api == ETH_API_NONE))
+  return 0;
+ring = &dev->read_queue;
+head = ring->head;
+count = ETH_LOAD_ACQ (&ring->tail) - head;  /* tail, then slots */
+if (count > (uint32)max)
+  count = max;
+for (i = 0; i < (int)count; i++)
+  packets[i] = &ring->item[(head + i) & ring->mask].packet;
+return count;
+#else
+if (max <= 0)
+  return 0;
+packets[0] = eth_read_peek (dev);
+return (packets[0] != NULL);
+#endif
+}
+
+/* Release count packets returned by eth_read_batch */
+
+void eth_read_batch_done (ETH_DEV* dev, int count)
+{
+#if defined (USE_READER_THREAD)
+ETH_RING* ring;
+
+if ((!dev) || (count <= 0))
+  return;
+ring = &dev->read_queue;
+ETH_STORE_REL (&ring->head, ring->head + count); /* slots, then head */
+#endif
+}
+
+/* Release the packet returned by eth_read_peek */
+
+void eth_read_done (ETH_DEV* dev)
+{
+#if defined (USE_READER_THREAD)
+ETH_RING* ring;
+
+if (!dev)
+  return;
+ring = &dev->read_queue;
+if (ring->head != ETH_LOAD_ACQ (&ring->tail))
+  ETH_STORE_REL (&ring->head, ring->head + 1); /* slot, then head */
+#endif
+}
+
 t_stat eth_bpf_filter (ETH_DEV* dev, int addr_count, ETH_MAC* const filter_address,
                        ETH_BOOL all_multicast, ETH_BOOL promiscuous, 
                        int reflections,
@@ -4086,6 +4442,9 @@ if (match_broadcast) {
   ++addr_count;
   }
 dev->addr_count = addr_count;
+memset(dev->filter_map, 0, sizeof(dev->filter_map));
+for (i = 0; i < addr_count; i++)
+  ETH_FILTER_SET (dev->filter_map, dev->filter_address[i]);
 
 /* store other flags */
 dev->all_multicast = all_multicast;
@@ -4199,9 +4558,8 @@ if (dev->eth_api == ETH_API_PCAP) {
     pcap_freecode(&bpf);
     }
 #ifdef USE_READER_THREAD
-  pthread_mutex_lock (&dev->lock);
-  ethq_clear (&dev->read_queue); /* Empty FIFO Queue when filter list changes */
-  pthread_mutex_unlock (&dev->lock);
+  /* Empty read ring when filter list changes */
+  ETH_STORE_REL (&dev->read_queue.head, ETH_LOAD_ACQ (&dev->read_queue.tail));
 #endif
   }
 #endif /* USE_BPF */
@@ -4238,6 +4596,8 @@ if (dev->transmit_packet_errors)
   fprintf(st, "  Send Packet Errors:      %d\n", dev->transmit_packet_errors);
 if (dev->packets_received)
   fprintf(st, "  Packets Received:        %d\n", dev->packets_received);
+if (dev->packets_filtered)
+  fprintf(st, "  Packets Filtered:        %d\n", dev->packets_filtered);
 if (dev->receive_packet_errors)
   fprintf(st, "  Read Packet Errors:      %d\n", dev->receive_packet_errors);
 if (dev->error_reopen_count)
@@ -4250,9 +4610,9 @@ if (dev->asynch_io)
   fprintf(st, "  Interrupt Latency:       %d uSec\n", dev->asynch_io_latency);
 if (dev->throttle_count)
   fprintf(st, "  Throttle Delays:         %d\n", dev->throttle_count);
-fprintf(st, "  Read Queue: Count:       %d\n", dev->read_queue.count);
-fprintf(st, "  Read Queue: High:        %d\n", dev->read_queue.high);
-fprintf(st, "  Read Queue: Loss:        %d\n", dev->read_queue.loss);
+fprintf(st, "  Read Queue: Count:       %d\n", (int)(dev->read_queue.tail - dev->read_queue.head));
+fprintf(st, "  Read Queue: High:        %d\n", (int)dev->read_queue.high);
+fprintf(st, "  Read Queue: Loss:        %d\n", (int)dev->read_queue.loss);
 fprintf(st, "  Peak Write Queue Size:   %d\n", dev->write_queue_peak);
 #endif
 if (dev->error_needs_reset)
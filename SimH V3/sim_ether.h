@@ -28,6 +28,10 @@
 
   Modification history:
 
+  18-Oct-26  RMS  Added receive wakeup request
+                  Added lock-free read ring, eth_read_peek, eth_read_done
+                  Added batched reads and writes
+                  Added destination filter bitmap, packets_filtered
   01-Mar-12  AGN  Cygwin doesn't have non-blocking pcap I/O pcap (it uses WinPcap)
   17-Nov-11  MP   Added dynamic loading of libpcap on *nix platforms
   30-Oct-11  MP   Added support for vde (Virtual Distributed Ethernet) networking
@@ -166,6 +170,8 @@ extern "C" {
 #define ETH_MAX_DEVICE        20                        /* maximum ethernet devices */
 #define ETH_CRC_SIZE           4                        /* ethernet CRC size */
 #define ETH_FRAME_SIZE (ETH_MAX_PACKET+ETH_CRC_SIZE)    /* ethernet maximum frame size */
+#define ETH_BATCH_MAX  8                                /* max frames per batched host read */
+#define ETH_RING_SLOTS 1024                             /* read ring slots, a power of 2 */
 #define ETH_MIN_JUMBO_FRAME ETH_MAX_PACKET              /* Threshold size for Jumbo Frame Processing */
 
 #define LOOPBACK_SELF_FRAME(phy_mac, msg)                                                     \
@@ -232,6 +238,15 @@ struct eth_queue {
   struct eth_item*    item;
 };
 
+struct eth_ring {                                       /* single producer, single consumer */
+  uint32              mask;                             /* slots - 1, slots a power of 2 */
+  volatile uint32     head;                             /* next slot to consume (consumer) */
+  volatile uint32     tail;                             /* next slot to fill (producer) */
+  uint32              loss;                             /* frames dropped, ring full */
+  uint32              high;                             /* high water mark */
+  struct eth_item*    item;                             /* preallocated slots */
+};
+
 typedef unsigned char ETH_MAC[6];
 
 struct eth_list {
@@ -247,6 +262,7 @@ typedef void (*ETH_PCALLBACK)(int status);
 typedef struct eth_list ETH_LIST;
 typedef struct eth_queue ETH_QUE;
 typedef struct eth_item ETH_ITEM;
+typedef struct eth_ring ETH_RING;
 struct eth_write_request {
   struct eth_write_request *next;
   ETH_PACK packet;
@@ -274,6 +290,7 @@ struct eth_device {
   ETH_BOOL      all_multicast;                          /* receive all multicast messages */
   ETH_BOOL      hash_filter;                            /* filter using AUTODIN II multicast hash */
   ETH_MULTIHASH hash;                                   /* AUTODIN II multicast hash */
+  uint32        filter_map[8];                          /* filter address bitmap, by folded MAC */
   int32         loopback_self_sent;                     /* loopback packets sent but not seen */
   int32         loopback_self_sent_total;               /* total loopback packets sent */
   int32         loopback_self_rcvd_total;               /* total loopback packets seen */
@@ -285,6 +302,7 @@ struct eth_device {
   uint32        jumbo_truncated;                        /* Giant Frames too big for capture buffer - Dropped */
   uint32        packets_sent;                           /* Total Packets Sent */
   uint32        packets_received;                       /* Total Packets Received */
+  uint32        packets_filtered;                       /* Total Packets Discarded by Address Filter */
   uint32        loopback_packets_processed;             /* Total Loopback Packets Processed */
   uint32        transmit_packet_errors;                 /* Total Send Packet Errors */
   uint32        receive_packet_errors;                  /* Total Read Packet Errors */
@@ -313,7 +331,8 @@ struct eth_device {
 #if defined (USE_READER_THREAD)
   int           asynch_io;                              /* Asynchronous Interrupt scheduling enabled */
   int           asynch_io_latency;                      /* instructions to delay pending interrupt */
-  ETH_QUE       read_queue;
+  SIM_AIO       wake;                                   /* receive unit wakeup */
+  ETH_RING      read_queue;                             /* reader thread to device */
   pthread_mutex_t     lock;
   pthread_t     reader_thread;                          /* Reader Thread Id */
   pthread_t     writer_thread;                          /* Writer Thread Id */
@@ -324,6 +343,8 @@ struct eth_device {
   int write_queue_peak;
   ETH_WRITE_REQUEST *write_buffers;
   t_stat write_status;
+#else
+  ETH_PACK      read_peek;                              /* eth_read_peek packet */
 #endif
 };
 
@@ -339,6 +360,13 @@ t_stat eth_write  (ETH_DEV* dev, ETH_PACK* packet,      /* write sychronous pack
                    ETH_PCALLBACK routine);              /*  callback when done */
 int eth_read      (ETH_DEV* dev, ETH_PACK* packet,      /* read single packet; */
                    ETH_PCALLBACK routine);              /*  callback when done*/
+ETH_PACK* eth_read_peek (ETH_DEV* dev);                 /* next received packet, in place */
+void eth_read_done (ETH_DEV* dev);                      /* release packet from eth_read_peek */
+int eth_read_batch (ETH_DEV* dev, ETH_PACK** packets,  /* up to max received packets, in place */
+                    int max);
+void eth_read_batch_done (ETH_DEV* dev, int count);     /* release packets from eth_read_batch */
+t_stat eth_write_batch (ETH_DEV* dev, ETH_PACK** packets, /* write count packets in order */
+                        int count, ETH_PCALLBACK routine);
 t_stat eth_filter (ETH_DEV* dev, int addr_count,        /* set filter on incoming packets */
                    ETH_MAC* const addresses,
                    ETH_BOOL all_multicast,
@@ -23,6 +23,11 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Used SIM_TLS for the per thread flip buffer
+                        Added sim_mem_alloc, sim_mem_free
+                        Added size specific byte swap routines
+                        Added sim_fmap, sim_funmap, sim_fmap_ptr
+                        Made sim_fwrite flip buffer per thread for asynch I/O
    28-Dec-18    JDB     Modify sim_fseeko, sim_ftell for mingwrt 5.2 compatibility
    02-Apr-15    RMS     Backported from GitHub master
    28-Jun-07    RMS     Added VMS IA64 support (from Norm Lastovica)
@@ -48,13 +53,26 @@
    sim_fsize_name       (now a macro using sim_fsize_ex)
    sim_fsize_ex         get file size as a t_offset
    sim_fsize_name       get file size as a t_offset of named file
-
-   sim_fopen, sim_fseeko, sim_ftell are OS-dependent. The other routines are not.
+   sim_buf_swap_data    swap data items end for end, in place
+   sim_buf_copy_swapped copy data items, swapping end for end
+   sim_fmap             map an attached file into host memory
+   sim_funmap           unmap an attached file
+   sim_fmap_ptr         get host address of a range of a mapped file
+   sim_mem_alloc        allocate zeroed simulated memory
+   sim_mem_free         free simulated memory
+
+   sim_fopen, sim_fseeko, sim_ftell, sim_fmap, sim_funmap, sim_mem_alloc,
+   and sim_mem_free are OS-dependent.
+   The other routines are not.
 */
 
 #include "sim_defs.h"
 
+#if defined (SIM_TLS)
+static SIM_TLS unsigned char sim_flip[FLIP_SIZE];       /* per thread */
+#else
 static unsigned char sim_flip[FLIP_SIZE];
+#endif
 t_bool sim_end;                     /* TRUE = little endian, FALSE = big endian */
 t_bool sim_taddr_64;                /* t_addr is > 32b and large file support available */
 t_bool sim_toffset_64;              /* large file (>2GB) support available */
@@ -74,6 +92,8 @@ t_bool sim_toffset_64;              /* large file (>2GB) support available */
    are size char, then the calls are passed directly to fread or
    fwrite.  Otherwise, these routines perform the necessary byte swaps.
    Sim_fread swaps in place, sim_fwrite uses an intermediate buffer.
+   Callers that can tolerate their data being swapped may instead call
+   sim_buf_swap_data themselves and write with fwrite, avoiding the copy.
 */
 
 int32 sim_finit (void)
@@ -87,33 +107,113 @@ sim_taddr_64 = sim_toffset_64 && (sizeof(t_addr) > sizeof(int32));
 return sim_end;
 }
 
-size_t sim_fread (void *bptr, size_t size, size_t count, FILE *fptr)
+/* Byte swap routines
+
+   The 2, 4, and 8 byte cases, which are nearly all the traffic, use the
+   compiler's byte swap primitives where available; compilers turn these
+   into single instructions and will vectorize the loops.  Items are moved
+   with memcpy, so the buffers need not be aligned.  Other sizes are
+   swapped a byte at a time.
+*/
+
+#if defined (__clang__) || \
+    (defined (__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 8))))
+#define SWAP16(x)       __builtin_bswap16 (x)
+#define SWAP32(x)       __builtin_bswap32 (x)
+#define SWAP64(x)       __builtin_bswap64 (x)
+#elif defined (_MSC_VER)
+#define SWAP16(x)       _byteswap_ushort (x)
+#define SWAP32(x)       _byteswap_ulong (x)
+#define SWAP64(x)       _byteswap_uint64 (x)
+#else
+#define SWAP16(x)       ((uint16) ((((x) >> 8) & 0xFF) | (((x) & 0xFF) << 8)))
+#define SWAP32(x)       ((((x) >> 24) & 0xFF) | (((x) >> 8) & 0xFF00) | \
+                         (((x) & 0xFF00) << 8) | (((x) & 0xFF) << 24))
+#define SWAP64(x)       ((((t_uint64) SWAP32 ((uint32) (x))) << 32) | \
+                         SWAP32 ((uint32) ((x) >> 32)))
+#endif
+
+void sim_buf_copy_swapped (void *dbuf, const void *sbuf, size_t size, size_t count)
 {
-size_t c, j;
+size_t j;
 int32 k;
-unsigned char by, *sptr, *dptr;
+const unsigned char *sptr = (const unsigned char *) sbuf;
+unsigned char *dptr = (unsigned char *) dbuf;
+unsigned char by;
+uint16 w16;
+uint32 w32;
+t_uint64 w64;
+
+switch (size) {
+
+    case 1:
+        if (dptr != sptr)
+            memmove (dptr, sptr, count);
+        break;
+
+    case 2:
+        for (j = 0; j < count; j++, sptr += 2, dptr += 2) {
+            memcpy (&w16, sptr, 2);
+            w16 = SWAP16 (w16);
+            memcpy (dptr, &w16, 2);
+            }
+        break;
+
+    case 4:
+        for (j = 0; j < count; j++, sptr += 4, dptr += 4) {
+            memcpy (&w32, sptr, 4);
+            w32 = SWAP32 (w32);
+            memcpy (dptr, &w32, 4);
+            }
+        break;
+
+    case 8:
+        for (j = 0; j < count; j++, sptr += 8, dptr += 8) {
+            memcpy (&w64, sptr, 8);
+            w64 = SWAP64 (w64);
+            memcpy (dptr, &w64, 8);
+            }
+        break;
+
+    default:
+        for (j = 0; j < count; j++, sptr += size, dptr += size) {
+            for (k = 0; k < (((int32) size) / 2); k++) {
+                by = sptr[k];                           /* swap end-for-end */
+                dptr[k] = sptr[size - 1 - k];
+                dptr[size - 1 - k] = by;
+                }
+            if (size & 1)                               /* odd? copy middle */
+                dptr[size / 2] = sptr[size / 2];
+            }
+        break;
+        }
+return;
+}
+
+void sim_buf_swap_data (void *bptr, size_t size, size_t count)
+{
+sim_buf_copy_swapped (bptr, bptr, size, count);
+return;
+}
+
+size_t sim_fread (void *bptr, size_t size, size_t count, FILE *fptr)
+{
+size_t c;
 
 if ((size == 0) || (count == 0))                        /* check arguments */
     return 0;
 c = fread (bptr, size, count, fptr);                    /* read buffer */
 if (sim_end || (size == sizeof (char)) || (c == 0))     /* le, byte, or err? */
     return c;                                           /* done */
-for (j = 0, dptr = sptr = (unsigned char *) bptr; j < c; j++) { /* loop on items */
-    for (k = size - 1; k >= (((int32) size + 1) / 2); k--) {
-        by = *sptr;                                     /* swap end-for-end */
-        *sptr++ = *(dptr + k);
-        *(dptr + k) = by;
-        }
-    sptr = dptr = dptr + size;                          /* next item */
-    }
+sim_buf_swap_data (bptr, size, c);                      /* swap in place */
 return c;
 }
 
 size_t sim_fwrite (void *bptr, size_t size, size_t count, FILE *fptr)
 {
-size_t c, j, nelem, nbuf, lcnt, total;
-int32 i, k;
-unsigned char *sptr, *dptr;
+size_t c, nelem, nbuf, lcnt, total;
+int32 i;
+unsigned char *sptr;
 
 if ((size == 0) || (count == 0))                        /* check arguments */
     return 0;
@@ -128,11 +228,8 @@ total = 0;
 sptr = (unsigned char *) bptr;                          /* init input ptr */
 for (i = nbuf; i > 0; i--) {                            /* loop on buffers */
     c = (i == 1)? lcnt: nelem;
-    for (j = 0, dptr = sim_flip; j < c; j++) {          /* loop on items */
-        for (k = size - 1; k >= 0; k--)
-            *(dptr + k) = *sptr++;
-        dptr = dptr + size;
-        }
+    sim_buf_copy_swapped (sim_flip, sptr, size, c);     /* swap into buffer */
+    sptr = sptr + (c * size);
     c = fwrite (sim_flip, size, c, fptr);
     if (c == 0)
         return total;
@@ -310,3 +407,171 @@ return (t_offset)(ftell (st));
 }
 #endif
 
+/* Memory mapped file access
+
+   sim_fmap maps the file attached to a unit into host memory, so that a
+   controller can move data between the image and simulated memory with
+   a single copy and no system calls.  It must be called before any other
+   operation on the file, because it turns off stdio buffering: with the
+   file unbuffered, ordinary stdio I/O on the unit (for example, to areas
+   beyond the mapping) stays coherent with the mapped view.  Only the
+   extent of the file at the time of the call is mapped.  The image is
+   mapped as it is stored, that is, in little endian order.
+
+   sim_fmap_ptr returns the host address of a range of the file, or NULL
+   if the unit is not mapped or the range is not entirely within the
+   mapping; the caller then uses the normal file routines.
+*/
+
+void *sim_fmap_ptr (UNIT *uptr, t_offset pos, size_t lnt)
+{
+if ((uptr->mapbase == NULL) || (pos < 0) ||
+    (((t_uint64) pos) + lnt > uptr->maplnt))
+    return NULL;
+return ((uint8 *) uptr->mapbase) + (size_t) pos;
+}
+
+#if defined (_WIN32)
+#include <windows.h>
+#include <io.h>
+
+t_stat sim_fmap (UNIT *uptr)
+{
+t_offset sz;
+HANDLE fh, mh;
+t_bool ro = ((uptr->flags & UNIT_RO) != 0);
+
+sim_funmap (uptr);
+setvbuf (uptr->fileref, NULL, _IONBF, 0);               /* no stdio buffer */
+sz = sim_fsize_ex (uptr->fileref);
+if (sz <= 0)                                            /* nothing to map? */
+    return SCPE_OK;
+if ((t_uint64) sz != (t_uint64) (size_t) sz)            /* too big? */
+    return SCPE_MEM;
+fh = (HANDLE) _get_osfhandle (_fileno (uptr->fileref));
+mh = CreateFileMapping (fh, NULL, (ro? PAGE_READONLY: PAGE_READWRITE), 0, 0, NULL);
+if (mh == NULL)
+    return SCPE_OPENERR;
+uptr->mapbase = MapViewOfFile (mh, (ro? FILE_MAP_READ: FILE_MAP_WRITE), 0, 0, 0);
+CloseHandle (mh);                                       /* view holds mapping */
+if (uptr->mapbase == NULL)
+    return SCPE_OPENERR;
+uptr->maplnt = (t_uint64) sz;
+return SCPE_OK;
+}
+
+void sim_funmap (UNIT *uptr)
+{
+if (uptr->mapbase != NULL) {
+    FlushViewOfFile (uptr->mapbase, 0);
+    UnmapViewOfFile (uptr->mapbase);
+    }
+uptr->mapbase = NULL;
+uptr->maplnt = 0;
+return;
+}
+
+void *sim_mem_alloc (size_t size)
+{
+return calloc (size, 1);
+}
+
+void sim_mem_free (void *ptr, size_t size)
+{
+free (ptr);
+return;
+}
+
+#elif defined (__linux__) || defined (__APPLE__) || defined (__CYGWIN__) || \
+    defined (__FreeBSD__) || defined (__NetBSD__) || defined (__OpenBSD__)
+#include <sys/mman.h>
+
+t_stat sim_fmap (UNIT *uptr)
+{
+t_offset sz;
+void *mp;
+
+sim_funmap (uptr);
+setvbuf (uptr->fileref, NULL, _IONBF, 0);               /* no stdio buffer */
+sz = sim_fsize_ex (uptr->fileref);
+if (sz <= 0)                                            /* nothing to map? */
+    return SCPE_OK;
+if ((t_uint64) sz != (t_uint64) (size_t) sz)            /* too big? */
+    return SCPE_MEM;
+mp = mmap (NULL, (size_t) sz,
+    PROT_READ | ((uptr->flags & UNIT_RO)? 0: PROT_WRITE),
+    MAP_SHARED, fileno (uptr->fileref), 0);
+if (mp == MAP_FAILED)
+    return SCPE_OPENERR;
+uptr->mapbase = mp;
+uptr->maplnt = (t_uint64) sz;
+return SCPE_OK;
+}
+
+void sim_funmap (UNIT *uptr)
+{
+if (uptr->mapbase != NULL)
+    munmap (uptr->mapbase, (size_t) uptr->maplnt);
+uptr->mapbase = NULL;
+uptr->maplnt = 0;
+return;
+}
+
+/* Simulated memory is mapped anonymously, so that it is page aligned and
+   zero filled on demand.  Where the host supports it, the pages are also
+   marked mergeable: if several simulators on the host run the same
+   software, the kernel can keep one copy of the pages that are identical.
+*/
+
+#if !defined (MAP_ANON)
+#define MAP_ANON        MAP_ANONYMOUS
+#endif
+
+void *sim_mem_alloc (size_t size)
+{
+void *mp;
+
+if (size == 0)
+    return NULL;
+mp = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+if (mp == MAP_FAILED)
+    return NULL;
+#if defined (MADV_MERGEABLE)
+madvise (mp, size, MADV_MERGEABLE);                     /* allow page sharing */
+#endif
+return mp;
+}
+
+void sim_mem_free (void *ptr, size_t size)
+{
+if (ptr != NULL)
+    munmap (ptr, size);
+return;
+}
+
+#else
+
+t_stat sim_fmap (UNIT *uptr)
+{
+return SCPE_NOFNC;
+}
+
+void sim_funmap (UNIT *uptr)
+{
+uptr->mapbase = NULL;
+uptr->maplnt = 0;
+return;
+}
+
+void *sim_mem_alloc (size_t size)
+{
+return calloc (size, 1);
+}
+
+void sim_mem_free (void *ptr, size_t size)
+{
+free (ptr);
+return;
+}
+
+#endif
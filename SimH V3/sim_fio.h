@@ -23,6 +23,9 @@
    be used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added sim_mem_alloc, sim_mem_free
+                        Added sim_buf_swap_data, sim_buf_copy_swapped
+                        Added sim_fmap, sim_funmap, sim_fmap_ptr
    02-Apr-15    RMS     Backported features from GitHub master
    15-May-06    RMS     Added sim_fsize_name
    16-Aug-05    RMS     Fixed C++ declaration and cast problems
@@ -65,9 +68,16 @@ FILE *sim_fopen (const char *file, const char *mode);
 int sim_fseeko (FILE *st, t_offset offset, int whence);
 size_t sim_fread (void *bptr, size_t size, size_t count, FILE *fptr);
 size_t sim_fwrite (void *bptr, size_t size, size_t count, FILE *fptr);
+void sim_buf_swap_data (void *bptr, size_t size, size_t count);
+void sim_buf_copy_swapped (void *dbuf, const void *sbuf, size_t size, size_t count);
 t_offset sim_ftell (FILE *st);
 t_offset sim_fsize_ex (FILE *fptr);
 t_offset sim_fsize_name_ex (char *fname);
+t_stat sim_fmap (UNIT *uptr);
+void sim_funmap (UNIT *uptr);
+void *sim_fmap_ptr (UNIT *uptr, t_offset pos, size_t lnt);
+void *sim_mem_alloc (size_t size);
+void sim_mem_free (void *ptr, size_t size);
 
 extern t_bool sim_taddr_64;         /* t_addr is > 32b and Large File Support available */
 extern t_bool sim_toffset_64;       /* Large File (>2GB) support */
@@ -0,0 +1,505 @@
+/* sim_hist.c: simulator history stream library
+
+   Copyright (c) 2026, Robert M Supnik
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Robert M Supnik shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Robert M Supnik.
+
+   18-Oct-26    RMS     Initial version
+
+   This library includes:
+
+   sim_hs_open          open a history stream
+   sim_hs_close         drain and close a history stream
+   sim_hs_next          hand off a full block, get an empty one
+   sim_hs_flush         drain all history streams
+   sim_hs_closeall      close all history streams
+   sim_hs_show          show history stream state
+
+   A history stream carries a CPU's instruction history to a file while
+   the simulator runs, so that a trace of any length can be captured.
+   Records are in a compact binary format defined by the CPU.  The CPU
+   builds each record directly in a block of a ring of SIM_HS_NBLK
+   blocks: SIM_HS_ROOM returns a pointer with room for at least
+   SIM_HS_RECMAX bytes, and the CPU advances the stream's fill pointer
+   past the record.  No locks are taken, and no calls are made, until a
+   block fills.
+
+   Full blocks are handed to a pool of SIM_HS_NTHR writer threads.  If
+   zlib is available, each block is compressed separately, as one member
+   of a multi-member gzip file, so that blocks can be compressed in
+   parallel; the members are written in order.  The CPU and the writers
+   share only the ring's counts; writers are woken only if they are
+   asleep.  The stream is lossless: if the writers fall a full ring
+   behind, the CPU waits for them.  Without thread support, blocks are
+   compressed and written as they fill.  All streams are drained whenever
+   the simulator stops, so the file is complete, and valid, up to the last
+   instruction executed.
+
+   The data starts with a header: the magic string "SIMHHIST", a version
+   byte, a tag length byte, and the tag, which names the record format.
+   The records follow, without framing.
+*/
+
+#include "sim_defs.h"
+
+#if defined (HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+static SIM_HSTREAM *sim_hs_list = NULL;                 /* open streams */
+
+/* Packer state: one per writer */
+
+typedef struct {
+#if defined (HAVE_ZLIB)
+    z_stream            zs;                             /* compressor */
+#endif
+    uint8               *obuf;                          /* output buffer */
+    } SIM_HS_PACK;
+
+/* Initialize a packer */
+
+static t_bool sim_hs_pinit (SIM_HS_PACK *pk)
+{
+#if defined (HAVE_ZLIB)
+memset (&pk->zs, 0, sizeof (pk->zs));
+if (deflateInit2 (&pk->zs, 1, Z_DEFLATED, 15 + 16, 8,   /* fast, gzip format */
+    Z_DEFAULT_STRATEGY) != Z_OK)
+    return FALSE;
+pk->obuf = (uint8 *) malloc (deflateBound (&pk->zs, SIM_HS_BLKSIZE));
+if (pk->obuf == NULL) {
+    deflateEnd (&pk->zs);
+    return FALSE;
+    }
+#else
+pk->obuf = NULL;
+#endif
+return TRUE;
+}
+
+/* Pack block n: compress it, if possible, and return the output and its
+   length */
+
+static uint8 *sim_hs_pack (SIM_HS_PACK *pk, SIM_HSTREAM *hs, uint32 n, uint32 *olnt)
+{
+uint8 *blk = hs->ring + (n * SIM_HS_BLKSIZE);
+
+#if defined (HAVE_ZLIB)
+if (hs->comp) {
+    deflateReset (&pk->zs);
+    pk->zs.next_in = blk;
+    pk->zs.avail_in = hs->blen[n];
+    pk->zs.next_out = pk->obuf;
+    pk->zs.avail_out = (uInt) deflateBound (&pk->zs, SIM_HS_BLKSIZE);
+    if (deflate (&pk->zs, Z_FINISH) != Z_STREAM_END) {
+        *olnt = 0;
+        hs->err = EIO;
+        return pk->obuf;
+        }
+    *olnt = (uint32) pk->zs.total_out;
+    return pk->obuf;
+    }
+#endif
+*olnt = hs->blen[n];
+return blk;
+}
+
+/* Write packed output to a stream's file */
+
+static void sim_hs_wbytes (SIM_HSTREAM *hs, uint8 *buf, uint32 len)
+{
+if ((len == 0) || hs->err)                              /* nothing, or broken? */
+    return;
+if (fwrite (buf, 1, len, hs->file) != len)
+    hs->err = errno? errno: EIO;
+else hs->nbyte = hs->nbyte + len;
+return;
+}
+
+#if defined (SIM_ASYNCH_IO)
+
+#include <pthread.h>
+
+#if defined (__GNUC__)
+#define HS_MB()         __sync_synchronize ()
+#elif defined (_WIN32)
+#define HS_MB()         MemoryBarrier ()
+#else                                                   /* lock/unlock orders memory */
+static pthread_mutex_t sim_hs_mblock = PTHREAD_MUTEX_INITIALIZER;
+#define HS_MB()         (pthread_mutex_lock (&sim_hs_mblock), \
+                        pthread_mutex_unlock (&sim_hs_mblock))
+#endif
+
+static t_bool sim_hs_ready = FALSE;                     /* writers started */
+static int32 sim_hs_nthr = 0;                           /* # writers */
+static volatile int32 sim_hs_nidle = 0;                 /* # writers asleep */
+static SIM_HS_PACK sim_hs_ipack;                        /* inline packer */
+static pthread_mutex_t sim_hs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_hs_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t sim_hs_free = PTHREAD_COND_INITIALIZER;
+
+/* Find a stream with a block not yet taken by a writer */
+
+static SIM_HSTREAM *sim_hs_pending (void)
+{
+SIM_HSTREAM *hs;
+
+for (hs = sim_hs_list; hs != NULL; hs = hs->next) {
+    if (hs->take != hs->head)
+        return hs;
+    }
+return NULL;
+}
+
+/* Writer thread: take the oldest block of a stream, pack it, and write
+   it when all earlier blocks have been written.  A writer counts itself
+   idle, then rechecks the ring heads, before sleeping; the CPU advances
+   a head before testing the idle count; so a block is never missed. */
+
+static void *sim_hs_writer (void *arg)
+{
+SIM_HS_PACK *pk = (SIM_HS_PACK *) arg;
+SIM_HSTREAM *hs;
+uint32 n, olnt;
+uint8 *obuf;
+
+for ( ;; ) {
+    pthread_mutex_lock (&sim_hs_lock);
+    while ((hs = sim_hs_pending ()) == NULL) {
+        sim_hs_nidle = sim_hs_nidle + 1;
+        HS_MB ();
+        if ((hs = sim_hs_pending ()) == NULL)
+            pthread_cond_wait (&sim_hs_work, &sim_hs_lock);
+        sim_hs_nidle = sim_hs_nidle - 1;
+        }
+    n = hs->take;                                       /* take block */
+    hs->take = n + 1;
+    pthread_mutex_unlock (&sim_hs_lock);
+    HS_MB ();                                           /* see block data */
+    obuf = sim_hs_pack (pk, hs, n % SIM_HS_NBLK, &olnt);
+    pthread_mutex_lock (&sim_hs_lock);
+    while (hs->tail != n)                               /* wait for turn */
+        pthread_cond_wait (&sim_hs_free, &sim_hs_lock);
+    pthread_mutex_unlock (&sim_hs_lock);
+    sim_hs_wbytes (hs, obuf, olnt);                     /* write */
+    pthread_mutex_lock (&sim_hs_lock);
+    hs->tail = n + 1;                                   /* free block */
+    pthread_cond_broadcast (&sim_hs_free);
+    pthread_mutex_unlock (&sim_hs_lock);
+    }
+return NULL;
+}
+
+/* Release a packer */
+
+static void sim_hs_pfree (SIM_HS_PACK *pk)
+{
+#if defined (HAVE_ZLIB)
+deflateEnd (&pk->zs);
+#endif
+free (pk->obuf);
+free (pk);
+return;
+}
+
+/* Start the writers */
+
+static t_bool sim_hs_start (void)
+{
+pthread_t thr;
+pthread_attr_t attr;
+SIM_HS_PACK *pk;
+
+if (!sim_hs_ready) {
+    if (!sim_hs_pinit (&sim_hs_ipack))                  /* for no writers */
+        return FALSE;
+    sim_hs_ready = TRUE;
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    while (sim_hs_nthr < SIM_HS_NTHR) {
+        pk = (SIM_HS_PACK *) calloc (1, sizeof (SIM_HS_PACK));
+        if ((pk == NULL) || !sim_hs_pinit (pk)) {
+            free (pk);
+            break;
+            }
+        if (pthread_create (&thr, &attr, &sim_hs_writer, pk) != 0) {
+            sim_hs_pfree (pk);
+            break;
+            }
+        sim_hs_nthr = sim_hs_nthr + 1;
+        }
+    pthread_attr_destroy (&attr);
+    }
+return TRUE;
+}
+
+/* Hand off the current block; without writers, pack and write it now */
+
+static void sim_hs_put (SIM_HSTREAM *hs)
+{
+uint32 olnt;
+uint8 *obuf;
+
+if (sim_hs_nthr == 0) {                                 /* no writers? */
+    obuf = sim_hs_pack (&sim_hs_ipack, hs, hs->head % SIM_HS_NBLK, &olnt);
+    sim_hs_wbytes (hs, obuf, olnt);
+    hs->head = hs->take = hs->tail = hs->head + 1;
+    return;
+    }
+HS_MB ();                                               /* publish data */
+hs->head = hs->head + 1;                                /* then block */
+HS_MB ();
+if (sim_hs_nidle) {                                     /* writer asleep? */
+    pthread_mutex_lock (&sim_hs_lock);
+    pthread_cond_signal (&sim_hs_work);
+    pthread_mutex_unlock (&sim_hs_lock);
+    }
+return;
+}
+
+/* Wait until no more than n blocks are pending */
+
+static void sim_hs_wait (SIM_HSTREAM *hs, uint32 n)
+{
+pthread_mutex_lock (&sim_hs_lock);
+while ((hs->head - hs->tail) > n)
+    pthread_cond_wait (&sim_hs_free, &sim_hs_lock);
+pthread_mutex_unlock (&sim_hs_lock);
+return;
+}
+
+/* Link or unlink a stream */
+
+static void sim_hs_link (SIM_HSTREAM *hs, t_bool flag)
+{
+SIM_HSTREAM **lp;
+
+pthread_mutex_lock (&sim_hs_lock);
+if (flag) {
+    hs->next = sim_hs_list;
+    sim_hs_list = hs;
+    }
+else {
+    for (lp = &sim_hs_list; *lp != NULL; lp = &(*lp)->next) {
+        if (*lp == hs) {
+            *lp = hs->next;
+            break;
+            }
+        }
+    }
+pthread_mutex_unlock (&sim_hs_lock);
+return;
+}
+
+#else
+
+static t_bool sim_hs_ready = FALSE;                     /* packer ready */
+static SIM_HS_PACK sim_hs_ipack;                        /* inline packer */
+
+static t_bool sim_hs_start (void)
+{
+if (!sim_hs_ready)
+    sim_hs_ready = sim_hs_pinit (&sim_hs_ipack);
+return sim_hs_ready;
+}
+
+/* Without threads, blocks are packed and written as they fill */
+
+static void sim_hs_put (SIM_HSTREAM *hs)
+{
+uint32 olnt;
+uint8 *obuf;
+
+obuf = sim_hs_pack (&sim_hs_ipack, hs, hs->head % SIM_HS_NBLK, &olnt);
+sim_hs_wbytes (hs, obuf, olnt);
+hs->head = hs->take = hs->tail = hs->head + 1;
+return;
+}
+
+static void sim_hs_wait (SIM_HSTREAM *hs, uint32 n)
+{
+return;
+}
+
+static void sim_hs_link (SIM_HSTREAM *hs, t_bool flag)
+{
+SIM_HSTREAM **lp;
+
+if (flag) {
+    hs->next = sim_hs_list;
+    sim_hs_list = hs;
+    }
+else {
+    for (lp = &sim_hs_list; *lp != NULL; lp = &(*lp)->next) {
+        if (*lp == hs) {
+            *lp = hs->next;
+            break;
+            }
+        }
+    }
+return;
+}
+
+#endif
+
+/* Start filling the block at the head of the ring */
+
+static uint8 *sim_hs_fill (SIM_HSTREAM *hs)
+{
+hs->ptr = hs->ring + ((hs->head % SIM_HS_NBLK) * SIM_HS_BLKSIZE);
+hs->lim = hs->ptr + SIM_HS_BLKSIZE;
+return hs->ptr;
+}
+
+/* Hand off the current block, if not empty */
+
+static void sim_hs_end (SIM_HSTREAM *hs)
+{
+uint32 n = hs->head % SIM_HS_NBLK;
+
+hs->blen[n] = (uint32) (hs->ptr - (hs->ring + (n * SIM_HS_BLKSIZE)));
+if (hs->blen[n])
+    sim_hs_put (hs);
+return;
+}
+
+/* Block full: hand it off and return the next one, waiting for the
+   writers if the ring is full */
+
+uint8 *sim_hs_next (SIM_HSTREAM *hs)
+{
+sim_hs_end (hs);
+if ((hs->head - hs->tail) >= SIM_HS_NBLK) {             /* ring full? */
+    hs->nwait = hs->nwait + 1;
+    sim_hs_wait (hs, SIM_HS_NBLK - 1);
+    }
+return sim_hs_fill (hs);
+}
+
+/* Drain a stream and push its data to the file */
+
+static void sim_hs_drain (SIM_HSTREAM *hs)
+{
+sim_hs_end (hs);
+sim_hs_wait (hs, 0);
+sim_hs_fill (hs);
+if ((hs->err == 0) && (fflush (hs->file) != 0))
+    hs->err = errno? errno: EIO;
+return;
+}
+
+/* Open a history stream; tag names the record format */
+
+t_stat sim_hs_open (SIM_HSTREAM *hs, char *fname, const char *tag)
+{
+uint32 tlnt = (uint32) strlen (tag);
+
+if ((fname == NULL) || (*fname == 0) || (tlnt > 255))
+    return SCPE_ARG;
+if (hs->ptr != NULL)                                    /* already open? */
+    sim_hs_close (hs);
+if (!sim_hs_start ())                                   /* writers ready? */
+    return SCPE_MEM;
+hs->ring = (uint8 *) malloc (SIM_HS_NBLK * SIM_HS_BLKSIZE);
+if (hs->ring == NULL)
+    return SCPE_MEM;
+hs->file = sim_fopen (fname, "wb");
+if (hs->file == NULL) {
+    free (hs->ring);
+    hs->ring = NULL;
+    return SCPE_OPENERR;
+    }
+strncpy (hs->fname, fname, CBUFSIZE - 1);
+hs->fname[CBUFSIZE - 1] = 0;
+#if defined (HAVE_ZLIB)
+hs->comp = TRUE;
+#else
+hs->comp = FALSE;
+#endif
+hs->head = hs->take = hs->tail = 0;
+hs->nrec = hs->nbyte = hs->nwait = 0;
+hs->err = 0;
+sim_hs_fill (hs);
+memcpy (hs->ptr, SIM_HS_MAGIC, 8);                      /* header */
+hs->ptr[8] = SIM_HS_VER;
+hs->ptr[9] = (uint8) tlnt;
+memcpy (hs->ptr + 10, tag, tlnt);
+hs->ptr = hs->ptr + 10 + tlnt;
+sim_hs_link (hs, TRUE);
+return SCPE_OK;
+}
+
+/* Close a history stream */
+
+t_stat sim_hs_close (SIM_HSTREAM *hs)
+{
+int err;
+
+if (hs->ptr == NULL)                                    /* not open? */
+    return SCPE_OK;
+sim_hs_drain (hs);
+sim_hs_link (hs, FALSE);
+err = hs->err;
+if (fclose (hs->file) != 0)
+    err = errno? errno: EIO;
+free (hs->ring);
+hs->ring = hs->ptr = hs->lim = NULL;
+hs->file = NULL;
+return (err? SCPE_IOERR: SCPE_OK);
+}
+
+/* Drain all streams; called when the simulator stops */
+
+void sim_hs_flush (void)
+{
+SIM_HSTREAM *hs;
+
+for (hs = sim_hs_list; hs != NULL; hs = hs->next)
+    sim_hs_drain (hs);
+return;
+}
+
+/* Close all streams; called on exit */
+
+void sim_hs_closeall (void)
+{
+while (sim_hs_list != NULL)
+    sim_hs_close (sim_hs_list);
+return;
+}
+
+/* Show stream state */
+
+t_stat sim_hs_show (FILE *st, SIM_HSTREAM *hs)
+{
+if (hs->ptr == NULL) {
+    fprintf (st, "history stream disabled\n");
+    return SCPE_OK;
+    }
+fprintf (st, "history stream to %s%s\n", hs->fname,
+    (hs->comp? " (compressed)": ""));
+fprintf (st, "%.0f records, %.0f bytes written, %.0f waits\n",
+    (double) hs->nrec, (double) hs->nbyte, (double) hs->nwait);
+if (hs->err)
+    fprintf (st, "write error: %s\n", strerror (hs->err));
+return SCPE_OK;
+}
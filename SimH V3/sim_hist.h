@@ -0,0 +1,81 @@
+/* sim_hist.h: simulator history stream library headers
+
+   Copyright (c) 2026, Robert M Supnik
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Robert M Supnik shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Robert M Supnik.
+
+   18-Oct-26    RMS     Initial version
+*/
+
+#ifndef _SIM_HIST_H_
+#define _SIM_HIST_H_    0
+
+#define SIM_HS_BLKSIZE  131072                          /* block size */
+#define SIM_HS_NBLK     32                              /* blocks in ring */
+#define SIM_HS_NTHR     4                               /* # writer threads */
+#define SIM_HS_RECMAX   1024                            /* max record */
+#define SIM_HS_MAGIC    "SIMHHIST"                      /* file magic */
+#define SIM_HS_VER      1                               /* file version */
+
+typedef struct sim_hstream SIM_HSTREAM;
+
+struct sim_hstream {
+    uint8               *ptr;                           /* fill ptr, NULL if off */
+    uint8               *lim;                           /* fill limit */
+    uint8               *ring;                          /* block ring */
+    uint32              blen[SIM_HS_NBLK];              /* block lengths */
+    volatile uint32     head;                           /* blocks filled */
+    volatile uint32     take;                           /* blocks taken */
+    volatile uint32     tail;                           /* blocks written */
+    t_uint64            nrec;                           /* records */
+    t_uint64            nbyte;                          /* bytes written */
+    t_uint64            nwait;                          /* producer waits */
+    FILE                *file;                          /* output file */
+    t_bool              comp;                           /* compressed */
+    int                 err;                            /* host error */
+    char                fname[CBUFSIZE];                /* file name */
+    SIM_HSTREAM         *next;                          /* open streams */
+    };
+
+/* Reserve room for one record; the caller fills it in, then advances
+   ptr past it and counts it in nrec */
+
+#define SIM_HS_ROOM(hs) ((((hs)->ptr + SIM_HS_RECMAX) <= (hs)->lim)? \
+                        (hs)->ptr: sim_hs_next (hs))
+
+/* Little endian fields */
+
+#define SIM_HS_PUT2(p,v) (p)[0] = (uint8) (v); \
+                        (p)[1] = (uint8) ((v) >> 8)
+#define SIM_HS_PUT4(p,v) (p)[0] = (uint8) (v); \
+                        (p)[1] = (uint8) ((v) >> 8); \
+                        (p)[2] = (uint8) ((v) >> 16); \
+                        (p)[3] = (uint8) ((v) >> 24)
+
+t_stat sim_hs_open (SIM_HSTREAM *hs, char *fname, const char *tag);
+t_stat sim_hs_close (SIM_HSTREAM *hs);
+uint8 *sim_hs_next (SIM_HSTREAM *hs);
+void sim_hs_flush (void);
+void sim_hs_closeall (void);
+t_stat sim_hs_show (FILE *st, SIM_HSTREAM *hs);
+
+#endif
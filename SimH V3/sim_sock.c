@@ -23,6 +23,7 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added socket readiness sets (epoll or poll)
    15-Oct-12    MP      Added definitions needed to detect possible tcp 
                         connect failures
    25-Sep-12    MP      Reworked for RFC3493 interfaces supporting IPv6 and IPv4
@@ -81,6 +82,11 @@ extern "C" {
    sim_write_sock       write from socket
    sim_close_sock       close socket
    sim_setnonblock      set socket non-blocking
+   sim_poll_create      create socket readiness set
+   sim_poll_destroy     destroy socket readiness set
+   sim_poll_add         add socket to readiness set
+   sim_poll_remove      remove socket from readiness set
+   sim_poll_ready       list sockets ready to read
 */
 
 /* First, all the non-implemented versions */
@@ -110,6 +116,31 @@ SOCKET sim_accept_conn (SOCKET master, char **connectaddr);
 return INVALID_SOCKET;
 }
 
+SIM_POLL *sim_poll_create (int max)
+{
+return NULL;
+}
+
+void sim_poll_destroy (SIM_POLL *ps)
+{
+return;
+}
+
+int sim_poll_add (SIM_POLL *ps, SOCKET sock, int tag)
+{
+return -1;
+}
+
+void sim_poll_remove (SIM_POLL *ps, SOCKET sock)
+{
+return;
+}
+
+int sim_poll_ready (SIM_POLL *ps, int **tags)
+{
+return -1;
+}
+
 int sim_read_sock (SOCKET sock, char *buf, int nbytes)
 {
 return -1;
@@ -1416,6 +1447,213 @@ shutdown(sock, SD_BOTH);
 closesocket (sock);
 }
 
+/* Socket readiness sets
+
+   A readiness set holds up to max sockets, each with an integer tag.
+   sim_poll_ready checks the whole set with one system call, without
+   waiting, and returns the tags of the sockets that have input, a pending
+   connection, or an error or hangup to report.  Linux keeps the set in the
+   kernel with epoll, so the cost depends on the number of ready sockets and
+   not on the size of the set.  Other Unix hosts use poll.  Where neither is
+   available, sim_poll_create returns NULL and callers must test each socket
+   themselves.
+
+   A closed socket drops out of an epoll set by itself, but not out of a
+   poll set, so callers remove sockets before closing them.
+*/
+
+#if defined (__linux) || defined (__linux__)
+#define SIM_POLL_EPOLL  1
+#include <sys/epoll.h>
+#elif !defined (_WIN32) && !defined (VMS) && !defined (__OS2__)
+#define SIM_POLL_POLL   1
+#include <poll.h>
+#endif
+
+struct sim_poll {
+    int                 max;                            /* max sockets */
+    int                 *tags;                          /* ready tags */
+#if defined (SIM_POLL_EPOLL)
+    int                 epfd;                           /* epoll instance */
+    struct epoll_event  *ev;                            /* ready events */
+#elif defined (SIM_POLL_POLL)
+    int                 cnt;                            /* sockets in set */
+    struct pollfd       *pfd;                           /* poll array */
+    int                 *ptag;                          /* tag per entry */
+#endif
+    };
+
+#if defined (SIM_POLL_EPOLL)
+
+SIM_POLL *sim_poll_create (int max)
+{
+SIM_POLL *ps;
+
+if (max <= 0)
+    return NULL;
+ps = (SIM_POLL *) calloc (1, sizeof (SIM_POLL));
+if (ps == NULL)
+    return NULL;
+ps->max = max;
+ps->tags = (int *) calloc (max, sizeof (int));
+ps->ev = (struct epoll_event *) calloc (max, sizeof (struct epoll_event));
+ps->epfd = epoll_create (max);
+if ((ps->tags == NULL) || (ps->ev == NULL) || (ps->epfd < 0)) {
+    if (ps->epfd >= 0)
+        close (ps->epfd);
+    free (ps->tags);
+    free (ps->ev);
+    free (ps);
+    return NULL;
+    }
+return ps;
+}
+
+void sim_poll_destroy (SIM_POLL *ps)
+{
+if (ps == NULL)
+    return;
+close (ps->epfd);
+free (ps->tags);
+free (ps->ev);
+free (ps);
+return;
+}
+
+int sim_poll_add (SIM_POLL *ps, SOCKET sock, int tag)
+{
+struct epoll_event ev;
+
+memset (&ev, 0, sizeof (ev));
+ev.events = EPOLLIN;
+ev.data.u64 = 0;
+ev.data.fd = tag;
+return epoll_ctl (ps->epfd, EPOLL_CTL_ADD, sock, &ev);
+}
+
+void sim_poll_remove (SIM_POLL *ps, SOCKET sock)
+{
+struct epoll_event ev;                                  /* for kernels before 2.6.9 */
+
+epoll_ctl (ps->epfd, EPOLL_CTL_DEL, sock, &ev);
+return;
+}
+
+int sim_poll_ready (SIM_POLL *ps, int **tags)
+{
+int i, n;
+
+n = epoll_wait (ps->epfd, ps->ev, ps->max, 0);
+for (i = 0; i < n; i++)
+    ps->tags[i] = ps->ev[i].data.fd;
+*tags = ps->tags;
+return n;
+}
+
+#elif defined (SIM_POLL_POLL)
+
+SIM_POLL *sim_poll_create (int max)
+{
+SIM_POLL *ps;
+
+if (max <= 0)
+    return NULL;
+ps = (SIM_POLL *) calloc (1, sizeof (SIM_POLL));
+if (ps == NULL)
+    return NULL;
+ps->max = max;
+ps->tags = (int *) calloc (max, sizeof (int));
+ps->pfd = (struct pollfd *) calloc (max, sizeof (struct pollfd));
+ps->ptag = (int *) calloc (max, sizeof (int));
+if ((ps->tags == NULL) || (ps->pfd == NULL) || (ps->ptag == NULL)) {
+    sim_poll_destroy (ps);
+    return NULL;
+    }
+return ps;
+}
+
+void sim_poll_destroy (SIM_POLL *ps)
+{
+if (ps == NULL)
+    return;
+free (ps->tags);
+free (ps->pfd);
+free (ps->ptag);
+free (ps);
+return;
+}
+
+int sim_poll_add (SIM_POLL *ps, SOCKET sock, int tag)
+{
+if (ps->cnt >= ps->max)
+    return -1;
+ps->pfd[ps->cnt].fd = sock;
+ps->pfd[ps->cnt].events = POLLIN;
+ps->pfd[ps->cnt].revents = 0;
+ps->ptag[ps->cnt] = tag;
+ps->cnt = ps->cnt + 1;
+return 0;
+}
+
+void sim_poll_remove (SIM_POLL *ps, SOCKET sock)
+{
+int i;
+
+for (i = 0; i < ps->cnt; i++) {
+    if (ps->pfd[i].fd == sock) {                        /* found? */
+        ps->cnt = ps->cnt - 1;                          /* move last entry here */
+        ps->pfd[i] = ps->pfd[ps->cnt];
+        ps->ptag[i] = ps->ptag[ps->cnt];
+        break;
+        }
+    }
+return;
+}
+
+int sim_poll_ready (SIM_POLL *ps, int **tags)
+{
+int i, n;
+
+n = poll (ps->pfd, ps->cnt, 0);
+if (n > 0) {
+    for (i = n = 0; i < ps->cnt; i++) {
+        if (ps->pfd[i].revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL))
+            ps->tags[n++] = ps->ptag[i];
+        }
+    }
+*tags = ps->tags;
+return n;
+}
+
+#else                                                   /* no readiness sets */
+
+SIM_POLL *sim_poll_create (int max)
+{
+return NULL;
+}
+
+void sim_poll_destroy (SIM_POLL *ps)
+{
+return;
+}
+
+int sim_poll_add (SIM_POLL *ps, SOCKET sock, int tag)
+{
+return -1;
+}
+
+void sim_poll_remove (SIM_POLL *ps, SOCKET sock)
+{
+return;
+}
+
+int sim_poll_ready (SIM_POLL *ps, int **tags)
+{
+return -1;
+}
+
+#endif
+
 #endif                                                  /* end else !implemented */
 
 #ifdef  __cplusplus
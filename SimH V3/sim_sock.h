@@ -23,6 +23,7 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added socket readiness sets
    15-Oct-12    MP      Added definitions needed to detect possible tcp 
                         connect failures
    25-Sep-12    MP      Reworked for RFC3493 interfaces supporting IPv6 and IPv4
@@ -137,6 +138,14 @@ int sim_getnames_sock (SOCKET sock, char **socknamebuf, char **peernamebuf);
 void sim_init_sock (void);
 void sim_cleanup_sock (void);
 
+typedef struct sim_poll SIM_POLL;                       /* socket readiness set */
+
+SIM_POLL *sim_poll_create (int max);
+void sim_poll_destroy (SIM_POLL *ps);
+int sim_poll_add (SIM_POLL *ps, SOCKET sock, int tag);
+void sim_poll_remove (SIM_POLL *ps, SOCKET sock);
+int sim_poll_ready (SIM_POLL *ps, int **tags);
+
 #ifdef  __cplusplus
 }
 #endif
@@ -26,6 +26,8 @@
    Ultimately, this will be a place to hide processing of various tape formats,
    as well as OS-specific direct hardware access.
 
+   18-Oct-26    RMS     Asynchronous record read/write use a private unit copy
+                        Added asynchronous record read/write
    07-Feb-23    RMS     Silenced Mac compiler warnings (Ken Rector)
    15-Dec-21    JDB     Added extended SIMH format support
    10-Oct-21    JDB     Improved tape_erase_fwd corrupt image error checking
@@ -71,6 +73,8 @@
    sim_tape_rdrecf      read tape record forward
    sim_tape_rdrecr      read tape record reverse
    sim_tape_wrrecf      write tape record forward
+   sim_tape_rdrecf_a    read tape record forward, asynchronously
+   sim_tape_wrrecf_a    write tape record forward, asynchronously
    sim_tape_sprecf      space tape record forward
    sim_tape_sprecr      space tape record reverse
    sim_tape_wrmrk       write private marker
@@ -1115,6 +1119,81 @@ return MTSE_OK;
 }
 
 
+/* Asynchronous read record forward and write record forward
+
+   These start sim_tape_rdrecf or sim_tape_wrrecf as an asynchronous I/O
+   request (see sim_aio.c).
+
+   Inputs:
+        uptr    =       pointer to tape unit
+        req     =       pointer to idle request
+        buf     =       pointer to buffer
+        max     =       maximum record size (read)
+        clbc    =       class and record length (write)
+
+   Outputs:
+        TRUE if the request is queued; FALSE if the request is complete
+
+   On completion, req->stat is the operation status, and for a read,
+   req->xfer is the returned class/record length.  The worker reads or
+   writes through a private copy of the unit; the new position and
+   position-not-updated flag are copied back to the unit in the simulator
+   thread when the request completes.  The unit must not be repositioned
+   while the request is in progress.
+*/
+
+static void sim_tape_aio_rdrecf (SIM_AIO *req)
+{
+t_mtrlnt bc = 0;
+
+req->stat = sim_tape_rdrecf (&req->unit, (uint8 *) req->buf, &bc, (t_mtrlnt) req->count);
+req->xfer = bc;
+return;
+}
+
+static void sim_tape_aio_wrrecf (SIM_AIO *req)
+{
+req->stat = sim_tape_wrrecf (&req->unit, (uint8 *) req->buf, (t_mtrlnt) req->count);
+req->xfer = req->count;
+return;
+}
+
+static void sim_tape_aio_done (SIM_AIO *req)
+{
+UNIT *uptr = req->uptr;
+
+uptr->pos = req->unit.pos;                              /* new position */
+uptr->flags = (uptr->flags & ~MTUF_PNU) | (req->unit.flags & MTUF_PNU);
+return;
+}
+
+t_bool sim_tape_rdrecf_a (UNIT *uptr, SIM_AIO *req, uint8 *buf, t_mtrlnt max)
+{
+req->uptr = uptr;
+req->op = AIO_CALL;
+req->routine = &sim_tape_aio_rdrecf;
+req->done = &sim_tape_aio_done;
+req->unit = *uptr;                                      /* private copy */
+req->buf = buf;
+req->size = sizeof (uint8);
+req->count = max;
+return sim_aio_start (req);
+}
+
+t_bool sim_tape_wrrecf_a (UNIT *uptr, SIM_AIO *req, uint8 *buf, t_mtrlnt clbc)
+{
+req->uptr = uptr;
+req->op = AIO_CALL;
+req->routine = &sim_tape_aio_wrrecf;
+req->done = &sim_tape_aio_done;
+req->unit = *uptr;                                      /* private copy */
+req->buf = buf;
+req->size = sizeof (uint8);
+req->count = clbc;
+return sim_aio_start (req);
+}
+
+
 /* Write metadata forward (internal routine) */
 
 static t_stat sim_tape_wrdata (UNIT *uptr, uint32 dat)
@@ -24,6 +24,7 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added sim_tape_rdrecf_a, sim_tape_wrrecf_a
    15-Dec-21    JDB     Added extended SIMH format support
    06-Oct-21    JDB     Added sim_tape_erase global
    22-Apr-17    JDB     Added MTSE_LEOT value for 4.x compatibility
@@ -217,6 +218,8 @@ t_stat sim_tape_detach (UNIT *uptr);
 t_stat sim_tape_rdrecf (UNIT *uptr, uint8 *buf, t_mtrlnt *clbc, t_mtrlnt max);
 t_stat sim_tape_rdrecr (UNIT *uptr, uint8 *buf, t_mtrlnt *clbc, t_mtrlnt max);
 t_stat sim_tape_wrrecf (UNIT *uptr, uint8 *buf, t_mtrlnt clbc);
+t_bool sim_tape_rdrecf_a (UNIT *uptr, SIM_AIO *req, uint8 *buf, t_mtrlnt max);
+t_bool sim_tape_wrrecf_a (UNIT *uptr, SIM_AIO *req, uint8 *buf, t_mtrlnt clbc);
 t_stat sim_tape_wrmrk (UNIT *uptr, t_mtrlnt mk);
 t_stat sim_tape_wrtmk (UNIT *uptr);
 t_stat sim_tape_wreom (UNIT *uptr);
@@ -23,6 +23,11 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Kept VMS nanosecond clock from going backward
+                        Added sim_idle_loop, generic idle loop detector
+                        Idle sleeps end early on asynchronous wakeups
+                        Added monotonic nanosecond clock, microsecond idle sleeps
+                        Revised calibration to use the nanosecond clock
    27-Sep-22    RMS     Removed OS/2 and Mac "Classic" support
    01-Feb-21    JDB     Added cast for down-conversion
    22-May-17    RMS     Hacked for V4.0 CONST compatibility
@@ -46,9 +51,12 @@
    sim_timer_init       initialize timing system
    sim_activate_after   activate for specified number of microseconds
    sim_idle             virtual machine idle
+   sim_idle_loop        detect idle loop, idle virtual machine
+   sim_os_nsec          return elapsed time in nsec (monotonic)
    sim_os_msec          return elapsed time in msec
    sim_os_sleep         sleep specified number of seconds
    sim_os_ms_sleep      sleep specified number of milliseconds
+   sim_os_us_sleep      sleep specified number of microseconds
 
    The calibration, idle, and throttle routines are OS-independent; the _os_
    routines are not.
@@ -59,9 +67,17 @@
 #include "sim_defs.h"
 #include <ctype.h>
 
+#define NANOS_PER_MICRO     1000
+#define NANOS_PER_MILLI     1000000
+#define NANOS_PER_SEC       1000000000
+#define MICROS_PER_MILLI    1000
+#define MICROS_PER_SEC      1000000
+#define MILLIS_PER_SEC      1000
+
 t_bool sim_idle_enab = FALSE;                           /* global flag */
 
 static uint32 sim_idle_rate_ms = 0;
+static uint32 sim_idle_rate_us = 0;
 static uint32 sim_idle_stable = SIM_IDLE_STDFLT;
 static uint32 sim_throt_ms_start = 0;
 static uint32 sim_throt_ms_stop = 0;
@@ -151,6 +167,36 @@ sys$waitfr (2);
 return sim_os_msec () - stime;
 }
 
+/* VMS has no monotonic clock service available on all versions, so the
+   system time is used, and it is kept from going backward.  A clock set
+   backward stalls the result until it catches up; a clock set forward
+   appears as a jump in elapsed time. */
+
+t_uint64 sim_os_nsec (void)
+{
+static t_uint64 last = 0;
+t_uint64 cur;
+uint32 tod[2];
+
+sys$gettim (tod);                                       /* time 0.1usec */
+cur = ((((t_uint64) tod[1]) << 32) | tod[0]) * 100;
+if (cur < last)                                         /* clock set back? */
+    cur = last;
+last = cur;
+return cur;
+}
+
+uint32 sim_os_us_sleep_init (void)
+{
+return sim_os_ms_sleep_init () * MICROS_PER_MILLI;      /* ms timer only */
+}
+
+uint32 sim_os_us_sleep (uint32 usec)
+{
+return sim_os_ms_sleep ((usec + MICROS_PER_MILLI - 1) / MICROS_PER_MILLI) *
+    MICROS_PER_MILLI;
+}
+
 /* Win32 routines */
 
 #elif defined (_WIN32)
@@ -205,6 +251,32 @@ Sleep (msec);
 return sim_os_msec () - stime;
 }
 
+t_uint64 sim_os_nsec (void)
+{
+static LARGE_INTEGER freq = { 0 };
+LARGE_INTEGER cnt;
+
+if (freq.QuadPart == 0)                                 /* first time? */
+    QueryPerformanceFrequency (&freq);
+QueryPerformanceCounter (&cnt);
+return (((t_uint64) (cnt.QuadPart / freq.QuadPart)) * NANOS_PER_SEC) +
+    ((((t_uint64) (cnt.QuadPart % freq.QuadPart)) * NANOS_PER_SEC) /
+     ((t_uint64) freq.QuadPart));
+}
+
+uint32 sim_os_us_sleep_init (void)
+{
+return sim_os_ms_sleep_init () * MICROS_PER_MILLI;      /* ms timer only */
+}
+
+uint32 sim_os_us_sleep (uint32 usec)
+{
+t_uint64 stime = sim_os_nsec ();
+
+Sleep ((usec + MICROS_PER_MILLI - 1) / MICROS_PER_MILLI);
+return (uint32) ((sim_os_nsec () - stime) / NANOS_PER_MICRO);
+}
+
 #else
 
 /* UNIX routines */
@@ -212,21 +284,33 @@ return sim_os_msec () - stime;
 #include <time.h>
 #include <sys/time.h>
 #include <unistd.h>
-#define NANOS_PER_MILLI     1000000
-#define MILLIS_PER_SEC      1000
 #define sleep1Samples       100
 
 const t_bool rtc_avail = TRUE;
 
-uint32 sim_os_msec ()
+/* The monotonic clock is used if available, so that calibration and
+   idling are not upset by changes to the time of day. */
+
+t_uint64 sim_os_nsec (void)
 {
-struct timeval cur;
-struct timezone foo;
-uint32 msec;
+#if defined (CLOCK_MONOTONIC)
+struct timespec cur;
+
+if (clock_gettime (CLOCK_MONOTONIC, &cur) == 0)
+    return (((t_uint64) cur.tv_sec) * NANOS_PER_SEC) + ((t_uint64) cur.tv_nsec);
+#endif
+    {
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    return (((t_uint64) tv.tv_sec) * NANOS_PER_SEC) +
+        (((t_uint64) tv.tv_usec) * NANOS_PER_MICRO);
+    }
+}
 
-gettimeofday (&cur, &foo);
-msec = (((uint32) cur.tv_sec) * 1000) + (((uint32) cur.tv_usec) / 1000);
-return msec;
+uint32 sim_os_msec ()
+{
+return (uint32) (sim_os_nsec () / NANOS_PER_MILLI);
 }
 
 void sim_os_sleep (unsigned int sec)
@@ -262,6 +346,37 @@ treq.tv_nsec = (milliseconds % MILLIS_PER_SEC) * NANOS_PER_MILLI;
 return sim_os_msec () - stime;
 }
 
+/* Microsecond sleep granularity is the average time taken by the shortest
+   possible sleep.  A signal (e.g., the WRU character) ends the sleep early,
+   so the actual time slept is returned. */
+
+uint32 sim_os_us_sleep_init (void)
+{
+uint32 i;
+t_uint64 t1, tot;
+
+for (i = 0, tot = 0; i < sleep1Samples; i++) {
+    t1 = sim_os_nsec ();
+    sim_os_us_sleep (1);
+    tot += (sim_os_nsec () - t1);
+    }
+tot = (tot + (sleep1Samples * NANOS_PER_MICRO) - 1) / (sleep1Samples * NANOS_PER_MICRO);
+if (tot > (SIM_IDLE_MAX * MICROS_PER_MILLI))
+    tot = 0;
+return (uint32) tot;
+}
+
+uint32 sim_os_us_sleep (uint32 usec)
+{
+t_uint64 stime = sim_os_nsec ();
+struct timespec treq;
+
+treq.tv_sec = usec / MICROS_PER_SEC;
+treq.tv_nsec = (usec % MICROS_PER_SEC) * NANOS_PER_MICRO;
+(void) nanosleep (&treq, NULL);
+return (uint32) ((sim_os_nsec () - stime) / NANOS_PER_MICRO);
+}
+
 #endif
 
 /* OS independent clock calibration package */
@@ -269,6 +384,7 @@ return sim_os_msec () - stime;
 static int32 rtc_ticks[SIM_NTIMERS] = { 0 };            /* ticks */
 static int32 rtc_hz[SIM_NTIMERS] = { 0 };               /* tick rate */
 static uint32 rtc_rtime[SIM_NTIMERS] = { 0 };           /* real time */
+static t_uint64 rtc_rnsec[SIM_NTIMERS] = { 0 };         /* real time, nsec */
 static uint32 rtc_vtime[SIM_NTIMERS] = { 0 };           /* virtual time */
 static double rtc_gtime[SIM_NTIMERS] = { 0 };           /* instruction time */
 static uint32 rtc_nxintv[SIM_NTIMERS] = { 0 };          /* next interval */
@@ -295,7 +411,8 @@ if (time == 0)
     time = 1;
 if ((tmr < 0) || (tmr >= SIM_NTIMERS))
     return time;
-rtc_rtime[tmr] = sim_os_msec ();
+rtc_rnsec[tmr] = sim_os_nsec ();
+rtc_rtime[tmr] = (uint32) (rtc_rnsec[tmr] / NANOS_PER_MILLI);
 rtc_vtime[tmr] = rtc_rtime[tmr];
 rtc_gtime[tmr] = sim_gtime ();
 rtc_nxintv[tmr] = 1000;
@@ -312,6 +429,8 @@ return time;
 int32 sim_rtcn_calb (int32 ticksper, int32 tmr)
 {
 uint32 new_rtime, delta_rtime;
+t_uint64 new_rnsec;
+double delta_ms;
 int32 delta_vtime;
 
 if ((tmr < 0) || (tmr >= SIM_NTIMERS))
@@ -324,24 +443,28 @@ rtc_ticks[tmr] = 0;                                     /* reset ticks */
 rtc_elapsed[tmr] = rtc_elapsed[tmr] + 1;                /* count sec */
 if (!rtc_avail)                                         /* no timer? */
     return rtc_currd[tmr];
-new_rtime = sim_os_msec ();                             /* wall time */
-if (new_rtime < rtc_rtime[tmr]) {                       /* time running backwards? */
-    rtc_rtime[tmr] = new_rtime;                         /* reset wall time */
+new_rnsec = sim_os_nsec ();                             /* wall time */
+new_rtime = (uint32) (new_rnsec / NANOS_PER_MILLI);
+if (new_rnsec < rtc_rnsec[tmr]) {                       /* time running backwards? */
+    rtc_rnsec[tmr] = new_rnsec;                         /* reset wall time */
+    rtc_rtime[tmr] = new_rtime;
     return rtc_currd[tmr];                              /* can't calibrate */
     }
 ++rtc_calibrations[tmr];                                /* count calibrations */
+delta_ms = ((double) (new_rnsec - rtc_rnsec[tmr])) / NANOS_PER_MILLI;
 delta_rtime = new_rtime - rtc_rtime[tmr];               /* elapsed wtime */
-rtc_rtime[tmr] = new_rtime;                             /* adv wall time */
+rtc_rnsec[tmr] = new_rnsec;                             /* adv wall time */
+rtc_rtime[tmr] = new_rtime;
 rtc_vtime[tmr] = rtc_vtime[tmr] + 1000;                 /* adv sim time */
 rtc_gtime[tmr] = sim_gtime ();                          /* save inst time */
 if (delta_rtime > 30000) {                              /* gap too big? */
     sim_rtcn_init (rtc_initd[tmr], tmr);                /* start over */
     return rtc_currd[tmr];                              /* can't calibr */
     }
-if (delta_rtime == 0)                                   /* gap too small? */
+if (delta_ms < 1.0)                                     /* gap too small? */
     rtc_based[tmr] = rtc_based[tmr] * ticksper;         /* slew wide */
 else rtc_based[tmr] = (int32) (((double) rtc_based[tmr] * (double) rtc_nxintv[tmr]) /
-    ((double) delta_rtime));                            /* new base rate */
+    delta_ms);                                          /* new base rate */
 delta_vtime = rtc_vtime[tmr] - rtc_rtime[tmr];          /* gap */
 if (delta_vtime > SIM_TMAX)                             /* limit gap */
     delta_vtime = SIM_TMAX;
@@ -374,7 +497,8 @@ return sim_rtcn_calb (ticksper, 0);
 t_bool sim_timer_init (void)
 {
 sim_idle_enab = FALSE;                                  /* init idle off */
-sim_idle_rate_ms = sim_os_ms_sleep_init ();             /* get OS timer rate */
+sim_idle_rate_us = sim_os_us_sleep_init ();             /* get OS timer rate */
+sim_idle_rate_ms = (sim_idle_rate_us + MICROS_PER_MILLI - 1) / MICROS_PER_MILLI;
 return (sim_idle_rate_ms != 0);
 }
 
@@ -383,18 +507,20 @@ return (sim_idle_rate_ms != 0);
    Inputs:
         tmr =   calibrated timer to use
 
-   Must solve the linear equation
-
-        ms_to_wait = w * ms_per_wait
-
-   Or
-        w = ms_to_wait / ms_per_wait
+   The time to the next event, sim_interval, is converted to microseconds
+   at the timer's current calibrated rate, and the host sleeps for that
+   long if it is at least the host's sleep granularity.  The time actually
+   slept is then counted off sim_interval, so the next event fires as soon
+   as the host wakes up.  If a library thread posts a wakeup, the sleep
+   ends early and the woken unit is scheduled before returning.
 */
 
+#define SIM_IDLE_MAXUS  MICROS_PER_SEC                  /* max single sleep */
+
 t_bool sim_idle (uint32 tmr, t_bool sin_cyc)
 {
-static uint32 cyc_ms = 0;
-uint32 w_ms, w_idle, act_ms;
+double cyc_us, w_us;
+uint32 act_us;
 int32 act_cyc;
 
 if ((!sim_idle_enab) ||                                 /* idling disabled */
@@ -405,28 +531,85 @@ if ((!sim_idle_enab) ||                                 /* idling disabled */
         sim_interval = sim_interval - 1;
     return FALSE;
     }
-if (cyc_ms == 0)                                        /* not computed yet? */
-    cyc_ms = (rtc_currd[tmr] * rtc_hz[tmr]) / 1000;     /* cycles per msec */
-if ((sim_idle_rate_ms == 0) || (cyc_ms == 0)) {         /* not possible? */
+cyc_us = ((double) rtc_currd[tmr] * (double) rtc_hz[tmr]) /
+    MICROS_PER_SEC;                                     /* cycles per usec */
+if ((sim_idle_rate_us == 0) || (cyc_us <= 0.0)) {       /* not possible? */
     if (sin_cyc)
         sim_interval = sim_interval - 1;
     return FALSE;
     }
-w_ms = (uint32) sim_interval / cyc_ms;                  /* ms to wait */
-w_idle = w_ms / sim_idle_rate_ms;                       /* intervals to wait */
-if (w_idle == 0) {                                      /* none? */
+w_us = (double) sim_interval / cyc_us;                  /* usec to wait */
+if (w_us < (double) sim_idle_rate_us) {                 /* too short? */
     if (sin_cyc)
         sim_interval = sim_interval - 1;
     return FALSE;
     }
-act_ms = sim_os_ms_sleep (w_ms);                        /* wait */
-act_cyc = act_ms * cyc_ms;
+if (w_us > SIM_IDLE_MAXUS)
+    w_us = SIM_IDLE_MAXUS;
+act_us = sim_aio_sleep ((uint32) w_us);                 /* wait */
+if (((double) act_us * cyc_us) >= (double) sim_interval)
+    act_cyc = sim_interval;
+else act_cyc = (int32) ((double) act_us * cyc_us);
 if (sim_interval > act_cyc)
     sim_interval = sim_interval - act_cyc;              /* count down sim_interval */
 else sim_interval = 0;                                  /* or fire immediately */
 return TRUE;
 }
 
+/* sim_idle_loop - detect an idle loop and idle the simulator
+
+   Inputs:
+        tmr =   calibrated timer to use
+        pc =    address of the branch instruction
+        target = branch target address
+        ion =   TRUE if interrupts are enabled
+   Outputs:
+        TRUE if the simulator idled
+
+   For CPUs without an explicit wait instruction, the CPU calls this
+   routine on taken backward branches that it knows can only be waiting
+   (a branch to itself, or a jump back to a device skip); counted delay
+   loops must not be passed.  Two patterns are idled:
+
+   - a branch to itself with interrupts enabled; only an interrupt
+     can end the loop, so the simulator idles at once
+   - a short backward branch (at most SIM_IDLE_LOOPW words) taken
+     SIM_IDLE_LOOPN times in a row with no intervening call; the loop
+     is polling a device
+
+   Any other call resets the detector.
+*/
+
+static t_addr idle_loop_pc = 0;
+static t_addr idle_loop_target = 0;
+static uint32 idle_loop_cnt = 0;
+
+t_bool sim_idle_loop (uint32 tmr, t_addr pc, t_addr target, t_bool ion)
+{
+if (!sim_idle_enab)                                     /* idling disabled? */
+    return FALSE;
+if (target == pc) {                                     /* branch to self? */
+    idle_loop_cnt = 0;
+    return (ion? sim_idle (tmr, FALSE): FALSE);         /* idle if ints on */
+    }
+if ((target > pc) || ((pc - target) > SIM_IDLE_LOOPW)) {    /* not short? */
+    idle_loop_cnt = 0;
+    return FALSE;
+    }
+if ((idle_loop_cnt == 0) ||                             /* new loop? */
+    (pc != idle_loop_pc) ||
+    (target != idle_loop_target)) {
+    idle_loop_pc = pc;                                  /* remember it */
+    idle_loop_target = target;
+    idle_loop_cnt = 1;
+    return FALSE;
+    }
+if (++idle_loop_cnt < SIM_IDLE_LOOPN)                   /* not yet stable? */
+    return FALSE;
+idle_loop_cnt = 0;                                      /* restart count */
+return sim_idle (tmr, FALSE);
+}
+
 /* Set idling - implicitly disables throttling */
 
 t_stat sim_set_idle (UNIT *uptr, int32 val, char *cptr, void *desc)
@@ -533,7 +716,7 @@ else {
         }
 
     if (sim_switches & SWMASK ('D')) {
-        fprintf (st, "Wait rate = %d ms\n", sim_idle_rate_ms);
+        fprintf (st, "Wait rate = %d ms (%d us)\n", sim_idle_rate_ms, sim_idle_rate_us);
         if (sim_throt_type != 0)
             fprintf (st, "Throttle interval = %d cycles\n", sim_throt_wait);
         }
@@ -23,6 +23,8 @@
    used in advertising or otherwise to promote the sale, use or other dealings
    in this Software without prior written authorization from Robert M Supnik.
 
+   18-Oct-26    RMS     Added sim_idle_loop
+                        Added sim_os_nsec, sim_os_us_sleep
    14-Dec-14    JDB     [4.0] Added data externals
    28-Apr-07    RMS     Added sim_rtc_init_all
    17-Oct-06    RMS     Added idle support
@@ -40,6 +42,8 @@
 #define SIM_IDLE_STMIN  10                              /* min sec for stability */
 #define SIM_IDLE_STDFLT 20                              /* dft sec for stability */
 #define SIM_IDLE_STMAX  600                             /* max sec for stability */
+#define SIM_IDLE_LOOPW  8                               /* max idle loop length */
+#define SIM_IDLE_LOOPN  2                               /* passes before idling */
 
 #define SIM_THROT_WINIT 1000                            /* cycles to skip */
 #define SIM_THROT_WST   10000                           /* initial wait */
@@ -59,6 +63,7 @@ int32 sim_rtc_init (int32 time);
 int32 sim_rtc_calb (int32 ticksper);
 t_stat sim_activate_after (UNIT *uptr, int32 usec_delay);
 t_bool sim_idle (uint32 tmr, t_bool sin_cyc);
+t_bool sim_idle_loop (uint32 tmr, t_addr pc, t_addr target, t_bool ion);
 t_stat sim_set_throt (int32 arg, char *cptr);
 t_stat sim_show_throt (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, char *cptr);
 t_stat sim_set_idle (UNIT *uptr, int32 val, char *cptr, void *desc);
@@ -71,6 +76,9 @@ uint32 sim_os_msec (void);
 void sim_os_sleep (unsigned int sec);
 uint32 sim_os_ms_sleep (unsigned int msec);
 uint32 sim_os_ms_sleep_init (void);
+t_uint64 sim_os_nsec (void);
+uint32 sim_os_us_sleep (uint32 usec);
+uint32 sim_os_us_sleep_init (void);
 
 extern t_bool sim_idle_enab;                           /* idle enabled flag */
 extern volatile t_bool sim_idle_wait;                  /* idle waiting flag */
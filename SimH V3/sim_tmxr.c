@@ -26,6 +26,9 @@
    Based on the original DZ11 simulator by Thord Nilson, as updated by
    Arthur Krewat.
 
+   18-Oct-26    RMS     Added socket readiness sets; connection and input
+                        polls touch only sockets that are ready
+                        Added tmxr_poll_scale to stretch idle poll intervals
    07-Feb-23    RMS     Silenced Mac compiler warnings (Ken Rector)
    31-Jan-21    JDB     Added a cast in "tmxr_set_lnorder" from t_addr to uint32
    26-Oct-20    JDB     Line order now supports partial connection lists
@@ -74,6 +77,7 @@
    tmxr_poll_rx -       poll receive
    tmxr_putc_ln -       put character for line
    tmxr_poll_tx -       poll transmit
+   tmxr_poll_scale -    scale poll interval by activity
    tmxr_set_modem_control_passthru -    enable modem control on a multiplexer
    tmxr_set_get_modem_bits -            set and/or get a line modem bits
    tmxr_open_master -   open master connection
@@ -184,6 +188,31 @@ void   (*tmxr_show)        (TMLN *lp, FILE *stream) = tmxr_local_show;
 void   (*tmxr_close)       (TMLN *lp)               = tmxr_local_close;
 t_bool (*tmxr_is_extended) (TMLN *lp)               = NULL;
 
+/* Scan readiness set
+
+   Marks the master socket and each registered line that has a pending
+   connection, input, or an error to report.  If the scan fails, everything
+   is marked, so that every socket is polled as it would be without a set.
+*/
+
+static void tmxr_scan_ready (TMXR *mp)
+{
+int32 i, n;
+int *tags;
+
+n = sim_poll_ready (mp->rdyset, &tags);
+mp->mrdy = (n < 0);                                     /* error? poll all */
+for (i = 0; i < mp->lines; i++)
+    mp->ldsc[i].rdy = (n < 0);
+for (i = 0; i < n; i++) {                               /* mark ready sockets */
+    if (tags[i] == mp->lines)                           /* master? */
+        mp->mrdy = 1;
+    else if ((tags[i] >= 0) && (tags[i] < mp->lines))
+        mp->ldsc[tags[i]].rdy = 1;
+    }
+return;
+}
+
 /* Poll for new connection
 
    Called from unit service routine to test for new connection
@@ -221,6 +250,11 @@ static char mantra[] = {
     TN_IAC, TN_DO, TN_BIN
     };
 
+if (mp->rdyset) {                                       /* readiness set? */
+    tmxr_scan_ready (mp);                               /* scan it */
+    if (!mp->mrdy)                                      /* no connection waiting? */
+        return -1;
+    }
 newsock = sim_accept_conn (mp->master, &ipaddr);        /* poll connect */
 if (newsock != INVALID_SOCKET) {                        /* got a live one? */
     fop = op = mp->lnorder;                             /* get line connection order list pointer */
@@ -250,6 +284,10 @@ if (newsock != INVALID_SOCKET) {                        /* got a live one? */
     else {
         lp = mp->ldsc + i;                              /* get line desc */
         lp->conn = newsock;                             /* record connection */
+        if (mp->rdyset &&                               /* readiness set? */
+            (sim_poll_add (mp->rdyset, newsock, i) == 0))
+            lp->rdyset = mp->rdyset;                    /* poll line when ready */
+        mp->act = 1;                                    /* activity */
         lp->ipad = ipaddr;                              /* ip address */
         lp->cnms = sim_os_msec ();                      /* time of conn */
         tmxr_init_line (lp);                            /* initialize the line */
@@ -270,6 +308,11 @@ if (lp->txlog)                                          /* dump log */
 tmxr_send_buffered_data (lp);                           /* send buffered data */
 free (lp->ipad);
 lp->ipad = NULL;
+if (lp->rdyset) {                                       /* in readiness set? */
+    sim_poll_remove (lp->rdyset, lp->conn);             /* remove before close */
+    lp->rdyset = NULL;
+    }
+lp->rdy = 0;
 tmxr_close (lp);                                        /* reset the connection */
 tmxr_init_line (lp);                                    /* initialize the line */
 lp->conn = 0;                                           /*   and clear the connection */
@@ -395,10 +438,14 @@ void tmxr_poll_rx (TMXR *mp)
 int32 i, nbytes, j;
 TMLN *lp;
 
+if (mp->rdyset)                                         /* readiness set? */
+    tmxr_scan_ready (mp);                               /* find ready lines */
 for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     lp = mp->ldsc + i;                                  /* get line desc */
     if (!lp->conn || !lp->rcve)                         /* skip if !conn */
         continue;
+    if (lp->rdyset && !lp->rdy)                         /* registered, not ready? */
+        continue;
 
     nbytes = 0;
     if (lp->rxbpi == 0)                                 /* need input? */
@@ -407,6 +454,8 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     else if (lp->tsta)                                  /* in Telnet seq? */
         nbytes = tmxr_read (lp,                         /* yes, read to end */
             TMXR_MAXBUF - lp->rxbpi);
+    if (nbytes != 0)                                    /* input or close? */
+        mp->act = 1;                                    /* activity */
     if (nbytes < 0)                                     /* closed? reset ln */
         tmxr_reset_ln (lp);
     else if (nbytes > 0) {                              /* if data rcvd */
@@ -605,13 +654,44 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     lp = mp->ldsc + i;                                  /* get line desc */
     if (lp->conn == 0)                                  /* skip if !conn */
         continue;
-    nbytes = tmxr_send_buffered_data (lp);              /* buffered bytes */
-    if (nbytes == 0)                                    /* buf empty? enab line */
-        lp->xmte = 1;
-        }                                               /* end for */
+    if (tmxr_tqln (lp) == 0)                            /* nothing buffered? */
+        lp->xmte = 1;                                   /* enab line, no write */
+    else {
+        mp->act = 1;                                    /* activity */
+        nbytes = tmxr_send_buffered_data (lp);          /* buffered bytes */
+        if (nbytes == 0)                                /* buf empty? enab line */
+            lp->xmte = 1;
+        }
+    }                                                   /* end for */
 return;
 }
 
+/* Scale poll interval by activity
+
+   Inputs:
+        *mp     =       pointer to terminal multiplexor descriptor
+        wait    =       normal poll interval
+   Outputs:
+        poll interval to use
+
+   Each poll with no connection, input, or output doubles the interval, up
+   to 2**TMXR_IDLE_MAX times normal; any activity restores it.  Output is
+   written when the simulated device transmits, so only the delay in seeing
+   new connections and input grows.  Devices whose poll routine also keeps
+   time (modem timers, DMA) must not use this.
+*/
+
+int32 tmxr_poll_scale (TMXR *mp, int32 wait)
+{
+if (mp->act) {                                          /* activity? */
+    mp->act = 0;
+    mp->idle = 0;                                       /* normal interval */
+    }
+else if (mp->idle < TMXR_IDLE_MAX)                      /* idle, stretch */
+    mp->idle = mp->idle + 1;
+return wait << mp->idle;
+}
+
 /* Send buffered data across network
 
    Inputs:
@@ -677,6 +757,14 @@ if (sock == INVALID_SOCKET)                             /* open error */
 sim_printf ("Listening on port %d (socket %d)\n", port, sock);
 mp->port = port;                                        /* save port */
 mp->master = sock;                                      /* save master socket */
+mp->rdyset = sim_poll_create (mp->lines + 1);           /* lines + master */
+if (mp->rdyset &&                                       /* master tag is lines */
+    (sim_poll_add (mp->rdyset, sock, mp->lines) != 0)) {
+    sim_poll_destroy (mp->rdyset);                      /* can't, poll all */
+    mp->rdyset = NULL;
+    }
+mp->act = 1;                                            /* normal interval */
+mp->idle = 0;
 for (i = 0; i < mp->lines; i++) {                       /* initialize lines */
     lp = mp->ldsc + i;
 
@@ -728,7 +816,10 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru conn */
       && (tmxr_is_extended == NULL                      /*   and the line  */
       || tmxr_is_extended (lp) == FALSE))               /*     is not extended */
         tmxr_disconnect_line (lp);                      /*       then disconnect it */
+    lp->rdyset = NULL;                                  /* set is going away */
     }                                                   /* end for */
+sim_poll_destroy (mp->rdyset);                          /* release readiness set */
+mp->rdyset = NULL;
 sim_close_sock (mp->master);                            /* close master socket */
 mp->master = 0;
 return SCPE_OK;
@@ -26,6 +26,8 @@
    Based on the original DZ11 simulator by Thord Nilson, as updated by
    Arthur Krewat.
 
+   18-Oct-26    RMS     Added readiness set and activity to TMXR, TMLN
+                        Added tmxr_poll_scale
    23-Oct-20    JDB     Added tmxr_post_logs global routine
    19-Dec-19    JDB     Added tmxr_is_extended global hook
    19-Mar-19    JDB     Added extension pointer to TMLN structure;
@@ -57,6 +59,7 @@
 #define TMXR_VALID      (1 << TMXR_V_VALID)
 #define TMXR_MAXBUF     256                             /* buffer size */
 #define TMXR_GUARD      12                              /* buffer guard */
+#define TMXR_IDLE_MAX   2                               /* max idle poll stretch, log2 */
 
 /* Modem Control Bits */
 
@@ -89,6 +92,8 @@ struct tmln {
     char                rbr[TMXR_MAXBUF];               /* rcv break */
     char                txb[TMXR_MAXBUF];               /* xmt buffer */
     void                *exptr;                         /* extension pointer */
+    SIM_POLL            *rdyset;                        /* readiness set holding conn */
+    int32               rdy;                            /* conn ready to read */
     };
 
 typedef struct tmln TMLN;
@@ -100,6 +105,10 @@ struct tmxr {
     TMLN                *ldsc;                          /* line descriptors */
     int32               *lnorder;                       /* line connection order */
     DEVICE              *dptr;                          /* multiplexer device */
+    SIM_POLL            *rdyset;                        /* readiness set, NULL if none */
+    int32               mrdy;                           /* master ready to accept */
+    int32               act;                            /* activity since last scale */
+    int32               idle;                           /* idle poll stretch, log2 */
     };
 
 typedef struct tmxr TMXR;
@@ -110,6 +119,7 @@ int32 tmxr_getc_ln (TMLN *lp);
 void tmxr_poll_rx (TMXR *mp);
 t_stat tmxr_putc_ln (TMLN *lp, int32 chr);
 void tmxr_poll_tx (TMXR *mp);
+int32 tmxr_poll_scale (TMXR *mp, int32 wait);
 t_stat tmxr_open_master (TMXR *mp, char *cptr);
 t_stat tmxr_close_master (TMXR *mp);
 t_stat tmxr_attach (TMXR *mp, UNIT *uptr, char *cptr);